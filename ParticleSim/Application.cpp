@@ -14,6 +14,8 @@ Application::Application()
 	// SDL defaults
 	m_window = nullptr;
 	m_renderer = nullptr;
+	m_particleRenderer = nullptr;
+	m_rasteriser = nullptr;
 	
 	// Engine defaults
 	m_running = false;
@@ -23,9 +25,65 @@ Application::Application()
 	m_lastTime = 0;
 	m_currentTime = 0;
 	m_deltaTime = 0.0166666667f; // Default deltatime to 1/60 for first frame
+	m_fixedTimestep = 0.0166666667f; // Step the simulation at 60hz unless told otherwise
+	m_fixedTimestepSet = false;
+	m_subSteps = 1;
+	m_subStepsSet = false;
+	m_subStep = 0;
+	m_maxStepsPerFrame = 8;
+	m_accumulator = 0.0f;
+	m_stepsThisFrame = 0;
+	m_interpolate = true;
+	m_simulationTime = 0.0;
 	m_particleStep = 1000; // Increment/decrement by a 1000
 	m_drawDebugLines = false;
 	m_drawFPSProfile = true;
+
+	// Headless defaults
+	m_headless = false;
+	m_headlessSteps = 1000;
+	m_headlessSeconds = 0.0f;
+	m_headlessWallTime = 0.0;
+	m_dumpParticles = false;
+	m_dumpFrame = false;
+
+	// Benchmark defaults
+	m_benchmarkMode = false;
+	m_benchmarkWarmupSteps = -1;
+	m_benchmarkSteps = -1;
+	m_benchmark = nullptr;
+
+	// Broad phase defaults, the cell size is tuned once the particles exist unless one is given
+	m_sht = nullptr;
+	m_grid = nullptr;
+	m_sparseGrid = nullptr;
+	m_sweep = nullptr;
+	m_tree = nullptr;
+
+	// Reordering defaults
+	m_sorter = nullptr;
+	m_verlet = nullptr;
+	m_verletSkinOption = -1.0f;
+	m_treeMarginOption = -1.0f;
+	m_verletValid = false;
+	m_reorderInterval = 120;
+	m_reorderLocality = 0.5f;
+	m_stepsSinceReorder = 0;
+	m_locality = 1.0f;
+	m_sortedLocality = -1.0f;
+	m_cellSize = 32;
+	m_cellSizeOption = -1;
+	m_autoCellSize = true;
+	m_tunedParticleCount = 0;
+
+	// Trace defaults
+	m_traceEnabled = false;
+	m_trace = nullptr;
+
+	// Recording defaults
+	m_recorder = nullptr;
+	m_player = nullptr;
+
 	// Default our function key states
 	for (int i = 0; i < 12; i++)
 	{
@@ -36,6 +94,168 @@ Application::Application()
 Application::~Application()
 {}
 
+/**
+ * Reads the command line options
+ *   --headless        Run without a window, stepping the simulation at a fixed timestep
+ *   --steps N         The amount of steps a headless run takes (default 1000)
+ *   --seconds T       Run a headless run for T seconds of simulated time instead of a step count
+ *   --timestep DT     The fixed timestep in seconds, overrides "FixedTimestep" in the settings (default 1/60)
+ *   --substeps N      The amount of sub-steps per fixed step, overrides "SubSteps" in the settings (default 1)
+ *   --dump-particles  Write the final state of every particle to a csv after a headless run
+ *   --dump-frame      Rasterise the final frame to a PPM image after a headless run
+ *   --benchmark       Run a sweep over particle counts and write per-phase timings, works with --headless
+ *   --sweep SPEC      The particle counts to sweep, overrides "BenchmarkSweep" in the settings. Implies --benchmark
+ *   --warmup N        The unmeasured steps at each count, overrides "BenchmarkWarmupSteps" in the settings
+ *   --bench-steps N   The measured steps at each count, overrides "BenchmarkSteps" in the settings
+ *   --trace           Write a Chrome trace-event timeline of the run, same as "Trace" in the settings
+ *   --load-snapshot F Start from a snapshot file, overrides "SnapshotLoad" in the settings
+ *   --save-snapshot F Write a snapshot file on exit, overrides "SnapshotSave" in the settings
+ *   --record F        Record the particle positions after every step to a trajectory file, overrides "RecordFile"
+ *   --replay F        Play a trajectory file back instead of simulating
+ *   --cell-size N     The broad phase cell size in pixels, 0 tunes it to the particles. Overrides "CellSize"
+ *   --verlet-skin N   Cache neighbour lists with a skin of N pixels, 0 turns them off. Overrides "VerletSkin"
+ *   --tree-margin N   The pixels every AABB tree leaf reaches past its particle before its velocity is added.
+ *                     Overrides "TreeMargin"
+ * @param _argc int The amount of arguments
+ * @param _argv char*[] The arguments
+ * @returns bool Returns false if the options were invalid
+ */
+bool Application::ParseArguments(int _argc, char* _argv[])
+{
+	for (int i = 1; i < _argc; i++)
+	{
+		std::string m_argument = _argv[i];
+		// Options which take a value
+		bool m_hasValue = (i + 1 < _argc);
+
+		if (m_argument == "--headless")
+		{
+			m_headless = true;
+		}
+		else if (m_argument == "--steps" && m_hasValue)
+		{
+			m_headlessSteps = atoi(_argv[++i]);
+		}
+		else if (m_argument == "--seconds" && m_hasValue)
+		{
+			m_headlessSeconds = (float)atof(_argv[++i]);
+		}
+		else if (m_argument == "--timestep" && m_hasValue)
+		{
+			m_fixedTimestep = (float)atof(_argv[++i]);
+			m_fixedTimestepSet = true;
+		}
+		else if (m_argument == "--substeps" && m_hasValue)
+		{
+			m_subSteps = atoi(_argv[++i]);
+			m_subStepsSet = true;
+		}
+		else if (m_argument == "--dump-particles")
+		{
+			m_dumpParticles = true;
+		}
+		else if (m_argument == "--dump-frame")
+		{
+			m_dumpFrame = true;
+		}
+		else if (m_argument == "--benchmark")
+		{
+			m_benchmarkMode = true;
+		}
+		else if (m_argument == "--sweep" && m_hasValue)
+		{
+			m_benchmarkMode = true;
+			m_benchmarkSweep = _argv[++i];
+		}
+		else if (m_argument == "--warmup" && m_hasValue)
+		{
+			m_benchmarkWarmupSteps = atoi(_argv[++i]);
+		}
+		else if (m_argument == "--bench-steps" && m_hasValue)
+		{
+			m_benchmarkSteps = atoi(_argv[++i]);
+		}
+		else if (m_argument == "--trace")
+		{
+			m_traceEnabled = true;
+		}
+		else if (m_argument == "--load-snapshot" && m_hasValue)
+		{
+			m_snapshotLoadFile = _argv[++i];
+		}
+		else if (m_argument == "--save-snapshot" && m_hasValue)
+		{
+			m_snapshotSaveFile = _argv[++i];
+		}
+		else if (m_argument == "--record" && m_hasValue)
+		{
+			m_recordFile = _argv[++i];
+		}
+		else if (m_argument == "--replay" && m_hasValue)
+		{
+			m_replayFile = _argv[++i];
+		}
+		else if (m_argument == "--cell-size" && m_hasValue)
+		{
+			m_cellSizeOption = atoi(_argv[++i]);
+		}
+		else if (m_argument == "--verlet-skin" && m_hasValue)
+		{
+			m_verletSkinOption = (float)atof(_argv[++i]);
+		}
+		else if (m_argument == "--tree-margin" && m_hasValue)
+		{
+			m_treeMarginOption = (float)atof(_argv[++i]);
+		}
+		else
+		{
+			std::cerr << "Unknown or incomplete option: " << m_argument << "\n";
+			return false;
+		}
+	}
+
+	if (m_fixedTimestep <= 0.0f || m_subSteps < 1)
+	{
+		std::cerr << "The timestep has to be greater than 0 with at least 1 sub-step\n";
+		return false;
+	}
+
+	// Replays are there to be watched, and replaying while recording or benchmarking measures nothing useful
+	if (!m_replayFile.empty() && (m_headless || m_benchmarkMode || !m_recordFile.empty()))
+	{
+		std::cerr << "--replay needs a window and can't be combined with --benchmark or --record\n";
+		return false;
+	}
+
+	if (m_cellSizeOption < -1)
+	{
+		std::cerr << "The cell size has to be 0 to tune it automatically or a size in pixels\n";
+		return false;
+	}
+
+	if (m_verletSkinOption < 0.0f && m_verletSkinOption != -1.0f)
+	{
+		std::cerr << "The neighbour list skin has to be 0 to turn the lists off or a size in pixels\n";
+		return false;
+	}
+
+	if (m_treeMarginOption < 0.0f && m_treeMarginOption != -1.0f)
+	{
+		std::cerr << "The AABB tree margin has to be a size in pixels\n";
+		return false;
+	}
+
+	// Check the sweep now rather than after the window has opened
+	std::vector<int> m_counts;
+	if (!m_benchmarkSweep.empty() && !Benchmark::ParseSweep(m_benchmarkSweep, m_counts))
+	{
+		std::cerr << "Invalid benchmark sweep: " << m_benchmarkSweep << "\n";
+		return false;
+	}
+
+	return true;
+}
+
 // Runs the application in the Init->Update->Exit order with error checking
 bool Application::Run()
 {
@@ -62,17 +282,263 @@ bool Application::Init()
 	rapidjson::IStreamWrapper m_settingsWrapped(m_settingsFile);
 	m_settings.ParseStream(m_settingsWrapped);
 
+	// Read the simulation clock settings, anything given on the command line wins
+	if (!m_fixedTimestepSet && m_settings.HasMember("FixedTimestep") && m_settings["FixedTimestep"].GetFloat() > 0.0f)
+	{
+		m_fixedTimestep = m_settings["FixedTimestep"].GetFloat();
+	}
+	if (!m_subStepsSet && m_settings.HasMember("SubSteps") && m_settings["SubSteps"].GetInt() > 0)
+	{
+		m_subSteps = m_settings["SubSteps"].GetInt();
+	}
+	if (m_settings.HasMember("MaxStepsPerFrame") && m_settings["MaxStepsPerFrame"].GetInt() > 0)
+	{
+		m_maxStepsPerFrame = m_settings["MaxStepsPerFrame"].GetInt();
+	}
+	if (m_settings.HasMember("Interpolate"))
+	{
+		m_interpolate = m_settings["Interpolate"].GetBool();
+	}
+
 	m_rngv = std::uniform_int_distribution<int>(-50, 50);
 	m_rngpw = std::uniform_int_distribution<int>(1, m_settings["WindowWidth"].GetInt() - 1);
 	m_rngph = std::uniform_int_distribution<int>(1, m_settings["WindowHeight"].GetInt() - 1);
-	// Init SDL with video mode
-	if (SDL_Init(SDL_INIT_VIDEO) < 0)
+	m_maxParticleRadius = (m_settings.HasMember("MaxParticleRadius") ? std::max(m_settings["MaxParticleRadius"].GetFloat(), 1.0f) : 1.0f);
+	m_rngr = std::uniform_real_distribution<float>(0.0f, log2f(m_maxParticleRadius));
+	// Init SDL, headless runs only need the timer
+	if (SDL_Init(m_headless ? SDL_INIT_TIMER : SDL_INIT_VIDEO) < 0)
 	{
 		// Failed to init SDL
 		std::cerr << "Failed to init SDL!\n";
 		return false;
 	}
 
+	// Create the window, renderer and text unless we are running headless
+	if (!m_headless && !InitVideo())
+	{
+		return false;
+	}
+
+	// Create our profilers, the zone profiler has to exist before any threads open zones
+	m_profiler = new FPSProfiler("FPS_Profile/profile");
+	ZoneProfiler::Instance();
+
+	// Start streaming the timeline before any threads start recording zones
+	if (m_traceEnabled || (m_settings.HasMember("Trace") && m_settings["Trace"].GetBool()))
+	{
+		std::string m_traceFile = m_profiler->GetOutputFile();
+		m_trace = new TraceWriter();
+		if (!m_trace->Open(m_traceFile.substr(0, m_traceFile.rfind('.')) + "-trace.json"))
+		{
+			return false;
+		}
+		ZoneProfiler::Instance()->SetTrace(m_trace);
+	}
+
+	// Create our benchmark, configured from the settings and then the command line
+	m_benchmark = new Benchmark();
+	if (m_settings.HasMember("BenchmarkSweep") && !m_benchmark->SetSweep(m_settings["BenchmarkSweep"].GetString()))
+	{
+		return false;
+	}
+	if (m_settings.HasMember("BenchmarkWarmupSteps"))
+	{
+		m_benchmark->SetWarmupSteps(m_settings["BenchmarkWarmupSteps"].GetInt());
+	}
+	if (m_settings.HasMember("BenchmarkSteps"))
+	{
+		m_benchmark->SetSteps(m_settings["BenchmarkSteps"].GetInt());
+	}
+	if (!m_benchmarkSweep.empty())
+	{
+		m_benchmark->SetSweep(m_benchmarkSweep);
+	}
+	if (m_benchmarkWarmupSteps >= 0)
+	{
+		m_benchmark->SetWarmupSteps(m_benchmarkWarmupSteps);
+	}
+	if (m_benchmarkSteps > 0)
+	{
+		m_benchmark->SetSteps(m_benchmarkSteps);
+	}
+
+	// Create our job system, a thread count of 0 uses every hardware thread
+	m_jobs = new JobSystem(m_settings.HasMember("ThreadCount") ? m_settings["ThreadCount"].GetInt() : 0);
+	// Every thread counts its collisions on its own
+	m_profiler->SetThreadCount(m_jobs->GetThreadCount());
+
+	// Pick the broad phase, defaulting to the spatial hash table
+	m_broadPhase = BROADPHASE_SPATIALHASHTABLE;
+	std::string m_broadPhaseName = (m_settings.HasMember("BroadPhase") ? m_settings["BroadPhase"].GetString() : "");
+	if (m_broadPhaseName == "CellGrid")
+	{
+		m_broadPhase = BROADPHASE_CELLGRID;
+	}
+	else if (m_broadPhaseName == "SparseHash")
+	{
+		m_broadPhase = BROADPHASE_SPARSEHASH;
+	}
+	else if (m_broadPhaseName == "SweepAndPrune")
+	{
+		m_broadPhase = BROADPHASE_SWEEPANDPRUNE;
+	}
+	else if (m_broadPhaseName == "AABBTree")
+	{
+		m_broadPhase = BROADPHASE_AABBTREE;
+	}
+
+	// Create our collision solver for the cell grid
+	m_solver = new CollisionSolver(m_jobs, m_profiler);
+
+	// Create our sweep and prune and AABB tree, they have no cells so they keep their boxes across cell size changes
+	m_sweep = new SweepAndPrune(m_jobs);
+	if (m_treeMarginOption < 0.0f)
+	{
+		m_treeMarginOption = (m_settings.HasMember("TreeMargin") ? std::max(m_settings["TreeMargin"].GetFloat(), 0.0f) : 1.0f);
+	}
+	m_tree = new DynamicAABBTree(m_jobs, m_treeMarginOption);
+
+	// Cache every particle's neighbours across steps when given a skin, with a skin of 0 the broad phase is built
+	// and searched every step
+	if (m_verletSkinOption < 0.0f)
+	{
+		m_verletSkinOption = (m_settings.HasMember("VerletSkin") ? std::max(m_settings["VerletSkin"].GetFloat(), 0.0f) : 0.0f);
+	}
+	if (m_verletSkinOption > 0.0f)
+	{
+		m_verlet = new VerletList(m_jobs, m_profiler, m_verletSkinOption);
+	}
+
+	// Create our particle sorter unless reordering is turned off with an interval of 0
+	if (m_settings.HasMember("ReorderInterval"))
+	{
+		m_reorderInterval = m_settings["ReorderInterval"].GetInt();
+	}
+	if (m_settings.HasMember("ReorderLocality"))
+	{
+		m_reorderLocality = m_settings["ReorderLocality"].GetFloat();
+	}
+	if (m_reorderInterval > 0)
+	{
+		m_sorter = new MortonSorter(m_jobs);
+		// Particles are spawned in random order, so sort them on the first step
+		m_stepsSinceReorder = m_reorderInterval;
+	}
+
+	// Pick how particles are drawn, defaulting to the batched renderer
+	m_renderMode = RENDERMODE_BATCHED;
+	if (m_settings.HasMember("RenderMode") && std::string(m_settings["RenderMode"].GetString()) == "Software")
+	{
+		m_renderMode = RENDERMODE_SOFTWARE;
+	}
+
+	// Create our particle renderer or rasteriser. Headless runs only rasterise, and only when asked to draw
+	if (m_renderMode == RENDERMODE_SOFTWARE || (m_headless && m_dumpFrame))
+	{
+		m_rasteriser = new Rasteriser(m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt(), m_jobs);
+		if (!m_headless && !m_rasteriser->CreateTexture(m_renderer))
+		{
+			return false;
+		}
+	}
+	else if (!m_headless)
+	{
+		m_particleRenderer = new ParticleRenderer(m_jobs);
+	}
+
+	// Create our particle store, keeping the particles on the screen unless the world is unbounded
+	m_particles = new ParticleStore(m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt(), 500.0f, m_profiler);
+	m_particles->SetBounded(m_settings.HasMember("BoundedWorld") ? m_settings["BoundedWorld"].GetBool() : true);
+	if (!m_particles->IsBounded() && (m_broadPhase == BROADPHASE_SPATIALHASHTABLE || m_broadPhase == BROADPHASE_CELLGRID))
+	{
+		std::cout << "The world is unbounded but the " << GetBroadPhaseName() << " broad phase only covers the screen, use SparseHash, SweepAndPrune or AABBTree to collide particles off it\n";
+	}
+
+	// Create our particles from the count given in the settings json
+	m_particles->Reserve(m_settings["ParticleCount"].GetInt());
+	for (int i = 0; i < m_settings["ParticleCount"].GetInt(); i++)
+	{
+		float m_radius = NextRadius();
+		m_particles->Add(glm::vec2(m_rngpw(m_rng), m_rngph(m_rng)), glm::vec2(m_rngv(m_rng), m_rngv(m_rng)),
+			glm::vec2(0, 0), glm::vec3(rand() % 255 + 200, rand() % 255 + 200, rand() % 255 + 200), m_radius);
+	}
+
+	// Create our spatial hash table and cell grid. A cell size of 0 picks one to suit the particles, anything given
+	// on the command line wins over the settings
+	if (m_cellSizeOption < 0)
+	{
+		m_cellSizeOption = (m_settings.HasMember("CellSize") ? std::max(m_settings["CellSize"].GetInt(), 0) : 0);
+	}
+	m_autoCellSize = (m_cellSizeOption == 0);
+	if (m_autoCellSize)
+	{
+		TuneCellSize(true);
+	}
+	else
+	{
+		SetCellSize(m_cellSizeOption);
+	}
+
+	// Pick up where a saved run left off, anything given on the command line wins over the settings
+	if (m_snapshotLoadFile.empty() && m_settings.HasMember("SnapshotLoad"))
+	{
+		m_snapshotLoadFile = m_settings["SnapshotLoad"].GetString();
+	}
+	if (m_snapshotSaveFile.empty() && m_settings.HasMember("SnapshotSave"))
+	{
+		m_snapshotSaveFile = m_settings["SnapshotSave"].GetString();
+	}
+	if (!m_snapshotLoadFile.empty() && !LoadSnapshot(m_snapshotLoadFile))
+	{
+		return false;
+	}
+
+	// Play a recording back instead of simulating, starting on its first frame
+	if (!m_replayFile.empty())
+	{
+		m_player = new TrajectoryPlayer();
+		if (!m_player->Open(m_replayFile))
+		{
+			return false;
+		}
+		ShowReplayFrame();
+	}
+
+	// Start recording from the first step
+	if (m_recordFile.empty() && m_player == nullptr && m_settings.HasMember("RecordFile"))
+	{
+		m_recordFile = m_settings["RecordFile"].GetString();
+	}
+	if (!m_recordFile.empty())
+	{
+		m_recorder = new TrajectoryRecorder();
+		if (!m_recorder->Open(m_recordFile, m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt(), m_fixedTimestep,
+			m_settings.HasMember("RecordKeyframeInterval") ? m_settings["RecordKeyframeInterval"].GetInt() : 60))
+		{
+			return false;
+		}
+	}
+	
+	// Build the task graph of our simulation phases
+	BuildFrameGraph();
+
+	if (m_trace != nullptr)
+	{
+		m_trace->AddCounter("ParticleCount", m_particles->Size());
+	}
+
+	// Get the last time to calculate deltatime for the first runthrough.
+	/* No more code should be under this line in the init function unless its
+	   timing related or enabling the update loop */
+	m_lastTime = SDL_GetPerformanceCounter();
+	m_running = true;
+	
+	return true;
+}
+
+// Creates the SDL window, renderer and UI text
+bool Application::InitVideo()
+{
 	if (TTF_Init() < 0)
 	{
 		// Failed to init ttf plugin
@@ -106,39 +572,33 @@ bool Application::Init()
 		SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "SDL Error", "Failed to create SDL Renderer!", NULL);
 		return false;
 	}
-	
-	// Create our profiler
-	m_profiler = new FPSProfiler("FPS_Profile/profile");
-
-	// Create our spatial hash table
-	m_sht = new SpatialHashTable(m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt(), 32);
 
-	// Create our particles from the count given in the settings json
-	m_particles.clear();
-	for (int i = 0; i < m_settings["ParticleCount"].GetInt(); i++)
-	{
-		m_particles.push_back(new Particle(glm::vec2(m_rngpw(m_rng), m_rngph(m_rng)), glm::vec2(m_rngv(m_rng), m_rngv(m_rng)),
-			glm::vec2(0, 0), glm::vec3(rand() % 255 + 200, rand() % 255 + 200, rand() % 255 + 200), 500.0f, 1.0f));
-	}
-	
 	// Load our text
 	m_umText = new UIText("resources/fonts/ubuntumono/UbuntuMono-Bold.ttf", 16);
 
-	// Get the last time to calculate deltatime for the first runthrough.
-	/* No more code should be under this line in the init function unless its
-	   timing related or enabling the update loop */
-	m_lastTime = SDL_GetTicks();
-	m_running = true;
-	
 	return true;
 }
 
 // Updates the application's runtime
 bool Application::Update()
 {
+	// Benchmarks script their own particle counts
+	if (m_benchmarkMode)
+	{
+		return UpdateBenchmark();
+	}
+
+	// Headless runs have no window or events to drive them
+	if (m_headless)
+	{
+		return UpdateHeadless();
+	}
+
 	// Game loop
 	while (m_running)
 	{
+		ScopedZone m_frameZone("Frame");
+
 		// Poll our events
 		while (SDL_PollEvent(&m_events))
 		{
@@ -167,15 +627,88 @@ bool Application::Update()
 						// Up key
 						case SDLK_UP:
 						{
-							// Add 1000 particles
-							AddParticles(m_particleStep);
+							// Add 1000 particles, a replay always shows the particles it recorded
+							if (m_player == nullptr)
+							{
+								AddParticles(m_particleStep);
+							}
 							break;
 						}
 						// Down key
 						case SDLK_DOWN:
 						{
 							// Remove 1000 particles
-							RemoveParticles(m_particleStep);
+							if (m_player == nullptr)
+							{
+								RemoveParticles(m_particleStep);
+							}
+							break;
+						}
+						// Space key
+						case SDLK_SPACE:
+						{
+							// Pause or resume the replay
+							if (m_player != nullptr)
+							{
+								m_player->TogglePause();
+							}
+							break;
+						}
+						// Left and right keys
+						case SDLK_LEFT:
+						case SDLK_RIGHT:
+						{
+							// Seek the replay back or forward a second
+							if (m_player != nullptr)
+							{
+								m_player->Seek(m_events.key.keysym.sym == SDLK_LEFT ? -1.0f : 1.0f);
+							}
+							break;
+						}
+						// Page up and page down keys
+						case SDLK_PAGEUP:
+						case SDLK_PAGEDOWN:
+						{
+							// Seek the replay back or forward ten seconds
+							if (m_player != nullptr)
+							{
+								m_player->Seek(m_events.key.keysym.sym == SDLK_PAGEUP ? -10.0f : 10.0f);
+							}
+							break;
+						}
+						// Home and end keys
+						case SDLK_HOME:
+						case SDLK_END:
+						{
+							// Jump to the start or the end of the replay
+							if (m_player != nullptr)
+							{
+								m_player->SeekToFrame(m_events.key.keysym.sym == SDLK_HOME ? 0 : m_player->GetFrameCount() - 1);
+							}
+							break;
+						}
+						// Plus and minus keys
+						case SDLK_EQUALS:
+						case SDLK_KP_PLUS:
+						case SDLK_MINUS:
+						case SDLK_KP_MINUS:
+						{
+							// Double or halve the replay speed
+							if (m_player != nullptr)
+							{
+								bool m_faster = (m_events.key.keysym.sym == SDLK_EQUALS || m_events.key.keysym.sym == SDLK_KP_PLUS);
+								m_player->SetSpeed(m_player->GetSpeed() * (m_faster ? 2.0f : 0.5f));
+							}
+							break;
+						}
+						// L key
+						case SDLK_l:
+						{
+							// Toggle looping the replay
+							if (m_player != nullptr)
+							{
+								m_player->ToggleLoop();
+							}
 							break;
 						}
 						// F1 key
@@ -200,9 +733,31 @@ bool Application::Update()
 							m_functionKeys[2] = true;
 							break;
 						}
-					}
-					break;
-				}
+						// F5 key
+						case SDLK_F5:
+						{
+							// Save a snapshot
+							if (m_functionKeys[5] != true)
+							{
+								SaveSnapshot(m_snapshotSaveFile.empty() ? "snapshot.bin" : m_snapshotSaveFile);
+							}
+							m_functionKeys[5] = true;
+							break;
+						}
+						// F9 key
+						case SDLK_F9:
+						{
+							// Load the last snapshot saved
+							if (m_functionKeys[9] != true)
+							{
+								LoadSnapshot(m_snapshotSaveFile.empty() ? "snapshot.bin" : m_snapshotSaveFile);
+							}
+							m_functionKeys[9] = true;
+							break;
+						}
+					}
+					break;
+				}
 				// Keyboard key up events
 				case SDL_KEYUP:
 				{
@@ -220,60 +775,159 @@ bool Application::Update()
 							m_functionKeys[2] = false;
 							break;
 						}
+						case SDLK_F5:
+						{
+							m_functionKeys[5] = false;
+							break;
+						}
+						case SDLK_F9:
+						{
+							m_functionKeys[9] = false;
+							break;
+						}
 					}
 					break;
 				}
 			}
 		} // End of events
 
-		// Calculate deltatime
-		m_currentTime = SDL_GetTicks();
-		m_deltaTime = (float)(m_currentTime - m_lastTime) / 1000.0f;
+		// Calculate the real time that has passed since the last frame
+		m_currentTime = SDL_GetPerformanceCounter();
+		float m_frameTime = (float)((double)(m_currentTime - m_lastTime) / SDL_GetPerformanceFrequency());
 		m_lastTime = m_currentTime;
 
-		// Run our FPS profiler
-		m_profiler->Run(m_settings["ParticleCount"].GetInt());
-		// Update scene
-
-		// Clear our SpatialHashTable
-		m_sht->Clear();
+		// Run our FPS profiler on the job system alongside the simulation. The steps can change the particle count in
+		// the settings while it runs, so it is handed the count from before they start
+		std::atomic<int> m_profilerPending(1);
+		int m_profiledCount = m_particles->Size();
+		m_jobs->Submit([this, m_profiledCount, &m_profilerPending]()
+		{
+			m_profiler->Run(m_profiledCount);
+			m_profilerPending--;
+		});
 
-		// Loop through every particle, updating it and adding it to the spatial hash table
-		for (unsigned int i = 0; i < m_particles.size(); i++)
+		// Update scene. Bank the frame time and run as many fixed steps as it covers, several steps are batched
+		// into one frame when rendering is the bottleneck. A replay moves its own clock on instead
+		m_accumulator += m_frameTime;
+		m_stepsThisFrame = 0;
+		while (m_player == nullptr && m_accumulator >= m_fixedTimestep && m_stepsThisFrame < m_maxStepsPerFrame)
 		{
-			m_particles.at(i)->Update(m_deltaTime, (*m_sht));
-			m_sht->AddParticle(m_particles.at(i));
+			Step();
+			m_accumulator -= m_fixedTimestep;
+			m_stepsThisFrame++;
+		}
+		if (m_player != nullptr)
+		{
+			m_player->Update(m_frameTime);
+			ShowReplayFrame();
+			m_accumulator = 0.0f;
 		}
 
-		// Clear our buffer
-		SDL_SetRenderDrawColor(m_renderer, 25, 25, 25, 255);
-		SDL_RenderClear(m_renderer);
-		// Render scene
-		for (unsigned int i = 0; i < m_particles.size(); i++)
+		// If we couldn't keep up drop the backlog rather than trying to catch up next frame, which would only be slower
+		if (m_accumulator >= m_fixedTimestep)
 		{
-			m_particles.at(i)->Draw(m_renderer);
+			m_accumulator = fmodf(m_accumulator, m_fixedTimestep);
 		}
 
+		m_jobs->Wait(m_profilerPending);
+
+		// Render scene, blending between the last two states by how far we are into the next step
+		ScopedZone m_renderZone("Render");
+		DrawScene(m_interpolate ? m_accumulator / m_fixedTimestep : 1.0f);
+
 		// Render UI
 		if (m_drawDebugLines)
 		{
-			m_sht->DrawCellLines(m_renderer);
+			if (m_broadPhase == BROADPHASE_CELLGRID)
+			{
+				m_grid->DrawCellLines(m_renderer);
+			}
+			else if (m_broadPhase == BROADPHASE_SPARSEHASH)
+			{
+				m_sparseGrid->DrawCellLines(m_renderer, m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt());
+			}
+			else if (m_broadPhase == BROADPHASE_SWEEPANDPRUNE)
+			{
+				m_sweep->DrawSweepLines(m_renderer, m_settings["WindowHeight"].GetInt());
+			}
+			else if (m_broadPhase == BROADPHASE_AABBTREE)
+			{
+				m_tree->DrawBoxes(m_renderer);
+			}
+			else
+			{
+				m_sht->DrawCellLines(m_renderer);
+			}
 		}
 		
 		// Display FPS
 		if (m_drawFPSProfile)
 		{
+			ScopedZone m_overlayZone("Overlay");
+
 			m_umText->Printf(m_renderer, glm::vec2(10, 10), { 255, 255, 255 }, "Avg. FPS: %i", (int)m_profiler->GetCurrentFPS().m_average);
 			m_umText->Printf(m_renderer, glm::vec2(10, 30), { 255, 255, 255 }, "Max FPS: %i", (int)m_profiler->GetCurrentFPS().m_max);
 			m_umText->Printf(m_renderer, glm::vec2(10, 50), { 255, 255, 255 }, "Min FPS: %i", (int)m_profiler->GetCurrentFPS().m_min);
 			// Display particle count
-			m_umText->Printf(m_renderer, glm::vec2(10, 70), { 255, 255, 255 }, "Particle Count: %i", m_settings["ParticleCount"].GetInt());
-			m_umText->Print(m_renderer, glm::vec2(10, 90), { 200, 200, 255 }, "Press 'F2' to hide/unhide the UI. Press 'F1' to show gridlines of our spatial hash table.");
+			m_umText->Printf(m_renderer, glm::vec2(10, 70), { 255, 255, 255 }, "Particle Count: %i (%i draw calls)", m_settings["ParticleCount"].GetInt(),
+				m_renderMode == RENDERMODE_SOFTWARE ? 1 : m_particleRenderer->GetDrawCalls());
+			// Display how full the broad phase's cells are
+			{
+				GridStats m_gridStats = m_profiler->GetGridStats();
+				std::stringstream m_line;
+				m_line << std::fixed << std::setprecision(2) << "Cell Size: " << m_cellSize << (m_autoCellSize ? " (auto)" : "") << "  Occupied: "
+					<< m_gridStats.m_occupiedCells << "/" << m_gridStats.m_cells << "  Mean: " << m_gridStats.m_meanOccupancy << "  Max: " << m_gridStats.m_maxOccupancy
+					<< "  Locality: " << m_locality << " (" << m_profiler->GetReorders() << " reorders)";
+				m_umText->Printf(m_renderer, glm::vec2(10, 110), { 255, 255, 255 }, "%s", (char*)m_line.str().c_str());
+			}
+			// Display what the collision pass did on the last step
+			{
+				CollisionStats m_collisionStats = m_profiler->GetCollisionStats();
+				std::stringstream m_line;
+				m_line << std::fixed << std::setprecision(2) << "Candidates: " << m_collisionStats.m_counts.m_candidates << "  Tests: "
+					<< m_collisionStats.m_counts.m_distanceTests << "  Contacts: " << m_collisionStats.m_counts.m_contacts << "  Max Bucket: "
+					<< m_collisionStats.m_maxBucketOccupancy << "  Avg. Neighbours: " << m_collisionStats.m_averageNeighbours;
+				if (m_verlet != nullptr)
+				{
+					m_line << "  List Builds: " << m_verlet->GetBuilds();
+				}
+				m_umText->Printf(m_renderer, glm::vec2(10, 130), { 255, 255, 255 }, "%s", (char*)m_line.str().c_str());
+			}
+			// Display the simulation clock, or where the replay is up to
+			if (m_player != nullptr)
+			{
+				std::stringstream m_line;
+				m_line << "Replay Frame: " << m_player->GetFrameIndex() + 1 << "/" << m_player->GetFrameCount() << " (" << m_player->GetSpeed() << "x"
+					<< (m_player->IsPaused() ? ", paused" : "") << (m_player->IsLooping() ? ", looping" : "") << ")";
+				m_umText->Printf(m_renderer, glm::vec2(10, 90), { 255, 255, 255 }, "%s", (char*)m_line.str().c_str());
+			}
+			else
+			{
+				m_umText->Printf(m_renderer, glm::vec2(10, 90), { 255, 255, 255 }, "Steps This Frame: %i (%i Hz, %i sub-steps)", m_stepsThisFrame, (int)(1.0f / m_fixedTimestep + 0.5f), m_subSteps);
+			}
+			m_umText->Print(m_renderer, glm::vec2(10, 150), { 200, 200, 255 }, "Press 'F2' to hide/unhide the UI. Press 'F1' to show gridlines of our spatial hash table.");
+
+			// Display the zone timings over the last second, children indented under their parents
+			const std::vector<ZoneReport> &m_zones = ZoneProfiler::Instance()->GetReport();
+			int m_zoneLines = std::min((int)m_zones.size(), (m_settings["WindowHeight"].GetInt() - 220) / 20);
+			for (int i = 0; i < m_zoneLines; i++)
+			{
+				std::stringstream m_line;
+				m_line << std::fixed << std::setprecision(3) << std::string(m_zones[i].m_depth * 2, ' ') << std::left << std::setw(20 - m_zones[i].m_depth * 2)
+					<< m_zones[i].m_name << " p50 " << m_zones[i].m_p50 << "ms  p95 " << m_zones[i].m_p95 << "ms  p99 " << m_zones[i].m_p99 << "ms";
+				m_umText->Printf(m_renderer, glm::vec2(10, 180 + i * 20), { 200, 255, 200 }, "%s", (char*)m_line.str().c_str());
+			}
 			m_umText->Print(m_renderer, glm::vec2(10, m_settings["WindowHeight"].GetInt() - 20), { 200, 200, 255 }, "Press 'Up Arrow' to increase particles. Press 'Down Arrow' to decrease particles.");
 		}
 		
 		// Present the renderer buffer to the screen
-		SDL_RenderPresent(m_renderer);
+		{
+			ScopedZone m_presentZone("Present");
+			SDL_RenderPresent(m_renderer);
+		}
+
+		// Roll the overlay's zone timings over once a second
+		ZoneProfiler::Instance()->Update();
 
 		// Used to limit fps but is disabled to show the full fps range of the application
 		//if (m_settings["MaxFPS"].GetInt() > 0) // If the MaxFPS is set to higher than 0
@@ -290,16 +944,843 @@ bool Application::Update()
 	return true;
 }
 
+// Runs the simulation for a set amount of steps at a fixed timestep without presenting anything
+bool Application::UpdateHeadless()
+{
+	// Work out how many steps to run, a simulated time is turned into a step count
+	int m_steps = m_headlessSteps;
+	if (m_headlessSeconds > 0.0f)
+	{
+		m_steps = (int)ceilf(m_headlessSeconds / m_fixedTimestep);
+	}
+
+	std::cout << "Running " << m_steps << " headless steps of " << m_fixedTimestep << "s with "
+		<< m_settings["ParticleCount"].GetInt() << " particles on " << m_jobs->GetThreadCount() << " threads\n";
+
+	// Every step uses the same timestep so runs can be compared like for like
+	Uint64 m_startCounter = SDL_GetPerformanceCounter();
+
+	for (m_frames = 0; (int)m_frames < m_steps; m_frames++)
+	{
+		// Each step counts as a frame for the profiler
+		m_profiler->Run(m_settings["ParticleCount"].GetInt());
+		Step();
+
+		// Rasterising headless still draws every step, just into memory
+		if (m_renderMode == RENDERMODE_SOFTWARE)
+		{
+			ScopedZone m_renderZone("Render");
+			m_rasteriser->DrawToBuffer(*m_particles, 1.0f);
+		}
+	}
+
+	// Record how long the whole run took
+	m_headlessWallTime = (double)(SDL_GetPerformanceCounter() - m_startCounter) / SDL_GetPerformanceFrequency();
+
+	std::cout << "Finished in " << m_headlessWallTime << " seconds (" << m_frames / m_headlessWallTime << " steps per second)\n";
+
+	return true;
+}
+
+// Advances the simulation by one fixed timestep, split into the configured amount of sub-steps
+void Application::Step()
+{
+	ScopedZone m_zone("Step");
+
+	// Put particles that are close on the screen back close in memory once they have drifted apart, or sooner if
+	// the collision pass is reading them in a much more scattered order than straight after the last reorder
+	m_stepsSinceReorder++;
+	if (m_sorter != nullptr && (m_stepsSinceReorder >= m_reorderInterval || m_locality < m_sortedLocality * m_reorderLocality))
+	{
+		ReorderParticles();
+	}
+
+	// Remember where every particle was so rendering can interpolate towards the new state
+	m_particles->StoreLastState();
+
+	m_deltaTime = m_fixedTimestep / m_subSteps;
+	for (m_subStep = 0; m_subStep < m_subSteps; m_subStep++)
+	{
+		// Runs every simulation phase across the job system
+		m_frameGraph->Run();
+	}
+
+	m_simulationTime += m_fixedTimestep;
+
+	// Every collision pass of the step has finished, so merge each thread's counts. Each sub-step solves every particle
+	m_profiler->MergeCollisionCounts(m_particles->Size() * m_subSteps);
+	if (m_trace != nullptr)
+	{
+		m_trace->AddCounter("DistanceTests", m_profiler->GetCollisionStats().m_counts.m_distanceTests);
+		m_trace->AddCounter("Contacts", m_profiler->GetCollisionStats().m_counts.m_contacts);
+	}
+
+	// Hand the new state to the recorder, which encodes it on its own thread
+	if (m_recorder != nullptr)
+	{
+		ScopedZone m_recordZone("Record");
+		m_recorder->Capture(*m_particles, m_simulationTime);
+	}
+}
+
+// Runs the benchmark sweep, measuring a fixed amount of steps at each particle count
+bool Application::UpdateBenchmark()
+{
+	const std::vector<int> &m_counts = m_benchmark->GetCounts();
+
+	// Describe the run so results from different builds and machines can be told apart
+	m_benchmark->AddInfo("BroadPhase", GetBroadPhaseName());
+	m_benchmark->AddInfo("Threads", std::to_string(m_jobs->GetThreadCount()));
+	m_benchmark->AddInfo("CollisionKernel", CollisionKernel::GetInstructionSet());
+	m_benchmark->AddInfo("Timestep", std::to_string(m_fixedTimestep));
+	m_benchmark->AddInfo("SubSteps", std::to_string(m_subSteps));
+	m_benchmark->AddInfo("Headless", m_headless ? "true" : "false");
+	m_benchmark->AddInfo("RenderMode", m_renderMode == RENDERMODE_SOFTWARE ? "Software" : "Batched");
+	m_benchmark->AddInfo("CellSize", m_autoCellSize ? "Auto" : std::to_string(m_cellSize));
+
+	for (unsigned int c = 0; c < m_counts.size() && m_running; c++)
+	{
+		ResetParticles(m_counts[c]);
+		std::cout << "Benchmarking " << m_counts[c] << " particles with " << m_cellSize << " pixel cells\n";
+
+		// Let caches, allocations and the threads settle before measuring, then measure a fixed amount of steps
+		int m_totalSteps = m_benchmark->GetWarmupSteps() + m_benchmark->GetSteps();
+		for (int i = 0; i < m_totalSteps && m_running; i++)
+		{
+			if (i == m_benchmark->GetWarmupSteps())
+			{
+				m_benchmark->BeginCount(m_counts[c], m_profiler->GetCollisionChecks());
+			}
+
+			Uint64 m_stepStart = SDL_GetPerformanceCounter();
+			m_profiler->Run(m_settings["ParticleCount"].GetInt());
+			Step();
+
+			// Draw every step when there is a window so the render cost is part of the sweep
+			if (!m_headless)
+			{
+				// Let the window be closed part way through
+				while (SDL_PollEvent(&m_events))
+				{
+					if (m_events.type == SDL_QUIT || (m_events.type == SDL_KEYDOWN && m_events.key.keysym.sym == SDLK_ESCAPE))
+					{
+						m_running = false;
+					}
+				}
+
+				Uint64 m_renderStart = SDL_GetPerformanceCounter();
+				DrawScene(1.0f);
+				SDL_RenderPresent(m_renderer);
+				m_benchmark->AddPhaseTime(BENCHMARK_PHASE_RENDER, SDL_GetPerformanceCounter() - m_renderStart);
+			}
+			else if (m_renderMode == RENDERMODE_SOFTWARE)
+			{
+				// Rasterising headless still has a render cost worth measuring
+				Uint64 m_renderStart = SDL_GetPerformanceCounter();
+				m_rasteriser->DrawToBuffer(*m_particles, 1.0f);
+				m_benchmark->AddPhaseTime(BENCHMARK_PHASE_RENDER, SDL_GetPerformanceCounter() - m_renderStart);
+			}
+
+			m_benchmark->AddStepTime(SDL_GetPerformanceCounter() - m_stepStart);
+		}
+
+		// Only keep counts that ran to the end
+		if (m_running)
+		{
+			m_benchmark->EndCount(m_profiler->GetCollisionChecks());
+		}
+	}
+
+	return true;
+}
+
+// Clears the screen and draws the particles, blending between their last two states by _alpha
+void Application::DrawScene(float _alpha)
+{
+	ScopedZone m_zone("DrawScene");
+
+	// The rasteriser fills every pixel itself, so there is nothing to clear
+	if (m_renderMode == RENDERMODE_SOFTWARE)
+	{
+		m_rasteriser->DrawToTexture(m_renderer, *m_particles, _alpha);
+		return;
+	}
+
+	// Clear our buffer
+	SDL_SetRenderDrawColor(m_renderer, 25, 25, 25, 255);
+	SDL_RenderClear(m_renderer);
+	// Render the particles
+	m_particleRenderer->Draw(m_renderer, *m_particles, _alpha);
+}
+
+// Copies the replay's current frame into the particle store so it can be drawn like a simulated one
+void Application::ShowReplayFrame()
+{
+	ScopedZone m_zone("ReplayFrame");
+
+	TrajectoryFrame &m_frame = m_player->GetFrame();
+	int m_size = m_frame.Size();
+	if (m_size != m_particles->Size())
+	{
+		m_particles->Resize(m_size);
+		m_settings["ParticleCount"].SetInt(m_size);
+	}
+	if (m_size == 0)
+	{
+		return;
+	}
+
+	// Frames are shown as they are, so the last state is the same as the current one
+	memcpy(m_particles->X(), m_frame.m_x.data(), m_size * sizeof(float));
+	memcpy(m_particles->Y(), m_frame.m_y.data(), m_size * sizeof(float));
+	memcpy(m_particles->LastX(), m_frame.m_x.data(), m_size * sizeof(float));
+	memcpy(m_particles->LastY(), m_frame.m_y.data(), m_size * sizeof(float));
+	memcpy(m_particles->Radius(), m_frame.m_radius.data(), m_size * sizeof(float));
+	memcpy(m_particles->Colour(), m_frame.m_colour.data(), m_size * sizeof(SDL_Color));
+	m_simulationTime = m_frame.m_simulationTime;
+}
+
+/**
+ * Replaces every particle with a fresh set made from the default random seed, so each run starts the same
+ * @param _amount int Amount of particles to create
+ */
+void Application::ResetParticles(int _amount)
+{
+	m_particles->Clear();
+	m_rng.seed(std::default_random_engine::default_seed);
+	m_settings["ParticleCount"].SetInt(0);
+
+	m_particles->Reserve(_amount);
+	AddParticles(_amount);
+}
+
+// Gets the name the broad phase is picked by in the settings
+const char* Application::GetBroadPhaseName()
+{
+	switch (m_broadPhase)
+	{
+	case BROADPHASE_CELLGRID:
+		return "CellGrid";
+	case BROADPHASE_SPARSEHASH:
+		return "SparseHash";
+	case BROADPHASE_SWEEPANDPRUNE:
+		return "SweepAndPrune";
+	case BROADPHASE_AABBTREE:
+		return "AABBTree";
+	default:
+		return "SpatialHashTable";
+	}
+}
+
+// Hands how full the broad phase's cells were this step and how local the particles are to the profiler
+void Application::UpdateGridStats()
+{
+	// The cell grids hold the order the collision pass read the particles in, the spatial hash table has no such order
+	// and the sweep and tree don't walk the particles by cell
+	GridStats m_stats;
+	if (m_broadPhase == BROADPHASE_CELLGRID)
+	{
+		m_stats = m_grid->GetStats();
+		m_locality = MortonSorter::MeasureLocality(m_grid->GetSortedIndices(), m_particles->Size());
+	}
+	else if (m_broadPhase == BROADPHASE_SPARSEHASH)
+	{
+		m_stats = m_sparseGrid->GetStats();
+		m_locality = MortonSorter::MeasureLocality(m_sparseGrid->GetSortedIndices(), m_sparseGrid->GetCellStart()[m_sparseGrid->GetOccupiedCells()]);
+	}
+	else if (m_broadPhase == BROADPHASE_SWEEPANDPRUNE)
+	{
+		m_stats = m_sweep->GetStats();
+	}
+	else if (m_broadPhase == BROADPHASE_AABBTREE)
+	{
+		m_stats = m_tree->GetStats();
+	}
+	else
+	{
+		m_stats = m_sht->GetStats();
+	}
+	m_profiler->SetGridStats(m_stats);
+	m_profiler->SetLocality(m_locality);
+	if (m_sortedLocality < 0.0f && m_stepsSinceReorder == 0)
+	{
+		m_sortedLocality = m_locality;
+	}
+
+	if (m_trace != nullptr)
+	{
+		m_trace->AddCounter("MaxCellOccupancy", m_stats.m_maxOccupancy);
+		m_trace->AddCounter("LocalityPercent", (long long)(m_locality * 100.0f));
+	}
+}
+
+// Reorders the particles along the Z-order curve of the cells they are in
+void Application::ReorderParticles()
+{
+	ScopedZone m_zone("Reorder");
+	Uint64 m_start = SDL_GetPerformanceCounter();
+
+	m_sorter->Sort(*m_particles, m_cellSize);
+	m_stepsSinceReorder = 0;
+	m_sortedLocality = -1.0f;
+
+	// Every particle is at a new index, so the recording needs a keyframe to carry the radii and colours across
+	if (m_recorder != nullptr)
+	{
+		m_recorder->RequestKeyframe();
+	}
+
+	m_profiler->AddReorder((double)(SDL_GetPerformanceCounter() - m_start) * 1000.0 / SDL_GetPerformanceFrequency());
+}
+
+/**
+ * Picks a cell size from the particle radii and how densely the particles fill the screen. Cells are never
+ * smaller than the largest particle so the collision solver can colour them
+ * @returns int The cell size in pixels
+ */
+int Application::ChooseCellSize()
+{
+	int m_count = m_particles->Size();
+	float* m_radius = m_particles->Radius();
+
+	// The largest particle sets the smallest cell we can use
+	float m_maxRadius = 0.0f;
+	for (int i = 0; i < m_count; i++)
+	{
+		if (m_radius[i] > m_maxRadius)
+		{
+			m_maxRadius = m_radius[i];
+		}
+	}
+	int m_smallest = std::max((int)ceilf(m_maxRadius * 2.0f), MIN_CELL_SIZE);
+
+	// The particles spread over the screen, or over wherever they have got to in an unbounded world
+	float m_area = (float)m_settings["WindowWidth"].GetInt() * m_settings["WindowHeight"].GetInt();
+	if (!m_particles->IsBounded())
+	{
+		float* m_x = m_particles->X();
+		float* m_y = m_particles->Y();
+		float m_minX = FLT_MAX, m_minY = FLT_MAX, m_maxX = -FLT_MAX, m_maxY = -FLT_MAX;
+		for (int i = 0; i < m_count; i++)
+		{
+			if (std::isfinite(m_x[i]) && std::isfinite(m_y[i]))
+			{
+				m_minX = std::min(m_minX, m_x[i]);
+				m_maxX = std::max(m_maxX, m_x[i]);
+				m_minY = std::min(m_minY, m_y[i]);
+				m_maxY = std::max(m_maxY, m_y[i]);
+			}
+		}
+		if (m_minX <= m_maxX)
+		{
+			m_area = std::max((m_maxX - m_minX) * (m_maxY - m_minY), m_area);
+		}
+	}
+
+	// Size the cells so particles spread evenly over that area would leave TARGET_CELL_OCCUPANCY in each one
+	int m_cellSize = (m_count > 0 ? (int)ceilf(sqrtf(TARGET_CELL_OCCUPANCY * m_area / m_count)) : MAX_CELL_SIZE);
+
+	return std::max(std::min(m_cellSize, MAX_CELL_SIZE), m_smallest);
+}
+
+/**
+ * Rebuilds every broad phase with a new cell size. Only call this between steps
+ * @param _cellSize int The cell size in pixels
+ */
+void Application::SetCellSize(int _cellSize)
+{
+	// A cell bigger than the screen would leave the spatial hash table without any
+	_cellSize = std::min(_cellSize, std::min(m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt()));
+	if (_cellSize == m_cellSize && m_grid != nullptr)
+	{
+		return;
+	}
+
+	m_cellSize = _cellSize;
+	delete m_sht;
+	delete m_grid;
+	delete m_sparseGrid;
+	m_sht = new SpatialHashTable(m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt(), m_cellSize);
+	m_grid = new CellGrid(m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt(), m_cellSize);
+	m_sparseGrid = new SparseHashGrid(m_cellSize);
+
+	// The new broad phases are empty, so the neighbour lists have to build them again
+	if (m_verlet != nullptr)
+	{
+		m_verlet->Invalidate();
+	}
+
+	if (m_trace != nullptr)
+	{
+		m_trace->AddCounter("CellSize", m_cellSize);
+	}
+}
+
+/**
+ * Tunes the cell size again if it is tuned automatically and the particle count has moved far enough from
+ * the count it was last tuned for
+ * @param _force bool Tunes it whatever the particle count when true
+ */
+void Application::TuneCellSize(bool _force)
+{
+	if (!m_autoCellSize)
+	{
+		return;
+	}
+
+	// Small changes in the count barely move the best size, so leave the grids alone until it shifts a lot
+	int m_count = m_particles->Size();
+	if (!_force && m_count <= m_tunedParticleCount * RETUNE_RATIO && m_count * RETUNE_RATIO >= m_tunedParticleCount)
+	{
+		return;
+	}
+	m_tunedParticleCount = m_count;
+
+	int m_previous = m_cellSize;
+	SetCellSize(ChooseCellSize());
+	if (m_cellSize != m_previous)
+	{
+		std::cout << "Tuned the cell size to " << m_cellSize << " pixels for " << m_count << " particles\n";
+	}
+}
+
+/**
+ * Saves every particle and the simulation state to a snapshot file
+ * @param _outputFile const std::string& The file to write to
+ * @returns bool Returns false if the snapshot couldn't be written
+ */
+bool Application::SaveSnapshot(const std::string &_outputFile)
+{
+	SnapshotState m_state;
+	m_state.m_simulationTime = m_simulationTime;
+	m_state.m_fixedTimestep = m_fixedTimestep;
+	m_state.m_subSteps = m_subSteps;
+	m_state.m_screenWidth = m_settings["WindowWidth"].GetInt();
+	m_state.m_screenHeight = m_settings["WindowHeight"].GetInt();
+	m_state.m_cellSize = m_cellSize;
+	m_state.m_broadPhase = (int)m_broadPhase;
+	m_state.m_stepsSinceReorder = m_stepsSinceReorder;
+	m_state.m_sortedLocality = m_sortedLocality;
+	m_state.m_locality = m_locality;
+
+	// The engine writes its state as text, which reads back exactly
+	std::stringstream m_rngState;
+	m_rngState << m_rng;
+	m_state.m_rngState = m_rngState.str();
+
+	if (!Snapshot::Save(_outputFile, *m_particles, m_state))
+	{
+		return false;
+	}
+	std::cout << "Saved " << m_particles->Size() << " particles to " << _outputFile << "\n";
+	return true;
+}
+
+/**
+ * Replaces every particle and the simulation state with a snapshot file
+ * @param _inputFile const std::string& The file to read from
+ * @returns bool Returns false if the snapshot couldn't be loaded, the simulation carries on as it was
+ */
+bool Application::LoadSnapshot(const std::string &_inputFile)
+{
+	ScopedZone m_zone("LoadSnapshot");
+
+	SnapshotState m_state;
+	ParticleStore* m_loaded = new ParticleStore(m_settings["WindowWidth"].GetInt(), m_settings["WindowHeight"].GetInt(), 500.0f, m_profiler);
+	m_loaded->SetBounded(m_particles->IsBounded());
+	if (!Snapshot::Load(_inputFile, *m_loaded, m_state))
+	{
+		delete m_loaded;
+		return false;
+	}
+
+	// The particles only make sense inside the screen they were saved in
+	if (m_state.m_screenWidth != m_settings["WindowWidth"].GetInt() || m_state.m_screenHeight != m_settings["WindowHeight"].GetInt())
+	{
+		std::cerr << _inputFile << " was saved at " << m_state.m_screenWidth << "x" << m_state.m_screenHeight << ", the window is "
+			<< m_settings["WindowWidth"].GetInt() << "x" << m_settings["WindowHeight"].GetInt() << "\n";
+		delete m_loaded;
+		return false;
+	}
+
+	std::stringstream m_rngState(m_state.m_rngState);
+	m_rngState >> m_rng;
+
+	delete m_particles;
+	m_particles = m_loaded;
+	m_sweep->Invalidate();
+	m_tree->Invalidate();
+	if (m_verlet != nullptr)
+	{
+		m_verlet->Invalidate();
+	}
+	m_settings["ParticleCount"].SetInt(m_particles->Size());
+	m_simulationTime = m_state.m_simulationTime;
+	m_broadPhase = (m_state.m_broadPhase >= 0 && m_state.m_broadPhase <= BROADPHASE_AABBTREE ? (BroadPhaseType)m_state.m_broadPhase : BROADPHASE_SPATIALHASHTABLE);
+
+	// Carry on at the saved clock unless a timestep or sub-step count was given on the command line
+	if (!m_fixedTimestepSet && m_state.m_fixedTimestep > 0.0f)
+	{
+		m_fixedTimestep = m_state.m_fixedTimestep;
+	}
+	if (!m_subStepsSet && m_state.m_subSteps > 0)
+	{
+		m_subSteps = m_state.m_subSteps;
+	}
+
+	// Carry on with the cell size the snapshot was saved with, which keeps the run identical to one that never
+	// stopped. An auto tuned size is only tuned again once the count moves on from the loaded one
+	if (m_state.m_cellSize > 0)
+	{
+		SetCellSize(m_state.m_cellSize);
+	}
+	m_tunedParticleCount = m_particles->Size();
+
+	// Carry on the reorder schedule too, rather than the reorder Init forces on the first step, the particle
+	// order decides the order contacts are resolved in
+	m_stepsSinceReorder = m_state.m_stepsSinceReorder;
+	m_sortedLocality = m_state.m_sortedLocality;
+	m_locality = m_state.m_locality;
+
+	// A recording running through the load sees every particle replaced, so it needs a keyframe to carry the new
+	// radii and colours
+	if (m_recorder != nullptr)
+	{
+		m_recorder->RequestKeyframe();
+	}
+
+	if (m_trace != nullptr)
+	{
+		m_trace->AddCounter("ParticleCount", m_particles->Size());
+	}
+
+	std::cout << "Loaded " << m_particles->Size() << " particles from " << _inputFile << " at " << m_simulationTime << "s\n";
+	return true;
+}
+
+// Writes the results of a headless run next to the profiler output
+void Application::ExportHeadlessResults()
+{
+	// Name the results after the profile file so runs can be matched up
+	std::string m_resultsFile = m_profiler->GetOutputFile();
+	m_resultsFile = m_resultsFile.substr(0, m_resultsFile.rfind('.')) + "-results.txt";
+
+	std::ofstream m_output(m_resultsFile, std::ios::out | std::ios::trunc);
+	if (m_output.is_open())
+	{
+		m_output << "== Headless Results ==\n";
+		m_output << std::setfill(' ') << std::left << std::setw(24) << "Particle Count" << m_settings["ParticleCount"].GetInt() << "\n";
+		m_output << std::left << std::setw(24) << "Broad Phase" << GetBroadPhaseName() << "\n";
+		m_output << std::left << std::setw(24) << "Threads" << m_jobs->GetThreadCount() << "\n";
+		m_output << std::left << std::setw(24) << "Collision Kernel" << CollisionKernel::GetInstructionSet() << "\n";
+		m_output << std::left << std::setw(24) << "Render Mode" << (m_renderMode == RENDERMODE_SOFTWARE ? "Software" : "Batched") << "\n";
+		m_output << std::left << std::setw(24) << "Max Particle Radius" << m_maxParticleRadius << "\n";
+		m_output << std::left << std::setw(24) << "Cell Size" << m_cellSize << (m_autoCellSize ? " (auto)" : "") << "\n";
+		if (m_broadPhase == BROADPHASE_AABBTREE)
+		{
+			m_output << std::left << std::setw(24) << "Tree Margin" << m_tree->GetMargin() << "\n";
+			m_output << std::left << std::setw(24) << "Tree Reinserts" << m_tree->GetTotalReinserted() << "\n";
+		}
+		m_output << std::left << std::setw(24) << "Mean Cell Occupancy" << m_profiler->GetGridStats().m_meanOccupancy << "\n";
+		m_output << std::left << std::setw(24) << "Max Cell Occupancy" << m_profiler->GetGridStats().m_maxOccupancy << "\n";
+		m_output << std::left << std::setw(24) << "Locality" << m_locality << "\n";
+		m_output << std::left << std::setw(24) << "Candidate Pairs" << m_profiler->GetCollisionTotals().m_candidates << "\n";
+		m_output << std::left << std::setw(24) << "Distance Tests" << m_profiler->GetCollisionTotals().m_distanceTests << "\n";
+		m_output << std::left << std::setw(24) << "Contacts" << m_profiler->GetCollisionTotals().m_contacts << "\n";
+		m_output << std::left << std::setw(24) << "Average Neighbours" << m_profiler->GetCollisionStats().m_averageNeighbours << "\n";
+		if (m_verlet != nullptr)
+		{
+			m_output << std::left << std::setw(24) << "Neighbour List Skin" << m_verlet->GetSkin() << "\n";
+			m_output << std::left << std::setw(24) << "Neighbour List Builds" << m_verlet->GetBuilds() << " (" << m_verlet->GetPairs() << " pairs)\n";
+		}
+		m_output << std::left << std::setw(24) << "Particle Reorders" << m_profiler->GetReorders() << " (" << m_profiler->GetReorderTime() << " ms)\n";
+		m_output << std::left << std::setw(24) << "Steps" << m_frames << "\n";
+		m_output << std::left << std::setw(24) << "Timestep" << m_fixedTimestep << "\n";
+		m_output << std::left << std::setw(24) << "Sub-steps" << m_subSteps << "\n";
+		m_output << std::left << std::setw(24) << "Simulated Time" << m_simulationTime << "\n";
+		m_output << std::left << std::setw(24) << "Wall Time" << m_headlessWallTime << "\n";
+		m_output << std::left << std::setw(24) << "Steps Per Second" << (m_headlessWallTime > 0.0 ? m_frames / m_headlessWallTime : 0.0) << "\n";
+		m_output.close();
+	}
+	else
+	{
+		std::cerr << "Failed to open output file for headless results\n";
+	}
+
+	// Rasterise the final state of every particle
+	if (m_dumpFrame)
+	{
+		m_rasteriser->DrawToBuffer(*m_particles, 1.0f);
+		m_rasteriser->WritePPM(m_resultsFile.substr(0, m_resultsFile.rfind('-')) + "-frame.ppm");
+	}
+
+	if (!m_dumpParticles)
+	{
+		return;
+	}
+
+	// Dump the final state of every particle
+	std::string m_particlesFile = m_resultsFile.substr(0, m_resultsFile.rfind('-')) + "-particles.csv";
+	std::ofstream m_particlesOutput(m_particlesFile, std::ios::out | std::ios::trunc);
+	if (m_particlesOutput.is_open())
+	{
+		m_particlesOutput << "x,y,vx,vy,radius\n";
+		for (int i = 0; i < m_particles->Size(); i++)
+		{
+			m_particlesOutput << m_particles->X()[i] << "," << m_particles->Y()[i] << "," << m_particles->VelocityX()[i] << ","
+				<< m_particles->VelocityY()[i] << "," << m_particles->Radius()[i] << "\n";
+		}
+		m_particlesOutput.close();
+	}
+	else
+	{
+		std::cerr << "Failed to open output file for the particle dump\n";
+	}
+}
+
+// Builds the task graph that runs the simulation phases of a step
+void Application::BuildFrameGraph()
+{
+	m_frameGraph = new TaskGraph(m_jobs);
+
+	// Check whether the neighbour lists can be used as they are, which skips the broad phase this step
+	int m_check = -1;
+	if (m_verlet != nullptr)
+	{
+		m_check = m_frameGraph->AddTask("CheckNeighbourLists", [this]()
+		{
+			ScopedZone m_zone("CheckNeighbourLists");
+			Uint64 m_start = SDL_GetPerformanceCounter();
+			m_verletValid = m_verlet->IsValid(*m_particles);
+			m_benchmark->AddPhaseTime(BENCHMARK_PHASE_REBUILD, SDL_GetPerformanceCounter() - m_start);
+		});
+	}
+
+	// Add every particle to the broad phase
+	int m_build = m_frameGraph->AddTask("BuildBroadPhase", [this]()
+	{
+		if (m_verlet != nullptr && m_verletValid)
+		{
+			return;
+		}
+		ScopedZone m_zone("BuildBroadPhase");
+		Uint64 m_start = SDL_GetPerformanceCounter();
+		if (m_broadPhase == BROADPHASE_CELLGRID)
+		{
+			// Counting sort every particle into the cell grid, which was cleared at the end of the last step
+			m_grid->Rebuild(*m_particles);
+		}
+		else if (m_broadPhase == BROADPHASE_SPARSEHASH)
+		{
+			// The occupied cells are outlined on screen after the step, so they are only emptied here. Then
+			// counting sort every particle into the occupied cells
+			m_sparseGrid->Clear();
+			m_sparseGrid->Rebuild(*m_particles);
+		}
+		else if (m_broadPhase == BROADPHASE_SWEEPANDPRUNE)
+		{
+			// Move every box and insertion sort them back into order, then sweep them for pairs unless the
+			// neighbour lists are about to search them instead
+			m_sweep->Update(*m_particles);
+			if (m_verlet == nullptr)
+			{
+				m_sweep->FindPairs();
+			}
+		}
+		else if (m_broadPhase == BROADPHASE_AABBTREE)
+		{
+			// Put the particles that left their leaves back into the tree, then search it for pairs unless the
+			// neighbour lists are about to search it instead
+			m_tree->Update(*m_particles, m_deltaTime);
+			if (m_verlet == nullptr)
+			{
+				m_tree->FindPairs(*m_particles);
+			}
+		}
+		else
+		{
+			// Loop through every particle adding it to the spatial hash table
+			for (int i = 0; i < m_particles->Size(); i++)
+			{
+				m_sht->AddParticle(i, m_particles->Position(i), m_particles->Radius()[i]);
+			}
+		}
+
+		// Search the fresh broad phase once for every particle's neighbour list
+		if (m_verlet != nullptr)
+		{
+			ScopedZone m_listZone("BuildNeighbourLists");
+			if (m_broadPhase == BROADPHASE_CELLGRID)
+			{
+				m_verlet->Build(*m_particles, *m_grid);
+			}
+			else if (m_broadPhase == BROADPHASE_SPARSEHASH)
+			{
+				m_verlet->Build(*m_particles, *m_sparseGrid);
+			}
+			else if (m_broadPhase == BROADPHASE_SWEEPANDPRUNE)
+			{
+				m_verlet->Build(*m_particles, *m_sweep);
+			}
+			else if (m_broadPhase == BROADPHASE_AABBTREE)
+			{
+				m_verlet->Build(*m_particles, *m_tree);
+			}
+			else
+			{
+				// The spatial hash table only searches the cells a particle's own bounds touch, which is too few to
+				// reach across the skin, so build the lists from the cell grid instead
+				m_grid->Clear();
+				m_grid->Rebuild(*m_particles);
+				m_verlet->Build(*m_particles, *m_grid);
+			}
+		}
+		m_benchmark->AddPhaseTime(BENCHMARK_PHASE_REBUILD, SDL_GetPerformanceCounter() - m_start);
+	});
+	if (m_check >= 0)
+	{
+		m_frameGraph->AddDependency(m_check, m_build);
+	}
+
+	// Run the collision pass over every particle
+	int m_collision = m_frameGraph->AddTask("Collision", [this]()
+	{
+		ScopedZone m_zone("Collision");
+		Uint64 m_start = SDL_GetPerformanceCounter();
+		if (m_verlet != nullptr)
+		{
+			m_verlet->Solve(*m_particles);
+		}
+		else if (m_broadPhase == BROADPHASE_CELLGRID)
+		{
+			m_solver->Solve(*m_particles, *m_grid);
+		}
+		else if (m_broadPhase == BROADPHASE_SPARSEHASH)
+		{
+			m_solver->Solve(*m_particles, *m_sparseGrid);
+		}
+		else if (m_broadPhase == BROADPHASE_SWEEPANDPRUNE)
+		{
+			m_solver->Solve(*m_particles, *m_sweep);
+		}
+		else if (m_broadPhase == BROADPHASE_AABBTREE)
+		{
+			m_solver->Solve(*m_particles, *m_tree);
+		}
+		else
+		{
+			m_particles->SolveCollisions(*m_sht);
+		}
+		m_benchmark->AddPhaseTime(BENCHMARK_PHASE_COLLISION, SDL_GetPerformanceCounter() - m_start);
+	});
+	m_frameGraph->AddDependency(m_build, m_collision);
+
+	// Run the integration pass over every particle, each particle is independent so split it across the threads
+	int m_integration = m_frameGraph->AddTask("Integration", [this]()
+	{
+		ScopedZone m_zone("Integration");
+		Uint64 m_start = SDL_GetPerformanceCounter();
+		m_jobs->ParallelFor(0, m_particles->Size(), 4096, [this](int _begin, int _end)
+		{
+			m_particles->Integrate(m_deltaTime, _begin, _end);
+		});
+		m_benchmark->AddPhaseTime(BENCHMARK_PHASE_INTEGRATION, SDL_GetPerformanceCounter() - m_start);
+	});
+	m_frameGraph->AddDependency(m_collision, m_integration);
+
+	// Hand the broad phase's stats to the profiler and overlay once the collision pass is done with it. Only the
+	// broad phase is read, so it runs alongside the integration pass. Neighbour lists that skipped the build left
+	// nothing new to measure
+	int m_stats = m_frameGraph->AddTask("BroadPhaseStats", [this]()
+	{
+		if (m_subStep != m_subSteps - 1 || (m_verlet != nullptr && m_verletValid))
+		{
+			return;
+		}
+		ScopedZone m_zone("BroadPhaseStats");
+		UpdateGridStats();
+	});
+	m_frameGraph->AddDependency(m_collision, m_stats);
+
+	// Clear the broad phase ready for the next step once its stats are taken, also alongside the integration pass
+	int m_clear = m_frameGraph->AddTask("ClearBroadPhase", [this]()
+	{
+		if (m_verlet != nullptr && m_verletValid)
+		{
+			return;
+		}
+		ScopedZone m_zone("ClearBroadPhase");
+		Uint64 m_start = SDL_GetPerformanceCounter();
+		if (m_broadPhase == BROADPHASE_CELLGRID)
+		{
+			m_grid->Clear();
+		}
+		else if (m_broadPhase == BROADPHASE_SPATIALHASHTABLE)
+		{
+			m_sht->Clear();
+		}
+		// The sweep keeps its boxes in order and the tree keeps its leaves from the last step, which is what makes
+		// them cheap to update, and the sparse grid is cleared as it is rebuilt
+		m_benchmark->AddPhaseTime(BENCHMARK_PHASE_REBUILD, SDL_GetPerformanceCounter() - m_start);
+	});
+	m_frameGraph->AddDependency(m_stats, m_clear);
+}
+
 // Exit sequence for the application
 bool Application::Exit()
 {
 	// Export our profiler data to file
 	m_profiler->Export();
+	std::string m_zoneFile = m_profiler->GetOutputFile();
+	ZoneProfiler::Instance()->Export(m_zoneFile.substr(0, m_zoneFile.rfind('.')) + "-zones.txt");
+	if (m_benchmarkMode)
+	{
+		// Name the results after the profile file so runs can be matched up
+		std::string m_benchmarkFile = m_profiler->GetOutputFile();
+		m_benchmark->Export(m_benchmarkFile.substr(0, m_benchmarkFile.rfind('.')) + "-benchmark");
+	}
+	else if (m_headless)
+	{
+		ExportHeadlessResults();
+	}
+	if (!m_snapshotSaveFile.empty() && !m_benchmarkMode)
+	{
+		SaveSnapshot(m_snapshotSaveFile);
+	}
+	delete m_player;
+	if (m_recorder != nullptr)
+	{
+		m_recorder->Close();
+		std::cout << "Recorded " << m_recorder->GetFrames() << " frames to " << m_recordFile << " (" << m_recorder->GetBytesWritten() / 1024
+			<< " KB, " << m_recorder->GetStallSeconds() << "s waiting on the encoder)\n";
+		delete m_recorder;
+	}
+
 	// Destroy everything
-	SDL_DestroyWindow(m_window);
-	SDL_DestroyRenderer(m_renderer);
+	delete m_frameGraph;
+	delete m_particleRenderer;
+	delete m_rasteriser;
+	delete m_sorter;
+	delete m_verlet;
+	delete m_sweep;
+	delete m_tree;
+	delete m_jobs;
+	delete m_benchmark;
+
+	// Every thread that recorded zones has stopped, finish the trace
+	if (m_trace != nullptr)
+	{
+		ZoneProfiler::Instance()->SetTrace(nullptr);
+		m_trace->Close();
+		delete m_trace;
+	}
+	if (!m_headless)
+	{
+		SDL_DestroyRenderer(m_renderer);
+		SDL_DestroyWindow(m_window);
+		TTF_Quit();
+	}
 
-	TTF_Quit();
 	SDL_Quit();
 
 	return true;
@@ -314,12 +1795,37 @@ void Application::AddParticles(int _amount)
 	// Update the particle count number
 	m_settings["ParticleCount"].SetInt(m_settings["ParticleCount"].GetInt() + _amount);
 
-	// Loop through adding the new amount of particles
+	// Make room for them all at once, then loop through adding the new amount of particles
+	m_particles->Reserve(m_particles->Size() + _amount);
 	for (int i = 0; i < _amount; i++)
 	{
-		m_particles.push_back(new Particle(glm::vec2(m_rngpw(m_rng), m_rngph(m_rng)), glm::vec2(m_rngv(m_rng), m_rngv(m_rng)),
-			glm::vec2(0, 0), glm::vec3(rand() % 255 + 200, rand() % 255 + 200, rand() % 255 + 200), 500.0f, 1.0f));
+		float m_radius = NextRadius();
+		m_particles->Add(glm::vec2(m_rngpw(m_rng), m_rngph(m_rng)), glm::vec2(m_rngv(m_rng), m_rngv(m_rng)),
+			glm::vec2(0, 0), glm::vec3(rand() % 255 + 200, rand() % 255 + 200, rand() % 255 + 200), m_radius);
+	}
+
+	if (m_trace != nullptr)
+	{
+		m_trace->AddCounter("ParticleCount", m_particles->Size());
+	}
+
+	// Denser particles want smaller cells
+	TuneCellSize(false);
+}
+
+/**
+ * Picks the radius of a new particle, spread evenly over the powers of two up to the largest radius so small
+ * particles outnumber big ones
+ * @returns float The radius in pixels
+ */
+float Application::NextRadius()
+{
+	// Only draw from the random engine when radii can differ, so runs of radius 1 particles spawn the same as ever
+	if (m_maxParticleRadius <= 1.0f)
+	{
+		return 1.0f;
 	}
+	return exp2f(m_rngr(m_rng));
 }
 
 /**
@@ -335,27 +1841,17 @@ void Application::RemoveParticles(int _amount)
 		return;
 	}
 
-	int m_count = 0;
 	m_settings["ParticleCount"].SetInt(m_settings["ParticleCount"].GetInt() - _amount);
-	// Our iterator
-	std::vector<Particle*>::iterator m_iter;
-	
-	// Loop through until we have cleaned up enough particles
-	for (m_iter = m_particles.begin(); m_iter != m_particles.end();)
-	{
-		// check if we have reached our amount
-		if (m_count > _amount)
-		{
-			// We reached the limit, break out the loop
-			break;
-		}
+	// Remove the particles from the end of the store
+	m_particles->Remove(_amount);
 
-		// Delete more
-		delete * m_iter;
-		m_iter = m_particles.erase(m_iter);
-		// Increase our count
-		m_count++;
+	if (m_trace != nullptr)
+	{
+		m_trace->AddCounter("ParticleCount", m_particles->Size());
 	}
+
+	// Sparser particles want bigger cells
+	TuneCellSize(false);
 }
 
 /* STATIC IMPLEMENTS */
@@ -7,9 +7,35 @@
  * @date: 16/03/2017
  * @copyright: Copyright Ryan Thorn (c) 2017. All rights reserved.
  */
+
+// The broad phases available for finding neighbouring particles, picked with "BroadPhase" in settings.json
+enum BroadPhaseType
+{
+	BROADPHASE_SPATIALHASHTABLE, // "SpatialHashTable": a vector bucket per cell
+	BROADPHASE_CELLGRID, // "CellGrid": counting-sort cell lists
+	BROADPHASE_SPARSEHASH, // "SparseHash": counting-sort lists of only the occupied cells, for worlds bigger than the screen
+	BROADPHASE_SWEEPANDPRUNE, // "SweepAndPrune": bounding boxes kept sorted along x across steps, with no cells
+	BROADPHASE_AABBTREE // "AABBTree": a balanced tree of fat bounding boxes, for particles of very different sizes
+};
+
+// The ways particles can be drawn, picked with "RenderMode" in settings.json
+enum RenderMode
+{
+	RENDERMODE_BATCHED, // "Batched": a handful of renderer calls through the particle renderer
+	RENDERMODE_SOFTWARE // "Software": rasterised on the CPU into a streaming texture, or a buffer when headless
+};
+
 class Application
 {
 private:
+	// The particles an auto tuned cell should hold on average. Under one, as a cell costs less to walk than a pair test
+	static constexpr float TARGET_CELL_OCCUPANCY = 0.5f;
+	// How far the particle count can move from the count the cell size was tuned for before it is tuned again
+	static constexpr float RETUNE_RATIO = 1.5f;
+	// The smallest and largest cell size that will be picked automatically
+	static const int MIN_CELL_SIZE = 4;
+	static const int MAX_CELL_SIZE = 256;
+
 	// SDL Variables
 	SDL_Window* m_window; // SDL window
 	SDL_Renderer* m_renderer; // SDL renderer
@@ -22,18 +48,84 @@ private:
 	bool m_drawDebugLines; // Draws the cell lines when true
 	bool m_drawFPSProfile; // Draws the fps profile when true
 
+	// Headless Variables
+	bool m_headless; // Runs the simulation without a window when true
+	int m_headlessSteps; // The amount of steps a headless run takes
+	float m_headlessSeconds; // The simulated time a headless run takes, overrides the step count when set
+	double m_headlessWallTime; // How long the headless run took in seconds
+	bool m_dumpParticles; // Writes the final particle state to disk after a headless run when true
+	bool m_dumpFrame; // Rasterises the final frame to a PPM image after a headless run when true
+
+	// Benchmark Variables
+	bool m_benchmarkMode; // Runs a scripted sweep over particle counts instead of the interactive loop when true
+	std::string m_benchmarkSweep; // The sweep spec given on the command line, empty uses the settings
+	int m_benchmarkWarmupSteps; // The warmup steps given on the command line, -1 uses the settings
+	int m_benchmarkSteps; // The measured steps given on the command line, -1 uses the settings
+
+	// Snapshot Variables
+	std::string m_snapshotLoadFile; // The snapshot the simulation starts from, empty starts from the settings
+	std::string m_snapshotSaveFile; // The snapshot written on exit and with F5, empty only saves with F5
+
+	// Recording Variables
+	std::string m_recordFile; // The trajectory file every step is recorded to, empty doesn't record
+
+	// Replay Variables
+	std::string m_replayFile; // The trajectory file played back instead of simulating, empty simulates
+
+	// Trace Variables
+	bool m_traceEnabled; // Streams a Chrome trace-event timeline next to the profile when true
+
 	// Timing Variables
-	unsigned int m_lastTime; // The last frames time
-	unsigned int m_currentTime; // The current frames time
-	float m_deltaTime; // The delta between the last frame and current frame times
+	Uint64 m_lastTime; // The last frames time in performance counter ticks
+	Uint64 m_currentTime; // The current frames time in performance counter ticks
+	float m_deltaTime; // The timestep of the simulation step currently running (the fixed timestep over the sub-steps)
+	float m_fixedTimestep; // The fixed timestep the simulation advances by, independent of the frame rate
+	bool m_fixedTimestepSet; // True when the fixed timestep was given on the command line
+	int m_subSteps; // The amount of sub-steps each fixed step is split into
+	bool m_subStepsSet; // True when the sub-step count was given on the command line
+	int m_subStep; // The sub-step currently running, counting from 0
+	int m_maxStepsPerFrame; // The most fixed steps run in one frame, stops a slow frame snowballing
+	float m_accumulator; // Real time banked up that the simulation hasn't stepped through yet
+	int m_stepsThisFrame; // The amount of fixed steps run during the current frame
+	bool m_interpolate; // Renders particles between their last two states when true
+	double m_simulationTime; // The total simulated time in seconds
 	unsigned int m_frames; // A frame counter
 	float m_fps;  // current fps
 
 	// Game storage
-	std::vector<Particle*> m_particles; // Vector of all particles in the game. Used for iteration through ALL particles
+	ParticleStore* m_particles; // Structure-of-arrays storage of all particles in the game. Used for iteration through ALL particles
 	SpatialHashTable* m_sht;// Spatial hashtable for collision detection
+	CellGrid* m_grid; // Counting-sort cell grid for collision detection
+	SparseHashGrid* m_sparseGrid; // Counting-sort hash of the occupied cells for collision detection in an unbounded world
+	SweepAndPrune* m_sweep; // Boxes sorted along x for collision detection without cells
+	DynamicAABBTree* m_tree; // Tree of bounding boxes for collision detection between particles of any size
+	BroadPhaseType m_broadPhase; // The broad phase used for collision detection
+	int m_cellSize; // The cell size of every broad phase
+	int m_cellSizeOption; // The cell size given on the command line, 0 tunes it automatically and -1 uses the settings
+	bool m_autoCellSize; // Picks the cell size from the particles and re-tunes it as the count changes when true
+	int m_tunedParticleCount; // The particle count the cell size was last tuned for
+	JobSystem* m_jobs; // Worker threads used to spread the simulation across cores
+	CollisionSolver* m_solver; // Parallel collision pass over the cell grid
+	VerletList* m_verlet; // Neighbour lists cached across steps, nullptr when the broad phase is searched every step
+	float m_verletSkinOption; // The neighbour list skin given on the command line, 0 turns the lists off and -1 uses the settings
+	float m_treeMarginOption; // The AABB tree leaf margin given on the command line, -1 uses the settings
+	bool m_verletValid; // Whether the neighbour lists were still valid at the start of this sub-step
+	MortonSorter* m_sorter; // Reorders the particles along a Z-order curve, nullptr when reordering is off
+	int m_reorderInterval; // The most steps between two reorders
+	float m_reorderLocality; // Reorders early once the locality falls below this fraction of what it was after the last reorder
+	int m_stepsSinceReorder; // The amount of steps since the particles were last reordered
+	float m_locality; // How close in memory the particles the collision pass reads one after another are
+	float m_sortedLocality; // The locality on the first step after the last reorder, -1 until it has been measured
+	RenderMode m_renderMode; // How the particles are drawn
+	ParticleRenderer* m_particleRenderer; // Draws the particles in batches, nullptr when headless or rasterising
+	Rasteriser* m_rasteriser; // Draws the particles on the CPU, nullptr unless rasterising or dumping a frame
+	TaskGraph* m_frameGraph; // The phases of a simulation step and the dependencies between them
 	UIText* m_umText; // Ubuntu Mono Text
 	FPSProfiler* m_profiler; // Our profiler
+	Benchmark* m_benchmark; // Times the phases of each step during a benchmark sweep
+	TraceWriter* m_trace; // Streams profiler zones and counters to a trace file, nullptr when tracing is off
+	TrajectoryRecorder* m_recorder; // Records the particle positions after every step, nullptr when not recording
+	TrajectoryPlayer* m_player; // Plays a recording back instead of simulating, nullptr when simulating
 
 	int m_particleStep; // The amount of particles to increase or decrease when the buttons are pressed
 
@@ -42,12 +134,77 @@ private:
 	std::uniform_int_distribution<int> m_rngv;
 	std::uniform_int_distribution<int> m_rngpw;
 	std::uniform_int_distribution<int> m_rngph;
+	std::uniform_real_distribution<float> m_rngr;
+	float m_maxParticleRadius; // The largest radius a new particle can have, every particle has a radius of 1 when this is 1
 
 	// Json Inputs
 	rapidjson::Document m_settings; // The settings json data from the settings.json file
 
 	/* STATIC MEMBERS */
 	static Application* s_instance;
+
+	// Builds the task graph that runs the simulation phases of a step
+	void BuildFrameGraph();
+	// Creates the SDL window, renderer and UI text
+	bool InitVideo();
+	// Runs the simulation for a set amount of steps at a fixed timestep without presenting anything
+	bool UpdateHeadless();
+	// Advances the simulation by one fixed timestep, split into the configured amount of sub-steps
+	void Step();
+	// Writes the results of a headless run next to the profiler output
+	void ExportHeadlessResults();
+	// Runs the benchmark sweep, measuring a fixed amount of steps at each particle count
+	bool UpdateBenchmark();
+	// Clears the screen and draws the particles, blending between their last two states by _alpha
+	void DrawScene(float _alpha);
+	// Copies the replay's current frame into the particle store so it can be drawn like a simulated one
+	void ShowReplayFrame();
+	// Gets the name the broad phase is picked by in the settings
+	const char* GetBroadPhaseName();
+	// Hands how full the broad phase's cells were this step and how local the particles are to the profiler
+	void UpdateGridStats();
+	// Reorders the particles along the Z-order curve of the cells they are in
+	void ReorderParticles();
+
+	/**
+	 * Picks a cell size from the particle radii and how densely the particles fill the screen. Cells are never
+	 * smaller than the largest particle so the collision solver can colour them
+	 * @returns int The cell size in pixels
+	 */
+	int ChooseCellSize();
+
+	/**
+	 * Rebuilds every broad phase with a new cell size. Only call this between steps
+	 * @param _cellSize int The cell size in pixels
+	 */
+	void SetCellSize(int _cellSize);
+
+	/**
+	 * Tunes the cell size again if it is tuned automatically and the particle count has moved far enough from
+	 * the count it was last tuned for
+	 * @param _force bool Tunes it whatever the particle count when true
+	 */
+	void TuneCellSize(bool _force);
+
+	/**
+	 * Replaces every particle with a fresh set made from the default random seed, so each run starts the same
+	 * @param _amount int Amount of particles to create
+	 */
+	void ResetParticles(int _amount);
+
+	/**
+	 * Saves every particle and the simulation state to a snapshot file
+	 * @param _outputFile const std::string& The file to write to
+	 * @returns bool Returns false if the snapshot couldn't be written
+	 */
+	bool SaveSnapshot(const std::string &_outputFile);
+
+	/**
+	 * Replaces every particle and the simulation state with a snapshot file
+	 * @param _inputFile const std::string& The file to read from
+	 * @returns bool Returns false if the snapshot couldn't be loaded, the simulation carries on as it was
+	 */
+	bool LoadSnapshot(const std::string &_inputFile);
 public:
 	Application();
 	~Application();
@@ -61,6 +218,21 @@ public:
 	// Runs the application in the Init->Update->Exit order with error checking
 	bool Run();
 
+	/**
+	 * Reads the command line options
+	 * @param _argc int The amount of arguments
+	 * @param _argv char*[] The arguments
+	 * @returns bool Returns false if the options were invalid
+	 */
+	bool ParseArguments(int _argc, char* _argv[]);
+
+	/**
+	 * Picks the radius of a new particle, spread evenly over the powers of two up to the largest radius so small
+	 * particles outnumber big ones
+	 * @returns float The radius in pixels
+	 */
+	float NextRadius();
+
 	/**
 	 * Add particles to the simulation
 	 * @param _amount int Amount of particles to add
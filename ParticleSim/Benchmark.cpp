@@ -0,0 +1,354 @@
+#include "Stdafx.h"
+#include "Benchmark.h"
+
+Benchmark::Benchmark()
+{
+	// Defaults, a geometric sweep from 1k to 64k particles
+	ParseSweep("1000:64000:*2", m_counts);
+	m_warmupSteps = 30;
+	m_steps = 120;
+
+	m_recording = false;
+	m_collisionChecksStart = 0;
+	memset(&m_current, 0, sizeof(m_current));
+	memset(m_phaseTicks, 0, sizeof(m_phaseTicks));
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+/**
+ * Reads a particle count, optionally followed by k for thousands or M for millions
+ * @param _text const std::string& The text to read, nothing else may follow the count
+ * @param _count int& Filled with the count
+ * @returns bool Returns false if the text isn't a count of at least 1
+ */
+bool Benchmark::ParseCount(const std::string &_text, int &_count)
+{
+	const char* m_start = _text.c_str();
+	char* m_end = nullptr;
+	long long m_count = strtoll(m_start, &m_end, 10);
+	if (m_end == m_start)
+	{
+		return false;
+	}
+	if (*m_end == 'k')
+	{
+		m_count *= 1000;
+		m_end++;
+	}
+	else if (*m_end == 'M')
+	{
+		m_count *= 1000000;
+		m_end++;
+	}
+	if (*m_end != '\0' || m_count < 1 || m_count > INT_MAX)
+	{
+		return false;
+	}
+
+	_count = (int)m_count;
+	return true;
+}
+
+/**
+ * Reads a sweep spec into a list of particle counts. Accepts
+ *   FROM:TO:*FACTOR  A geometric sweep, eg: 1000:1000000:*2. TO is always the last count
+ *   FROM:TO:+STEP    A linear sweep, eg: 1000:10000:+1000
+ *   A,B,C            A list of counts, eg: 1000,5000,20000
+ * Counts can end in k or M, eg: 1k:1M:*2. Counts a geometric sweep rounds to the same number are only run once
+ * @param _spec const std::string& The sweep spec
+ * @param _counts std::vector<int>& Filled with the particle counts
+ * @returns bool Returns false if the spec couldn't be read
+ */
+bool Benchmark::ParseSweep(const std::string &_spec, std::vector<int> &_counts)
+{
+	std::vector<int> m_counts;
+
+	size_t m_first = _spec.find(':');
+	if (m_first != std::string::npos)
+	{
+		// A range with a step
+		size_t m_second = _spec.find(':', m_first + 1);
+		if (m_second == std::string::npos || m_second + 1 >= _spec.size())
+		{
+			std::cerr << "A benchmark sweep range needs FROM:TO:*FACTOR or FROM:TO:+STEP\n";
+			return false;
+		}
+
+		int m_from, m_to;
+		if (!ParseCount(_spec.substr(0, m_first), m_from) || !ParseCount(_spec.substr(m_first + 1, m_second - m_first - 1), m_to))
+		{
+			std::cerr << "The ends of a benchmark sweep have to be particle counts of at least 1\n";
+			return false;
+		}
+		if (m_to < m_from)
+		{
+			std::cerr << "A benchmark sweep can't end before it starts\n";
+			return false;
+		}
+
+		std::string m_step = _spec.substr(m_second + 1);
+		const char* m_stepStart = m_step.c_str() + (m_step[0] == '*' || m_step[0] == '+' ? 1 : 0);
+		char* m_stepEnd = nullptr;
+		if (m_step[0] == '*')
+		{
+			// Geometric, multiply the count each time
+			double m_factor = strtod(m_stepStart, &m_stepEnd);
+			if (m_stepEnd == m_stepStart || *m_stepEnd != '\0' || !(m_factor > 1.0))
+			{
+				std::cerr << "A geometric benchmark sweep needs a factor above 1\n";
+				return false;
+			}
+
+			// A small factor rounds several steps to the same count, only run each count once
+			for (double m_count = m_from; m_count < m_to; m_count *= m_factor)
+			{
+				int m_rounded = (int)(m_count + 0.5);
+				if (m_counts.empty() || m_rounded > m_counts.back())
+				{
+					m_counts.push_back(m_rounded);
+				}
+			}
+			if (m_counts.empty() || m_to > m_counts.back())
+			{
+				m_counts.push_back(m_to);
+			}
+		}
+		else
+		{
+			// Linear, add to the count each time
+			long long m_add = strtoll(m_stepStart, &m_stepEnd, 10);
+			if (m_stepEnd == m_stepStart || *m_stepEnd != '\0' || m_add < 1)
+			{
+				std::cerr << "A linear benchmark sweep needs a step of at least 1\n";
+				return false;
+			}
+
+			for (long long m_count = m_from; m_count <= m_to; m_count += m_add)
+			{
+				m_counts.push_back((int)m_count);
+			}
+		}
+	}
+	else
+	{
+		// A list of counts
+		std::stringstream m_list(_spec);
+		std::string m_item;
+		while (std::getline(m_list, m_item, ','))
+		{
+			int m_count;
+			if (!ParseCount(m_item, m_count))
+			{
+				std::cerr << "Every count in a benchmark sweep list has to be a particle count of at least 1\n";
+				return false;
+			}
+			m_counts.push_back(m_count);
+		}
+	}
+
+	if (m_counts.empty())
+	{
+		return false;
+	}
+
+	_counts = m_counts;
+	return true;
+}
+
+/**
+ * Sets the particle counts to run from a sweep spec
+ * @param _spec const std::string& The sweep spec, see ParseSweep
+ * @returns bool Returns false if the spec couldn't be read
+ */
+bool Benchmark::SetSweep(const std::string &_spec)
+{
+	if (!ParseSweep(_spec, m_counts))
+	{
+		std::cerr << "Invalid benchmark sweep: " << _spec << "\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Adds a line describing the run to the json output
+ * @param _key const std::string& The name of the value
+ * @param _value const std::string& The value
+ */
+void Benchmark::AddInfo(const std::string &_key, const std::string &_value)
+{
+	m_info.push_back(std::make_pair(_key, _value));
+}
+
+/**
+ * Starts measuring a particle count
+ * @param _particleCount int The particle count being measured
+ * @param _collisionChecks long long The profiler's collision check total before measuring
+ */
+void Benchmark::BeginCount(int _particleCount, long long _collisionChecks)
+{
+	memset(&m_current, 0, sizeof(m_current));
+	m_current.m_particleCount = _particleCount;
+	m_current.m_minStepSeconds = 1e30;
+	memset(m_phaseTicks, 0, sizeof(m_phaseTicks));
+
+	m_collisionChecksStart = _collisionChecks;
+	m_recording = true;
+}
+
+/**
+ * Finishes measuring the current particle count and stores its results
+ * @param _collisionChecks long long The profiler's collision check total after measuring
+ */
+void Benchmark::EndCount(long long _collisionChecks)
+{
+	m_recording = false;
+
+	double m_frequency = (double)SDL_GetPerformanceFrequency();
+	for (int i = 0; i < BENCHMARK_PHASE_COUNT; i++)
+	{
+		m_current.m_phaseSeconds[i] = m_phaseTicks[i] / m_frequency;
+	}
+	m_current.m_collisionChecks = _collisionChecks - m_collisionChecksStart;
+	if (m_current.m_steps == 0)
+	{
+		m_current.m_minStepSeconds = 0.0;
+	}
+
+	m_results.push_back(m_current);
+}
+
+/**
+ * Adds time spent in a phase to the count being measured. Ignored while not measuring
+ * @param _phase BenchmarkPhase The phase the time was spent in
+ * @param _ticks Uint64 The time spent in performance counter ticks
+ */
+void Benchmark::AddPhaseTime(BenchmarkPhase _phase, Uint64 _ticks)
+{
+	// The phases of a step run one after another, so only one thread adds to a phase at a time
+	if (m_recording)
+	{
+		m_phaseTicks[_phase] += _ticks;
+	}
+}
+
+/**
+ * Adds a whole step to the count being measured. Ignored while not measuring
+ * @param _ticks Uint64 The time the step took in performance counter ticks
+ */
+void Benchmark::AddStepTime(Uint64 _ticks)
+{
+	if (!m_recording)
+	{
+		return;
+	}
+
+	double m_seconds = (double)_ticks / SDL_GetPerformanceFrequency();
+	m_current.m_steps++;
+	m_current.m_stepSeconds += m_seconds;
+	m_current.m_minStepSeconds = std::min(m_current.m_minStepSeconds, m_seconds);
+	m_current.m_maxStepSeconds = std::max(m_current.m_maxStepSeconds, m_seconds);
+}
+
+/**
+ * Writes the results to a csv and a json file
+ * @param _baseName const std::string& The file name to write to, without an extension
+ * @returns bool Returns false if either file couldn't be written
+ */
+bool Benchmark::Export(const std::string &_baseName)
+{
+	bool m_success = true;
+
+	// One row per particle count, times are milliseconds per step
+	std::ofstream m_csv(_baseName + ".csv", std::ios::out | std::ios::trunc);
+	if (m_csv.is_open())
+	{
+		m_csv << "particle_count,steps,step_ms,min_step_ms,max_step_ms";
+		for (int i = 0; i < BENCHMARK_PHASE_COUNT; i++)
+		{
+			m_csv << "," << GetPhaseName((BenchmarkPhase)i) << "_ms";
+		}
+		m_csv << ",collision_checks_per_step,steps_per_second\n";
+
+		for (unsigned int r = 0; r < m_results.size(); r++)
+		{
+			const Result &m_result = m_results[r];
+			double m_steps = m_result.m_steps > 0 ? m_result.m_steps : 1;
+
+			m_csv << m_result.m_particleCount << "," << m_result.m_steps << "," << m_result.m_stepSeconds * 1000.0 / m_steps << ","
+				<< m_result.m_minStepSeconds * 1000.0 << "," << m_result.m_maxStepSeconds * 1000.0;
+			for (int i = 0; i < BENCHMARK_PHASE_COUNT; i++)
+			{
+				m_csv << "," << m_result.m_phaseSeconds[i] * 1000.0 / m_steps;
+			}
+			m_csv << "," << (long long)(m_result.m_collisionChecks / m_steps) << ","
+				<< (m_result.m_stepSeconds > 0.0 ? m_result.m_steps / m_result.m_stepSeconds : 0.0) << "\n";
+		}
+		m_csv.close();
+	}
+	else
+	{
+		std::cerr << "Failed to open output file for the benchmark csv\n";
+		m_success = false;
+	}
+
+	// The same results with the description of the run
+	std::ofstream m_json(_baseName + ".json", std::ios::out | std::ios::trunc);
+	if (m_json.is_open())
+	{
+		m_json << "{\n";
+		m_json << "\t\"info\": {\n";
+		for (unsigned int i = 0; i < m_info.size(); i++)
+		{
+			m_json << "\t\t\"" << m_info[i].first << "\": \"" << m_info[i].second << "\"" << (i + 1 < m_info.size() ? "," : "") << "\n";
+		}
+		m_json << "\t},\n";
+		m_json << "\t\"warmupSteps\": " << m_warmupSteps << ",\n";
+		m_json << "\t\"steps\": " << m_steps << ",\n";
+		m_json << "\t\"results\": [\n";
+
+		for (unsigned int r = 0; r < m_results.size(); r++)
+		{
+			const Result &m_result = m_results[r];
+			double m_steps = m_result.m_steps > 0 ? m_result.m_steps : 1;
+
+			m_json << "\t\t{ \"particleCount\": " << m_result.m_particleCount << ", \"steps\": " << m_result.m_steps
+				<< ", \"stepMs\": " << m_result.m_stepSeconds * 1000.0 / m_steps
+				<< ", \"minStepMs\": " << m_result.m_minStepSeconds * 1000.0
+				<< ", \"maxStepMs\": " << m_result.m_maxStepSeconds * 1000.0 << ", \"phasesMs\": { ";
+			for (int i = 0; i < BENCHMARK_PHASE_COUNT; i++)
+			{
+				m_json << (i > 0 ? ", " : "") << "\"" << GetPhaseName((BenchmarkPhase)i) << "\": " << m_result.m_phaseSeconds[i] * 1000.0 / m_steps;
+			}
+			m_json << " }, \"collisionChecksPerStep\": " << (long long)(m_result.m_collisionChecks / m_steps) << " }"
+				<< (r + 1 < m_results.size() ? "," : "") << "\n";
+		}
+
+		m_json << "\t]\n";
+		m_json << "}\n";
+		m_json.close();
+	}
+	else
+	{
+		std::cerr << "Failed to open output file for the benchmark json\n";
+		m_success = false;
+	}
+
+	return m_success;
+}
+
+// Returns a phase's name as written to the output files
+const char* Benchmark::GetPhaseName(BenchmarkPhase _phase)
+{
+	switch (_phase)
+	{
+		case BENCHMARK_PHASE_REBUILD: return "rebuild";
+		case BENCHMARK_PHASE_COLLISION: return "collision";
+		case BENCHMARK_PHASE_INTEGRATION: return "integration";
+		case BENCHMARK_PHASE_RENDER: return "render";
+		default: return "unknown";
+	}
+}
@@ -0,0 +1,138 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+// The phases of a step the benchmark times separately
+enum BenchmarkPhase
+{
+	BENCHMARK_PHASE_REBUILD, // Clearing and rebuilding the broad phase
+	BENCHMARK_PHASE_COLLISION, // The collision pass
+	BENCHMARK_PHASE_INTEGRATION, // The integration pass
+	BENCHMARK_PHASE_RENDER, // Drawing and presenting the particles, 0 for headless runs
+	BENCHMARK_PHASE_COUNT
+};
+
+/**
+ * Records a scripted sweep over particle counts. Each count is warmed up and then run for a fixed amount of
+ * steps, timing each phase of the step. The results are written as csv and json so runs from different builds
+ * can be diffed.
+ */
+class Benchmark
+{
+private:
+	// The results for one particle count
+	struct Result
+	{
+		int m_particleCount;
+		int m_steps;
+		// The total time spent in each phase in seconds
+		double m_phaseSeconds[BENCHMARK_PHASE_COUNT];
+		// The total, quickest and slowest step times in seconds
+		double m_stepSeconds;
+		double m_minStepSeconds;
+		double m_maxStepSeconds;
+		// The amount of collision checks made while measuring
+		long long m_collisionChecks;
+	};
+
+	// The particle counts to run, in order
+	std::vector<int> m_counts;
+	// The amount of unmeasured steps run before measuring each count
+	int m_warmupSteps;
+	// The amount of measured steps run at each count
+	int m_steps;
+	// Describes the run, eg: the thread count and broad phase, written to the json
+	std::vector<std::pair<std::string, std::string>> m_info;
+
+	// The results of every count finished so far
+	std::vector<Result> m_results;
+	// The count being measured
+	Result m_current;
+	// True while the steps are being measured
+	bool m_recording;
+	// The collision check total when measuring started
+	long long m_collisionChecksStart;
+	// The performance counter ticks spent in each phase of the count being measured
+	Uint64 m_phaseTicks[BENCHMARK_PHASE_COUNT];
+
+	/**
+	 * Reads a particle count, optionally followed by k for thousands or M for millions
+	 * @param _text const std::string& The text to read, nothing else may follow the count
+	 * @param _count int& Filled with the count
+	 * @returns bool Returns false if the text isn't a count of at least 1
+	 */
+	static bool ParseCount(const std::string &_text, int &_count);
+public:
+	Benchmark();
+	~Benchmark();
+
+	/**
+	 * Reads a sweep spec into a list of particle counts. Accepts
+	 *   FROM:TO:*FACTOR  A geometric sweep, eg: 1000:1000000:*2. TO is always the last count
+	 *   FROM:TO:+STEP    A linear sweep, eg: 1000:10000:+1000
+	 *   A,B,C            A list of counts, eg: 1000,5000,20000
+	 * Counts can end in k or M, eg: 1k:1M:*2. Counts a geometric sweep rounds to the same number are only run once
+	 * @param _spec const std::string& The sweep spec
+	 * @param _counts std::vector<int>& Filled with the particle counts
+	 * @returns bool Returns false if the spec couldn't be read
+	 */
+	static bool ParseSweep(const std::string &_spec, std::vector<int> &_counts);
+
+	/**
+	 * Sets the particle counts to run from a sweep spec
+	 * @param _spec const std::string& The sweep spec, see ParseSweep
+	 * @returns bool Returns false if the spec couldn't be read
+	 */
+	bool SetSweep(const std::string &_spec);
+
+	/**
+	 * Adds a line describing the run to the json output
+	 * @param _key const std::string& The name of the value
+	 * @param _value const std::string& The value
+	 */
+	void AddInfo(const std::string &_key, const std::string &_value);
+
+	/**
+	 * Starts measuring a particle count
+	 * @param _particleCount int The particle count being measured
+	 * @param _collisionChecks long long The profiler's collision check total before measuring
+	 */
+	void BeginCount(int _particleCount, long long _collisionChecks);
+
+	/**
+	 * Finishes measuring the current particle count and stores its results
+	 * @param _collisionChecks long long The profiler's collision check total after measuring
+	 */
+	void EndCount(long long _collisionChecks);
+
+	/**
+	 * Adds time spent in a phase to the count being measured. Ignored while not measuring
+	 * @param _phase BenchmarkPhase The phase the time was spent in
+	 * @param _ticks Uint64 The time spent in performance counter ticks
+	 */
+	void AddPhaseTime(BenchmarkPhase _phase, Uint64 _ticks);
+
+	/**
+	 * Adds a whole step to the count being measured. Ignored while not measuring
+	 * @param _ticks Uint64 The time the step took in performance counter ticks
+	 */
+	void AddStepTime(Uint64 _ticks);
+
+	/**
+	 * Writes the results to a csv and a json file
+	 * @param _baseName const std::string& The file name to write to, without an extension
+	 * @returns bool Returns false if either file couldn't be written
+	 */
+	bool Export(const std::string &_baseName);
+
+	// Setters
+	void SetWarmupSteps(int _steps) { m_warmupSteps = _steps; }
+	void SetSteps(int _steps) { m_steps = _steps; }
+
+	// Getters
+	const std::vector<int>& GetCounts() { return m_counts; }
+	int GetWarmupSteps() { return m_warmupSteps; }
+	int GetSteps() { return m_steps; }
+	// Returns a phase's name as written to the output files
+	static const char* GetPhaseName(BenchmarkPhase _phase);
+};
+#endif // !_BENCHMARK_H_
@@ -0,0 +1,131 @@
+#include "Stdafx.h"
+#include "CellGrid.h"
+
+CellGrid::CellGrid(int _screenWidth, int _screenHeight, int _cellSize)
+{
+	// Setup the grid parameters
+	m_screenWidth = _screenWidth;
+	m_screenHeight = _screenHeight;
+	m_cellSize = _cellSize;
+
+	// Round up so the cells always cover the whole screen
+	m_tableColumns = (_screenWidth + _cellSize - 1) / _cellSize;
+	m_tableRows = (_screenHeight + _cellSize - 1) / _cellSize;
+
+	m_tableSize = m_tableColumns * m_tableRows;
+
+	// The cell arrays never change size so allocate them once here
+	m_cellStart.assign(m_tableSize + 1, 0);
+	m_cellCursor.assign(m_tableSize, 0);
+
+	m_maxRadius = 0.0f;
+}
+
+CellGrid::~CellGrid()
+{
+}
+
+/**
+ * Clears the cell counts ready for the next rebuild
+ */
+void CellGrid::Clear()
+{
+	std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
+	m_maxRadius = 0.0f;
+}
+
+/**
+ * Rebuilds the grid from the current particle positions using a counting sort. The grid must have been
+ * cleared first. Allocation free once the arrays have grown to the particle count
+ * @param _particles ParticleStore& The particles to bin into the grid
+ */
+void CellGrid::Rebuild(ParticleStore &_particles)
+{
+	int m_count = _particles.Size();
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_radius = _particles.Radius();
+
+	// resize only reallocates when the particle count grows past what we have seen before
+	m_particleCell.resize(m_count);
+	m_sortedIndices.resize(m_count);
+
+	// Pass 1: count the particles in each cell
+	for (int i = 0; i < m_count; i++)
+	{
+		int m_cell = CellColumn(m_x[i]) + CellRow(m_y[i]) * m_tableColumns;
+		m_particleCell[i] = m_cell;
+		m_cellStart[m_cell + 1]++;
+
+		if (m_radius[i] > m_maxRadius)
+		{
+			m_maxRadius = m_radius[i];
+		}
+	}
+
+	// Prefix sum the counts so each cell knows where its run starts
+	for (int c = 0; c < m_tableSize; c++)
+	{
+		m_cellStart[c + 1] += m_cellStart[c];
+		m_cellCursor[c] = m_cellStart[c];
+	}
+
+	// Pass 2: scatter the particle indices into their cells. Walking the particles in order keeps each cell
+	// sorted by index, so the result is deterministic
+	for (int i = 0; i < m_count; i++)
+	{
+		m_sortedIndices[m_cellCursor[m_particleCell[i]]++] = i;
+	}
+}
+
+/**
+ * Generates the cell position for a coordinate position. Positions outside of the screen are clamped
+ * into the nearest edge cell so they still take part in collision detection
+ * @param _position glm::vec2 The position of the particle on the screen eg:(235, 732)
+ * @returns int Returns the cell index of this screen position
+ */
+int CellGrid::Hash(glm::vec2 _position)
+{
+	return CellColumn(_position.x) + CellRow(_position.y) * m_tableColumns;
+}
+
+/**
+ * Measures how full the cells are. Only meaningful after the grid has been built this frame
+ * @returns GridStats The occupancy of the cells
+ */
+GridStats CellGrid::GetStats()
+{
+	GridStats m_stats = { m_cellSize, m_tableSize, 0, 0, 0.0f };
+	for (int c = 0; c < m_tableSize; c++)
+	{
+		int m_occupancy = m_cellStart[c + 1] - m_cellStart[c];
+		if (m_occupancy > 0)
+		{
+			m_stats.m_occupiedCells++;
+			m_stats.m_maxOccupancy = std::max(m_stats.m_maxOccupancy, m_occupancy);
+		}
+	}
+	m_stats.m_meanOccupancy = (m_stats.m_occupiedCells > 0 ? (float)m_cellStart[m_tableSize] / m_stats.m_occupiedCells : 0.0f);
+
+	return m_stats;
+}
+
+/**
+* Draws the cell boundaries for debugging purposes
+* @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+*/
+void CellGrid::DrawCellLines(SDL_Renderer* _renderer)
+{
+	SDL_SetRenderDrawColor(_renderer, 43, 206, 239, 255);
+	// Draw column lines
+	for (int i = 0; i < m_tableColumns; i++)
+	{
+		SDL_RenderDrawLine(_renderer, i * m_cellSize, 0, i * m_cellSize, m_screenHeight);
+	}
+
+	// Draw row lines
+	for (int i = 0; i < m_tableRows; i++)
+	{
+		SDL_RenderDrawLine(_renderer, 0, i * m_cellSize, m_screenWidth, i * m_cellSize);
+	}
+}
@@ -0,0 +1,111 @@
+#ifndef _CELLGRID_H_
+#define _CELLGRID_H_
+/**
+ * Uniform grid broad phase built with a counting sort. Every frame the grid is rebuilt in two passes: the
+ * particles are counted per cell, the counts are prefix summed into a flat cellStart array and then the
+ * particle indices are scattered into one sorted index array. The particles in cell c are therefore
+ * m_sortedIndices[m_cellStart[c]] to m_sortedIndices[m_cellStart[c + 1] - 1], a contiguous run.
+ * Each particle is binned by its centre into exactly one cell, so neighbour queries widen their search by the
+ * largest particle radius instead of inserting particles into every cell they touch.
+ */
+class ParticleStore;
+class CellGrid
+{
+private:
+	// Screen width and cell size passed through in the constructor
+	int m_screenWidth, m_screenHeight;
+	int m_cellSize;
+
+	// Grid columns, rows and size
+	int m_tableColumns, m_tableRows;
+	int m_tableSize;
+
+	// Start offset of each cell into the sorted index array. Holds m_tableSize + 1 entries so the last cell has an end
+	std::vector<int> m_cellStart;
+	// Write cursor for each cell used while scattering
+	std::vector<int> m_cellCursor;
+	// The cell each particle was binned into during the last rebuild
+	std::vector<int> m_particleCell;
+	// Particle indices sorted by cell
+	std::vector<int> m_sortedIndices;
+
+	// The largest particle radius seen during the last rebuild
+	float m_maxRadius;
+public:
+	// Constructor for the cell grid
+	CellGrid(int _screenWidth, int _screenHeight, int _cellSize);
+	~CellGrid();
+
+	/**
+	 * Clears the cell counts ready for the next rebuild
+	 */
+	void Clear();
+
+	/**
+	 * Rebuilds the grid from the current particle positions using a counting sort. The grid must have been
+	 * cleared first. Allocation free once the arrays have grown to the particle count
+	 * @param _particles ParticleStore& The particles to bin into the grid
+	 */
+	void Rebuild(ParticleStore &_particles);
+
+	/**
+	 * Generates the cell position for a coordinate position. Positions outside of the screen are clamped
+	 * into the nearest edge cell so they still take part in collision detection
+	 * @param _position glm::vec2 The position of the particle on the screen eg:(235, 732)
+	 * @returns int Returns the cell index of this screen position
+	 */
+	int Hash(glm::vec2 _position);
+
+	/**
+	 * Calls a function for every particle index in the cells the given bounds can touch. Each row of cells is
+	 * one contiguous run of the sorted index array, so the walk never allocates
+	 * @param _position glm::vec2 The position to use as the search case
+	 * @param _radius float The radius to use as the search case
+	 * @param _function Function Called as _function(int _index) for each particle found
+	 */
+	template <typename Function>
+	void ForEachNeighbour(glm::vec2 _position, float _radius, Function _function)
+	{
+		// Particles are binned by their centre, so widen the search by the largest radius
+		float m_reach = _radius + m_maxRadius;
+		int m_columnMin = CellColumn(_position.x - m_reach);
+		int m_columnMax = CellColumn(_position.x + m_reach);
+		int m_rowMin = CellRow(_position.y - m_reach);
+		int m_rowMax = CellRow(_position.y + m_reach);
+
+		for (int m_row = m_rowMin; m_row <= m_rowMax; m_row++)
+		{
+			int m_rowStart = m_row * m_tableColumns;
+			int m_end = m_cellStart[m_rowStart + m_columnMax + 1];
+
+			for (int k = m_cellStart[m_rowStart + m_columnMin]; k < m_end; k++)
+			{
+				_function(m_sortedIndices[k]);
+			}
+		}
+	}
+
+	/**
+	 * Measures how full the cells are. Only meaningful after the grid has been built this frame
+	 * @returns GridStats The occupancy of the cells
+	 */
+	GridStats GetStats();
+
+	/**
+	 * Draws the cell boundaries for debugging purposes
+	 * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+	 */
+	void DrawCellLines(SDL_Renderer* _renderer);
+
+	/** Getters **/
+	int GetSize() { return m_tableSize; }
+	int GetColumns() { return m_tableColumns; }
+	int GetRows() { return m_tableRows; }
+	int GetCellSize() { return m_cellSize; }
+	float GetMaxRadius() { return m_maxRadius; }
+	int* GetCellStart() { return m_cellStart.data(); }
+	int* GetSortedIndices() { return m_sortedIndices.data(); }
+	int CellColumn(float _x) { int m_column = (int)floorf(_x / m_cellSize); return (m_column < 0 ? 0 : (m_column >= m_tableColumns ? m_tableColumns - 1 : m_column)); }
+	int CellRow(float _y) { int m_row = (int)floorf(_y / m_cellSize); return (m_row < 0 ? 0 : (m_row >= m_tableRows ? m_tableRows - 1 : m_row)); }
+};
+#endif // !_CELLGRID_H_
@@ -0,0 +1,90 @@
+#include "Stdafx.h"
+#include "CollisionKernel.h"
+
+// Pick the widest instruction set the build targets. MSVC only defines __AVX__/__AVX2__ with /arch:AVX or
+// /arch:AVX2, and always has SSE2 on x64
+#if defined(__AVX__) || defined(__AVX2__)
+#define COLLISIONKERNEL_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COLLISIONKERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+/**
+ * Tests a particle against a block of candidates
+ * @param _x float The x position of the particle
+ * @param _y float The y position of the particle
+ * @param _radius float The radius of the particle
+ * @param _blockX const float* The x positions of the candidates, BLOCK_SIZE entries
+ * @param _blockY const float* The y positions of the candidates, BLOCK_SIZE entries
+ * @param _blockRadius const float* The radii of the candidates, BLOCK_SIZE entries
+ * @param _count int The amount of entries in the block that are real candidates
+ * @returns int A bit mask with bit n set when candidate n overlaps the particle
+ */
+int CollisionKernel::TestBlock(float _x, float _y, float _radius, const float* _blockX, const float* _blockY,
+	const float* _blockRadius, int _count)
+{
+	// Only report lanes holding real candidates, whatever is left over in the rest of the block
+	int m_validLanes = (1 << _count) - 1;
+
+#if defined(COLLISIONKERNEL_AVX)
+	// All 8 candidates in one register
+	__m256 m_diffX = _mm256_sub_ps(_mm256_set1_ps(_x), _mm256_loadu_ps(_blockX));
+	__m256 m_diffY = _mm256_sub_ps(_mm256_set1_ps(_y), _mm256_loadu_ps(_blockY));
+	__m256 m_combinedRadii = _mm256_add_ps(_mm256_set1_ps(_radius), _mm256_loadu_ps(_blockRadius));
+
+	__m256 m_distanceSquared = _mm256_add_ps(_mm256_mul_ps(m_diffX, m_diffX), _mm256_mul_ps(m_diffY, m_diffY));
+	__m256 m_radiiSquared = _mm256_mul_ps(m_combinedRadii, m_combinedRadii);
+
+	return _mm256_movemask_ps(_mm256_cmp_ps(m_distanceSquared, m_radiiSquared, _CMP_LT_OQ)) & m_validLanes;
+#elif defined(COLLISIONKERNEL_SSE2)
+	// Two halves of 4 candidates
+	int m_hits = 0;
+	__m128 m_x = _mm_set1_ps(_x);
+	__m128 m_y = _mm_set1_ps(_y);
+	__m128 m_radius = _mm_set1_ps(_radius);
+
+	for (int m_half = 0; m_half < BLOCK_SIZE; m_half += 4)
+	{
+		__m128 m_diffX = _mm_sub_ps(m_x, _mm_loadu_ps(_blockX + m_half));
+		__m128 m_diffY = _mm_sub_ps(m_y, _mm_loadu_ps(_blockY + m_half));
+		__m128 m_combinedRadii = _mm_add_ps(m_radius, _mm_loadu_ps(_blockRadius + m_half));
+
+		__m128 m_distanceSquared = _mm_add_ps(_mm_mul_ps(m_diffX, m_diffX), _mm_mul_ps(m_diffY, m_diffY));
+		__m128 m_radiiSquared = _mm_mul_ps(m_combinedRadii, m_combinedRadii);
+
+		m_hits |= _mm_movemask_ps(_mm_cmplt_ps(m_distanceSquared, m_radiiSquared)) << m_half;
+	}
+
+	return m_hits & m_validLanes;
+#else
+	// Scalar fallback doing the same sums one candidate at a time
+	int m_hits = 0;
+	for (int i = 0; i < _count; i++)
+	{
+		float m_diffX = _x - _blockX[i];
+		float m_diffY = _y - _blockY[i];
+		float m_combinedRadii = _radius + _blockRadius[i];
+
+		if (m_diffX * m_diffX + m_diffY * m_diffY < m_combinedRadii * m_combinedRadii)
+		{
+			m_hits |= 1 << i;
+		}
+	}
+
+	return m_hits & m_validLanes;
+#endif
+}
+
+// Returns the name of the instruction set the kernel was built with
+const char* CollisionKernel::GetInstructionSet()
+{
+#if defined(COLLISIONKERNEL_AVX)
+	return "AVX";
+#elif defined(COLLISIONKERNEL_SSE2)
+	return "SSE2";
+#else
+	return "Scalar";
+#endif
+}
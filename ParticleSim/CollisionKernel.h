@@ -0,0 +1,32 @@
+#ifndef _COLLISIONKERNEL_H_
+#define _COLLISIONKERNEL_H_
+/**
+ * Narrow phase test of one particle against a block of up to 8 candidate particles at once. The candidates
+ * are gathered into small structure-of-arrays blocks and compared by squared distance against their squared
+ * combined radii, so no square root is taken for the pairs that don't collide. Uses AVX when the build targets
+ * it, SSE2 otherwise and plain scalar code as a fallback. Every version gives the same answer.
+ */
+class CollisionKernel
+{
+public:
+	// The amount of candidates tested in one block
+	static const int BLOCK_SIZE = 8;
+
+	/**
+	 * Tests a particle against a block of candidates
+	 * @param _x float The x position of the particle
+	 * @param _y float The y position of the particle
+	 * @param _radius float The radius of the particle
+	 * @param _blockX const float* The x positions of the candidates, BLOCK_SIZE entries
+	 * @param _blockY const float* The y positions of the candidates, BLOCK_SIZE entries
+	 * @param _blockRadius const float* The radii of the candidates, BLOCK_SIZE entries
+	 * @param _count int The amount of entries in the block that are real candidates
+	 * @returns int A bit mask with bit n set when candidate n overlaps the particle
+	 */
+	static int TestBlock(float _x, float _y, float _radius, const float* _blockX, const float* _blockY,
+		const float* _blockRadius, int _count);
+
+	// Returns the name of the instruction set the kernel was built with
+	static const char* GetInstructionSet();
+};
+#endif // !_COLLISIONKERNEL_H_
@@ -0,0 +1,289 @@
+#include "Stdafx.h"
+#include "CollisionSolver.h"
+
+/**
+ * Constructs a collision solver
+ * @param _jobs JobSystem* The job system to solve across
+ * @param _profiler FPSProfiler* The profiler used to count the pairs tested and the contacts found
+ */
+CollisionSolver::CollisionSolver(JobSystem* _jobs, FPSProfiler* _profiler)
+{
+	m_jobs = _jobs;
+	m_profiler = _profiler;
+}
+
+CollisionSolver::~CollisionSolver()
+{
+}
+
+/**
+ * Runs the collision pass over every particle in the grid
+ * @param _particles ParticleStore& The particles to solve
+ * @param _grid CellGrid& The grid the particles were binned into, rebuilt this frame
+ */
+void CollisionSolver::Solve(ParticleStore &_particles, CellGrid &_grid)
+{
+	// Colouring relies on every contact being between neighbouring cells, which only holds while the largest
+	// particle fits in a cell. Otherwise fall back to the serial pass
+	if (_grid.GetMaxRadius() * 2.0f > _grid.GetCellSize())
+	{
+		_particles.SolveCollisions(_grid);
+		return;
+	}
+
+	for (int m_colour = 0; m_colour < COLOUR_COLUMNS * COLOUR_ROWS; m_colour++)
+	{
+		ScopedZone m_zone("SolveColour");
+
+		// The first cell of this colour
+		int m_columnOffset = m_colour % COLOUR_COLUMNS;
+		int m_rowOffset = m_colour / COLOUR_COLUMNS;
+
+		// The amount of cells of this colour along each axis
+		int m_columns = (_grid.GetColumns() - m_columnOffset + COLOUR_COLUMNS - 1) / COLOUR_COLUMNS;
+		int m_rows = (_grid.GetRows() - m_rowOffset + COLOUR_ROWS - 1) / COLOUR_ROWS;
+
+		// Every cell of this colour can be solved at the same time
+		m_jobs->ParallelFor(0, m_columns * m_rows, CELLS_PER_JOB, [&](int _begin, int _end)
+		{
+			CollisionCounts m_counts = { 0, 0, 0 };
+			for (int k = _begin; k < _end; k++)
+			{
+				SolveCell(_particles, _grid, m_columnOffset + (k % m_columns) * COLOUR_COLUMNS,
+					m_rowOffset + (k / m_columns) * COLOUR_ROWS, m_counts);
+			}
+			m_profiler->AddCollisionCounts(m_counts);
+		});
+	}
+}
+
+/**
+ * Runs the collision pass over every particle in a sparse grid
+ * @param _particles ParticleStore& The particles to solve
+ * @param _grid SparseHashGrid& The grid the particles were binned into, rebuilt this frame
+ */
+void CollisionSolver::Solve(ParticleStore &_particles, SparseHashGrid &_grid)
+{
+	// The same rule as the dense grid, colouring only holds while the largest particle fits in a cell
+	if (_grid.GetMaxRadius() * 2.0f > _grid.GetCellSize())
+	{
+		_particles.SolveCollisions(_grid);
+		return;
+	}
+
+	int* m_colourCells = _grid.GetColourCells();
+	for (int m_colour = 0; m_colour < COLOUR_COLUMNS * COLOUR_ROWS; m_colour++)
+	{
+		ScopedZone m_zone("SolveColour");
+
+		// Every occupied cell of this colour can be solved at the same time
+		m_jobs->ParallelFor(_grid.GetColourStart(m_colour), _grid.GetColourStart(m_colour + 1), CELLS_PER_JOB, [&](int _begin, int _end)
+		{
+			CollisionCounts m_counts = { 0, 0, 0 };
+			for (int k = _begin; k < _end; k++)
+			{
+				SolveSparseCell(_particles, _grid, m_colourCells[k], m_counts);
+			}
+			m_profiler->AddCollisionCounts(m_counts);
+		});
+	}
+}
+
+/**
+ * Responds to every pair a sweep and prune found, in the order it swept them
+ * @param _particles ParticleStore& The particles to solve
+ * @param _sweep SweepAndPrune& The broad phase holding every particle, swept for pairs this frame
+ */
+void CollisionSolver::Solve(ParticleStore &_particles, SweepAndPrune &_sweep)
+{
+	SolvePairs(_particles, _sweep, _sweep.GetOverlaps());
+}
+
+/**
+ * Responds to every pair a dynamic AABB tree found, in particle order
+ * @param _particles ParticleStore& The particles to solve
+ * @param _tree DynamicAABBTree& The broad phase holding every particle, searched for pairs this frame
+ */
+void CollisionSolver::Solve(ParticleStore &_particles, DynamicAABBTree &_tree)
+{
+	SolvePairs(_particles, _tree, _tree.GetCandidates());
+}
+
+/**
+ * Solves every particle in one cell against the rest of its cell and the cells east, south west, south and
+ * south east of it
+ * @param _particles ParticleStore& The particles to solve
+ * @param _grid CellGrid& The grid the particles were binned into
+ * @param _column int The column of the cell
+ * @param _row int The row of the cell
+ * @param _counts CollisionCounts& Counts the pairs tested and the contacts found
+ */
+void CollisionSolver::SolveCell(ParticleStore &_particles, CellGrid &_grid, int _column, int _row, CollisionCounts &_counts)
+{
+	int* m_cellStart = _grid.GetCellStart();
+	int* m_sortedIndices = _grid.GetSortedIndices();
+	int m_tableColumns = _grid.GetColumns();
+
+	// The rest of this cell and the cell east of it follow each other in the sorted index array
+	int m_cell = _column + _row * m_tableColumns;
+	int m_eastEnd = m_cellStart[_column + 1 < m_tableColumns ? m_cell + 2 : m_cell + 1];
+
+	// So do the south west, south and south east cells in the row below, clamped to the grid. This is
+	// deliberately based on the cell rather than the particle positions so a cell never writes outside of its block
+	int m_southBegin = 0;
+	int m_southEnd = 0;
+	if (_row + 1 < _grid.GetRows())
+	{
+		int m_rowStart = (_row + 1) * m_tableColumns;
+		m_southBegin = m_cellStart[m_rowStart + std::max(_column - 1, 0)];
+		m_southEnd = m_cellStart[m_rowStart + std::min(_column + 1, m_tableColumns - 1) + 1];
+	}
+
+	CandidateBlock m_block;
+	m_block.m_count = 0;
+
+	for (int a = m_cellStart[m_cell]; a < m_cellStart[m_cell + 1]; a++)
+	{
+		int i = m_sortedIndices[a];
+
+		// Particles earlier in this cell were already tested against this one, and the cells north and west
+		// test their particles against this cell
+		for (int b = a + 1; b < m_eastEnd; b++)
+		{
+			AddCandidate(_particles, i, m_sortedIndices[b], m_block, _counts);
+		}
+		for (int b = m_southBegin; b < m_southEnd; b++)
+		{
+			AddCandidate(_particles, i, m_sortedIndices[b], m_block, _counts);
+		}
+		// Each candidate is a pair of its own, so every one of them gets exactly one distance test
+		_counts.m_candidates += m_eastEnd - a - 1 + m_southEnd - m_southBegin;
+		_counts.m_distanceTests += m_eastEnd - a - 1 + m_southEnd - m_southBegin;
+
+		// Test whatever is left over for this particle
+		if (m_block.m_count > 0)
+		{
+			ResolveBlock(_particles, i, m_block, _counts);
+		}
+	}
+}
+
+/**
+ * Gathers a candidate into a particle's block, testing the block once it is full
+ * @param _particles ParticleStore& The particles to solve
+ * @param _particle int The index of the particle
+ * @param _candidate int The index of the candidate
+ * @param _block CandidateBlock& The block to gather into
+ * @param _counts CollisionCounts& Counts the contacts found if the block is tested
+ */
+void CollisionSolver::AddCandidate(ParticleStore &_particles, int _particle, int _candidate, CandidateBlock &_block, CollisionCounts &_counts)
+{
+	_block.m_x[_block.m_count] = _particles.X()[_candidate];
+	_block.m_y[_block.m_count] = _particles.Y()[_candidate];
+	_block.m_radius[_block.m_count] = _particles.Radius()[_candidate];
+	_block.m_index[_block.m_count] = _candidate;
+	if (++_block.m_count == CollisionKernel::BLOCK_SIZE)
+	{
+		ResolveBlock(_particles, _particle, _block, _counts);
+	}
+}
+
+/**
+ * Tests a particle against a block of candidates and responds to every collision, in candidate order
+ * @param _particles ParticleStore& The particles to solve
+ * @param _particle int The index of the particle
+ * @param _block CandidateBlock& The candidates to test, emptied afterwards
+ * @param _counts CollisionCounts& Counts the contacts found
+ */
+void CollisionSolver::ResolveBlock(ParticleStore &_particles, int _particle, CandidateBlock &_block, CollisionCounts &_counts)
+{
+	int m_hits = CollisionKernel::TestBlock(_particles.X()[_particle], _particles.Y()[_particle],
+		_particles.Radius()[_particle], _block.m_x, _block.m_y, _block.m_radius, _block.m_count);
+
+	for (int k = 0; k < _block.m_count; k++)
+	{
+		if (m_hits & (1 << k))
+		{
+			// A response moves the particle, which makes the rest of the block's results stale. Test the rest
+			// one at a time against the new position so the result is the same as checking each pair in turn
+			if (_particles.CheckCollision(_particle, _block.m_index[k]))
+			{
+				_counts.m_contacts++;
+				for (k++; k < _block.m_count; k++)
+				{
+					if (_particles.CheckCollision(_particle, _block.m_index[k]))
+					{
+						_counts.m_contacts++;
+					}
+				}
+			}
+		}
+	}
+
+	_block.m_count = 0;
+}
+
+/**
+ * Solves every particle in one occupied cell of a sparse grid against the rest of its cell and the occupied
+ * cells east, south west, south and south east of it
+ * @param _particles ParticleStore& The particles to solve
+ * @param _grid SparseHashGrid& The grid the particles were binned into
+ * @param _cell int The number of the occupied cell
+ * @param _counts CollisionCounts& Counts the pairs tested and the contacts found
+ */
+void CollisionSolver::SolveSparseCell(ParticleStore &_particles, SparseHashGrid &_grid, int _cell, CollisionCounts &_counts)
+{
+	int* m_cellStart = _grid.GetCellStart();
+	int* m_sortedIndices = _grid.GetSortedIndices();
+
+	// Look the half of the 3x3 block after this cell up once for the whole cell, in the same order as the dense grid
+	int m_blockCells[4];
+	int m_blockCount = 0;
+	int m_column = _grid.GetCellX(_cell);
+	int m_row = _grid.GetCellY(_cell);
+	int m_east = _grid.Find(m_column + 1, m_row);
+	if (m_east >= 0)
+	{
+		m_blockCells[m_blockCount++] = m_east;
+	}
+	for (int m_southColumn = m_column - 1; m_southColumn <= m_column + 1; m_southColumn++)
+	{
+		int m_south = _grid.Find(m_southColumn, m_row + 1);
+		if (m_south >= 0)
+		{
+			m_blockCells[m_blockCount++] = m_south;
+		}
+	}
+
+	CandidateBlock m_block;
+	m_block.m_count = 0;
+
+	for (int a = m_cellStart[_cell]; a < m_cellStart[_cell + 1]; a++)
+	{
+		int i = m_sortedIndices[a];
+
+		// Particles earlier in this cell were already tested against this one
+		for (int b = a + 1; b < m_cellStart[_cell + 1]; b++)
+		{
+			AddCandidate(_particles, i, m_sortedIndices[b], m_block, _counts);
+		}
+		_counts.m_candidates += m_cellStart[_cell + 1] - a - 1;
+		_counts.m_distanceTests += m_cellStart[_cell + 1] - a - 1;
+
+		for (int c = 0; c < m_blockCount; c++)
+		{
+			for (int b = m_cellStart[m_blockCells[c]]; b < m_cellStart[m_blockCells[c] + 1]; b++)
+			{
+				AddCandidate(_particles, i, m_sortedIndices[b], m_block, _counts);
+			}
+			_counts.m_candidates += m_cellStart[m_blockCells[c] + 1] - m_cellStart[m_blockCells[c]];
+			_counts.m_distanceTests += m_cellStart[m_blockCells[c] + 1] - m_cellStart[m_blockCells[c]];
+		}
+
+		// Test whatever is left over for this particle
+		if (m_block.m_count > 0)
+		{
+			ResolveBlock(_particles, i, m_block, _counts);
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#ifndef _COLLISIONSOLVER_H_
+#define _COLLISIONSOLVER_H_
+/**
+ * Runs the collision pass over a CellGrid across the job system. Each cell is tested against itself and half of
+ * the cells around it (east, south west, south and south east), so every pair of neighbouring cells is visited
+ * from one side and every pair of particles is tested exactly once. A collision response writes to both
+ * particles, so cells are split into 6 colours with a 3x2 checkerboard: a cell only touches particles in the 3x2
+ * block of its own row and the row below, and two cells of the same colour are 3 columns or 2 rows apart, so
+ * their blocks never overlap. Each colour is solved in parallel and the colours are solved one after another in
+ * a fixed order, which gives the same result no matter how many threads are used. A SparseHashGrid is coloured
+ * the same way by its cell coordinates, only walking the cells that hold particles. The pairs a SweepAndPrune or
+ * DynamicAABBTree finds are responded to one after another in the order it found them.
+ */
+class CollisionSolver
+{
+private:
+	// The amount of colours along each axis of the checkerboard
+	static const int COLOUR_COLUMNS = 3;
+	static const int COLOUR_ROWS = 2;
+	// The amount of cells handed to a job at once
+	static const int CELLS_PER_JOB = 8;
+
+	// The job system the colours are solved across
+	JobSystem* m_jobs;
+	// Our profiler, used to count the pairs tested and the contacts found
+	FPSProfiler* m_profiler;
+
+	// Candidates gathered for one particle, tested together by the collision kernel
+	struct CandidateBlock
+	{
+		float m_x[CollisionKernel::BLOCK_SIZE];
+		float m_y[CollisionKernel::BLOCK_SIZE];
+		float m_radius[CollisionKernel::BLOCK_SIZE];
+		int m_index[CollisionKernel::BLOCK_SIZE];
+		int m_count;
+	};
+
+	/**
+	 * Gathers a candidate into a particle's block, testing the block once it is full
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _particle int The index of the particle
+	 * @param _candidate int The index of the candidate
+	 * @param _block CandidateBlock& The block to gather into
+	 * @param _counts CollisionCounts& Counts the contacts found if the block is tested
+	 */
+	void AddCandidate(ParticleStore &_particles, int _particle, int _candidate, CandidateBlock &_block, CollisionCounts &_counts);
+
+	/**
+	 * Tests a particle against a block of candidates and responds to every collision, in candidate order
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _particle int The index of the particle
+	 * @param _block CandidateBlock& The candidates to test, emptied afterwards
+	 * @param _counts CollisionCounts& Counts the contacts found
+	 */
+	void ResolveBlock(ParticleStore &_particles, int _particle, CandidateBlock &_block, CollisionCounts &_counts);
+
+	/**
+	 * Solves every particle in one cell against the rest of its cell and the cells east, south west, south and
+	 * south east of it
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _grid CellGrid& The grid the particles were binned into
+	 * @param _column int The column of the cell
+	 * @param _row int The row of the cell
+	 * @param _counts CollisionCounts& Counts the pairs tested and the contacts found
+	 */
+	void SolveCell(ParticleStore &_particles, CellGrid &_grid, int _column, int _row, CollisionCounts &_counts);
+
+	/**
+	 * Solves every particle in one occupied cell of a sparse grid against the rest of its cell and the occupied
+	 * cells east, south west, south and south east of it
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _grid SparseHashGrid& The grid the particles were binned into
+	 * @param _cell int The number of the occupied cell
+	 * @param _counts CollisionCounts& Counts the pairs tested and the contacts found
+	 */
+	void SolveSparseCell(ParticleStore &_particles, SparseHashGrid &_grid, int _cell, CollisionCounts &_counts);
+
+	/**
+	 * Responds to every pair a broad phase collected, one after another in the order it collected them
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _broadPhase TBroadPhase& The broad phase holding the pairs, split into chunks by the jobs that found them
+	 * @param _candidates long long The candidates the broad phase looked at finding the pairs
+	 */
+	template <class TBroadPhase>
+	void SolvePairs(ParticleStore &_particles, TBroadPhase &_broadPhase, long long _candidates);
+public:
+	/**
+	 * Constructs a collision solver
+	 * @param _jobs JobSystem* The job system to solve across
+	 * @param _profiler FPSProfiler* The profiler used to count the pairs tested and the contacts found
+	 */
+	CollisionSolver(JobSystem* _jobs, FPSProfiler* _profiler);
+	~CollisionSolver();
+
+	/**
+	 * Runs the collision pass over every particle in the grid
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _grid CellGrid& The grid the particles were binned into, rebuilt this frame
+	 */
+	void Solve(ParticleStore &_particles, CellGrid &_grid);
+
+	/**
+	 * Runs the collision pass over every particle in a sparse grid
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _grid SparseHashGrid& The grid the particles were binned into, rebuilt this frame
+	 */
+	void Solve(ParticleStore &_particles, SparseHashGrid &_grid);
+
+	/**
+	 * Responds to every pair a sweep and prune found, in the order it swept them
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _sweep SweepAndPrune& The broad phase holding every particle, swept for pairs this frame
+	 */
+	void Solve(ParticleStore &_particles, SweepAndPrune &_sweep);
+
+	/**
+	 * Responds to every pair a dynamic AABB tree found, in particle order
+	 * @param _particles ParticleStore& The particles to solve
+	 * @param _tree DynamicAABBTree& The broad phase holding every particle, searched for pairs this frame
+	 */
+	void Solve(ParticleStore &_particles, DynamicAABBTree &_tree);
+};
+
+/**
+ * Responds to every pair a broad phase collected, one after another in the order it collected them
+ * @param _particles ParticleStore& The particles to solve
+ * @param _broadPhase TBroadPhase& The broad phase holding the pairs, split into chunks by the jobs that found them
+ * @param _candidates long long The candidates the broad phase looked at finding the pairs
+ */
+template <class TBroadPhase>
+void CollisionSolver::SolvePairs(ParticleStore &_particles, TBroadPhase &_broadPhase, long long _candidates)
+{
+	// Nothing keeps the pairs apart like the colours of a grid, and a response writes to both particles, so the
+	// pairs are responded to on one thread. Finding them already ran across the job system
+	CollisionCounts m_counts = { _candidates, 0, 0 };
+	for (int c = 0; c < _broadPhase.GetPairChunks(); c++)
+	{
+		const int* m_pairs = _broadPhase.GetPairs(c);
+		for (int k = 0; k < _broadPhase.GetPairCount(c); k++)
+		{
+			m_counts.m_distanceTests++;
+			if (_particles.CheckCollision(m_pairs[2 * k], m_pairs[2 * k + 1]))
+			{
+				m_counts.m_contacts++;
+			}
+		}
+	}
+	m_profiler->AddCollisionCounts(m_counts);
+}
+#endif // !_COLLISIONSOLVER_H_
@@ -0,0 +1,571 @@
+#include "Stdafx.h"
+#include "DynamicAABBTree.h"
+
+/**
+ * Constructs an empty tree
+ * @param _jobs JobSystem* The job system to search for pairs across
+ * @param _margin float How far a leaf's box reaches past its particle before its velocity is added, in pixels
+ */
+DynamicAABBTree::DynamicAABBTree(JobSystem* _jobs, float _margin)
+{
+	m_jobs = _jobs;
+	m_margin = _margin;
+
+	m_root = NULL_NODE;
+	m_freeList = NULL_NODE;
+
+	m_store = nullptr;
+	m_generation = 0;
+	m_valid = false;
+	m_pairChunks = 0;
+
+	m_skipped = 0;
+	m_reinserted = 0;
+	m_rotations = 0;
+	m_totalReinserted = 0;
+	m_candidates = 0;
+	m_visits = 0;
+}
+
+DynamicAABBTree::~DynamicAABBTree()
+{
+}
+
+/**
+ * Takes a node off the free list, or adds one if there are none
+ * @returns int The new node, a leaf with no parent
+ */
+int DynamicAABBTree::AllocateNode()
+{
+	int m_node = m_freeList;
+	if (m_node == NULL_NODE)
+	{
+		m_node = (int)m_nodes.size();
+		m_nodes.push_back(Node());
+	}
+	else
+	{
+		m_freeList = m_nodes[m_node].m_parent;
+	}
+
+	Node &m_new = m_nodes[m_node];
+	m_new.m_parent = NULL_NODE;
+	m_new.m_left = NULL_NODE;
+	m_new.m_right = NULL_NODE;
+	m_new.m_height = 0;
+	m_new.m_particle = -1;
+	return m_node;
+}
+
+/**
+ * Puts a node on the free list
+ * @param _node int The node to free
+ */
+void DynamicAABBTree::FreeNode(int _node)
+{
+	m_nodes[_node].m_parent = m_freeList;
+	m_nodes[_node].m_height = -1;
+	m_freeList = _node;
+}
+
+/**
+ * Puts a leaf into the tree next to the node that grows the tree least
+ * @param _leaf int The leaf to insert, with its box already set
+ */
+void DynamicAABBTree::InsertLeaf(int _leaf)
+{
+	if (m_root == NULL_NODE)
+	{
+		m_root = _leaf;
+		m_nodes[_leaf].m_parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down to the best sibling. Hanging the leaf next to a node costs the perimeter of the branch that would
+	// join them, and every branch above grows by however much the leaf stretches it. Stop once going further down
+	// can only cost more than joining here
+	AABB m_leafBox = m_nodes[_leaf].m_box;
+	int m_sibling = m_root;
+	while (m_nodes[m_sibling].m_left != NULL_NODE)
+	{
+		const Node &m_node = m_nodes[m_sibling];
+		float m_perimeter = Perimeter(m_node.m_box);
+		float m_combinedPerimeter = Perimeter(Union(m_node.m_box, m_leafBox));
+
+		float m_cost = 2.0f * m_combinedPerimeter;
+		float m_inheritedCost = 2.0f * (m_combinedPerimeter - m_perimeter);
+
+		float m_childCost[2];
+		int m_children[2] = { m_node.m_left, m_node.m_right };
+		for (int k = 0; k < 2; k++)
+		{
+			const Node &m_child = m_nodes[m_children[k]];
+			float m_grown = Perimeter(Union(m_child.m_box, m_leafBox));
+			m_childCost[k] = (m_child.m_left == NULL_NODE ? m_grown : m_grown - Perimeter(m_child.m_box)) + m_inheritedCost;
+		}
+
+		if (m_cost < m_childCost[0] && m_cost < m_childCost[1])
+		{
+			break;
+		}
+		m_sibling = (m_childCost[0] < m_childCost[1] ? m_children[0] : m_children[1]);
+	}
+
+	// Join the leaf and its sibling under a new branch in the sibling's place
+	int m_oldParent = m_nodes[m_sibling].m_parent;
+	int m_newParent = AllocateNode();
+	Node &m_branch = m_nodes[m_newParent];
+	m_branch.m_parent = m_oldParent;
+	m_branch.m_box = Union(m_leafBox, m_nodes[m_sibling].m_box);
+	m_branch.m_height = m_nodes[m_sibling].m_height + 1;
+	m_branch.m_left = m_sibling;
+	m_branch.m_right = _leaf;
+	if (m_oldParent == NULL_NODE)
+	{
+		m_root = m_newParent;
+	}
+	else if (m_nodes[m_oldParent].m_left == m_sibling)
+	{
+		m_nodes[m_oldParent].m_left = m_newParent;
+	}
+	else
+	{
+		m_nodes[m_oldParent].m_right = m_newParent;
+	}
+	m_nodes[m_sibling].m_parent = m_newParent;
+	m_nodes[_leaf].m_parent = m_newParent;
+
+	// Every branch above the new one may have grown, so refit from it up
+	Refit(m_newParent);
+}
+
+/**
+ * Takes a leaf out of the tree, freeing the branch it hung from
+ * @param _leaf int The leaf to remove
+ */
+void DynamicAABBTree::RemoveLeaf(int _leaf)
+{
+	if (_leaf == m_root)
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	// The leaf's sibling takes the place of their branch
+	int m_parent = m_nodes[_leaf].m_parent;
+	int m_grandParent = m_nodes[m_parent].m_parent;
+	int m_sibling = (m_nodes[m_parent].m_left == _leaf ? m_nodes[m_parent].m_right : m_nodes[m_parent].m_left);
+	m_nodes[m_sibling].m_parent = m_grandParent;
+	if (m_grandParent == NULL_NODE)
+	{
+		m_root = m_sibling;
+	}
+	else if (m_nodes[m_grandParent].m_left == m_parent)
+	{
+		m_nodes[m_grandParent].m_left = m_sibling;
+	}
+	else
+	{
+		m_nodes[m_grandParent].m_right = m_sibling;
+	}
+	FreeNode(m_parent);
+
+	Refit(m_grandParent);
+}
+
+/**
+ * Refits the boxes and heights of a branch and every branch above it, balancing and rotating each on the way
+ * @param _node int The lowest branch to refit
+ */
+void DynamicAABBTree::Refit(int _node)
+{
+	while (_node != NULL_NODE)
+	{
+		_node = Balance(_node);
+		Rotate(_node);
+
+		Node &m_node = m_nodes[_node];
+		const Node &m_left = m_nodes[m_node.m_left];
+		const Node &m_right = m_nodes[m_node.m_right];
+		m_node.m_height = 1 + std::max(m_left.m_height, m_right.m_height);
+		m_node.m_box = Union(m_left.m_box, m_right.m_box);
+
+		_node = m_node.m_parent;
+	}
+}
+
+/**
+ * Rotates a branch's taller child up into its place if its children differ in height by more than MAX_IMBALANCE
+ * @param _node int The branch to balance
+ * @returns int The node now in the branch's place
+ */
+int DynamicAABBTree::Balance(int _node)
+{
+	Node &m_a = m_nodes[_node];
+	if (m_a.m_left == NULL_NODE || m_a.m_height < 2)
+	{
+		return _node;
+	}
+
+	int m_b = m_a.m_left;
+	int m_c = m_a.m_right;
+	int m_balance = m_nodes[m_c].m_height - m_nodes[m_b].m_height;
+	if (m_balance >= -MAX_IMBALANCE && m_balance <= MAX_IMBALANCE)
+	{
+		return _node;
+	}
+
+	// The taller child takes the branch's place, and the branch takes the shorter of that child's children with
+	// it, leaving the taller grandchild under the child
+	bool m_rightTaller = (m_balance > 0);
+	int m_up = (m_rightTaller ? m_c : m_b);
+	int m_stays = (m_rightTaller ? m_b : m_c);
+	Node &m_upNode = m_nodes[m_up];
+	int m_f = m_upNode.m_left;
+	int m_g = m_upNode.m_right;
+	int m_taller = (m_nodes[m_f].m_height > m_nodes[m_g].m_height ? m_f : m_g);
+	int m_shorter = (m_taller == m_f ? m_g : m_f);
+
+	// Swap the branch and the child
+	m_upNode.m_parent = m_a.m_parent;
+	m_a.m_parent = m_up;
+	if (m_upNode.m_parent == NULL_NODE)
+	{
+		m_root = m_up;
+	}
+	else if (m_nodes[m_upNode.m_parent].m_left == _node)
+	{
+		m_nodes[m_upNode.m_parent].m_left = m_up;
+	}
+	else
+	{
+		m_nodes[m_upNode.m_parent].m_right = m_up;
+	}
+
+	// The child keeps its taller grandchild and takes the branch, the branch takes the shorter grandchild in the
+	// child's old place
+	m_upNode.m_left = _node;
+	m_upNode.m_right = m_taller;
+	if (m_rightTaller)
+	{
+		m_a.m_right = m_shorter;
+	}
+	else
+	{
+		m_a.m_left = m_shorter;
+	}
+	m_nodes[m_shorter].m_parent = _node;
+
+	m_a.m_box = Union(m_nodes[m_stays].m_box, m_nodes[m_shorter].m_box);
+	m_a.m_height = 1 + std::max(m_nodes[m_stays].m_height, m_nodes[m_shorter].m_height);
+	m_upNode.m_box = Union(m_a.m_box, m_nodes[m_taller].m_box);
+	m_upNode.m_height = 1 + std::max(m_a.m_height, m_nodes[m_taller].m_height);
+
+	m_rotations++;
+	return m_up;
+}
+
+/**
+ * Swaps one of a branch's children with a grandchild under its other child if that shrinks the branches below it
+ * @param _node int The branch to rotate
+ */
+void DynamicAABBTree::Rotate(int _node)
+{
+	Node &m_a = m_nodes[_node];
+	if (m_a.m_height < 2)
+	{
+		return;
+	}
+
+	// A swap keeps the branch's own box, only the child taking the grandchild's place changes. Try each child
+	// against the two grandchildren under the other and keep whichever shrinks that child's perimeter most
+	int m_children[2] = { m_a.m_left, m_a.m_right };
+	float m_best = 0.0f;
+	int m_up = NULL_NODE;
+	int m_down = NULL_NODE;
+	for (int k = 0; k < 2; k++)
+	{
+		const Node &m_other = m_nodes[m_children[1 - k]];
+		if (m_other.m_left == NULL_NODE)
+		{
+			continue;
+		}
+		const AABB &m_box = m_nodes[m_children[k]].m_box;
+		float m_perimeter = Perimeter(m_other.m_box);
+		float m_keepRight = Perimeter(Union(m_box, m_nodes[m_other.m_right].m_box)) - m_perimeter;
+		float m_keepLeft = Perimeter(Union(m_box, m_nodes[m_other.m_left].m_box)) - m_perimeter;
+		if (m_keepRight < m_best)
+		{
+			m_best = m_keepRight;
+			m_down = m_children[k];
+			m_up = m_other.m_left;
+		}
+		if (m_keepLeft < m_best)
+		{
+			m_best = m_keepLeft;
+			m_down = m_children[k];
+			m_up = m_other.m_right;
+		}
+	}
+	if (m_up == NULL_NODE)
+	{
+		return;
+	}
+
+	// The grandchild comes up into the child's place and the child goes down into the grandchild's
+	int m_under = m_nodes[m_up].m_parent;
+	Node &m_branch = m_nodes[m_under];
+	if (m_a.m_left == m_down)
+	{
+		m_a.m_left = m_up;
+	}
+	else
+	{
+		m_a.m_right = m_up;
+	}
+	if (m_branch.m_left == m_up)
+	{
+		m_branch.m_left = m_down;
+	}
+	else
+	{
+		m_branch.m_right = m_down;
+	}
+	m_nodes[m_up].m_parent = _node;
+	m_nodes[m_down].m_parent = m_under;
+
+	m_branch.m_box = Union(m_nodes[m_branch.m_left].m_box, m_nodes[m_branch.m_right].m_box);
+	m_branch.m_height = 1 + std::max(m_nodes[m_branch.m_left].m_height, m_nodes[m_branch.m_right].m_height);
+
+	m_rotations++;
+}
+
+/**
+ * Moves every particle that has left its leaf's box back into the tree, or builds the tree again if the
+ * particles have been added, removed or reordered
+ * @param _particles ParticleStore& The particles to track
+ * @param _deltaTime float The time each step advances by, which sets how far a leaf's box reaches for the
+ *                         particle's velocity
+ */
+void DynamicAABBTree::Update(ParticleStore &_particles, float _deltaTime)
+{
+	ScopedZone m_zone("UpdateTree");
+
+	int m_count = _particles.Size();
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_radius = _particles.Radius();
+	float* m_vx = _particles.VelocityX();
+	float* m_vy = _particles.VelocityY();
+
+	// Indices mean nothing once particles have been added, removed or reordered, so start again from an empty tree
+	// and let every particle go in as if it had moved
+	if (!m_valid || &_particles != m_store || _particles.GetGeneration() != m_generation)
+	{
+		m_nodes.clear();
+		m_nodes.reserve(2 * m_count);
+		m_root = NULL_NODE;
+		m_freeList = NULL_NODE;
+		m_leaf.assign(m_count, (int)NULL_NODE);
+		m_store = &_particles;
+		m_generation = _particles.GetGeneration();
+		m_valid = true;
+	}
+
+	// Find the particles that have left their leaf's box, the tree is only read so every chunk can look at once
+	int m_chunks = (m_count + PARTICLES_PER_JOB - 1) / PARTICLES_PER_JOB;
+	if ((int)m_chunkMoved.size() < m_chunks)
+	{
+		m_chunkMoved.resize(m_chunks);
+	}
+	m_jobs->ParallelFor(0, m_chunks, 1, [&](int _begin, int _end)
+	{
+		for (int c = _begin; c < _end; c++)
+		{
+			std::vector<int> &m_moved = m_chunkMoved[c];
+			m_moved.clear();
+			for (int i = c * PARTICLES_PER_JOB; i < std::min((c + 1) * PARTICLES_PER_JOB, m_count); i++)
+			{
+				// A particle that loses its position leaves the tree
+				if (!std::isfinite(m_x[i]) || !std::isfinite(m_y[i]))
+				{
+					if (m_leaf[i] != NULL_NODE)
+					{
+						m_moved.push_back(i);
+					}
+					continue;
+				}
+				AABB m_box = { m_x[i] - m_radius[i], m_y[i] - m_radius[i], m_x[i] + m_radius[i], m_y[i] + m_radius[i] };
+				if (m_leaf[i] == NULL_NODE || !Contains(m_nodes[m_leaf[i]].m_box, m_box))
+				{
+					m_moved.push_back(i);
+				}
+			}
+		}
+	});
+
+	// Take each one out and put it back in with a fresh fat box, in particle order so the tree always grows the same
+	m_reinserted = 0;
+	m_rotations = 0;
+	for (int c = 0; c < m_chunks; c++)
+	{
+		for (unsigned int k = 0; k < m_chunkMoved[c].size(); k++)
+		{
+			int i = m_chunkMoved[c][k];
+			int m_node = m_leaf[i];
+			if (m_node != NULL_NODE)
+			{
+				RemoveLeaf(m_node);
+			}
+			if (!std::isfinite(m_x[i]) || !std::isfinite(m_y[i]))
+			{
+				FreeNode(m_node);
+				m_leaf[i] = NULL_NODE;
+				continue;
+			}
+			if (m_node == NULL_NODE)
+			{
+				m_node = AllocateNode();
+				m_nodes[m_node].m_particle = i;
+				m_leaf[i] = m_node;
+			}
+
+			// Collisions bounce a particle back and forth as often as they carry it along, so each axis grows both ways
+			// rather than out ahead of the particle. A velocity that isn't finite adds nothing, as an endless box would
+			// grow every branch above it to match
+			float m_moveX = (std::isfinite(m_vx[i]) ? std::abs(m_vx[i]) * _deltaTime * VELOCITY_STEPS : 0.0f);
+			float m_moveY = (std::isfinite(m_vy[i]) ? std::abs(m_vy[i]) * _deltaTime * VELOCITY_STEPS : 0.0f);
+			float m_reachX = m_radius[i] + m_margin + m_moveX;
+			float m_reachY = m_radius[i] + m_margin + m_moveY;
+			AABB m_fat = { m_x[i] - m_reachX, m_y[i] - m_reachY, m_x[i] + m_reachX, m_y[i] + m_reachY };
+			m_nodes[m_node].m_box = m_fat;
+			InsertLeaf(m_node);
+			m_reinserted++;
+		}
+	}
+
+	m_totalReinserted += m_reinserted;
+
+	m_skipped = 0;
+	for (int i = 0; i < m_count; i++)
+	{
+		m_skipped += (m_leaf[i] == NULL_NODE);
+	}
+
+	// The pairs from the last search belong to the old tree
+	m_pairChunks = 0;
+	m_candidates = 0;
+	m_visits = 0;
+}
+
+/**
+ * Searches the tree once for every particle, collecting each pair from the later particle. The tree must have
+ * been updated first
+ * @param _particles ParticleStore& The particles the tree was updated from
+ */
+void DynamicAABBTree::FindPairs(ParticleStore &_particles)
+{
+	ScopedZone m_zone("SearchTree");
+
+	int m_count = _particles.Size();
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_radius = _particles.Radius();
+
+	m_pairChunks = (m_count + PARTICLES_PER_JOB - 1) / PARTICLES_PER_JOB;
+	if ((int)m_chunkPairs.size() < m_pairChunks)
+	{
+		m_chunkPairs.resize(m_pairChunks);
+	}
+	m_chunkCandidates.assign(m_pairChunks, 0);
+	m_chunkVisits.assign(m_pairChunks, 0);
+
+	m_jobs->ParallelFor(0, m_pairChunks, 1, [&](int _begin, int _end)
+	{
+		std::vector<int> m_found;
+		for (int c = _begin; c < _end; c++)
+		{
+			std::vector<int> &m_pairs = m_chunkPairs[c];
+			m_pairs.clear();
+			for (int i = c * PARTICLES_PER_JOB; i < std::min((c + 1) * PARTICLES_PER_JOB, m_count); i++)
+			{
+				if (m_leaf[i] == NULL_NODE)
+				{
+					continue;
+				}
+
+				// Search with the particle's own box, the leaves already carry the margin
+				m_found.clear();
+				AABB m_box = { m_x[i] - m_radius[i], m_y[i] - m_radius[i], m_x[i] + m_radius[i], m_y[i] + m_radius[i] };
+				m_chunkVisits[c] += Query(m_box, [&](int _neighbour)
+				{
+					m_chunkCandidates[c]++;
+					// A fat box reaching the particle says nothing about where its own particle is now, so only keep
+					// the ones whose particle's box overlaps as well
+					float m_reach = m_radius[i] + m_radius[_neighbour];
+					if (_neighbour < i && std::abs(m_x[i] - m_x[_neighbour]) <= m_reach && std::abs(m_y[i] - m_y[_neighbour]) <= m_reach)
+					{
+						m_found.push_back(_neighbour);
+					}
+				});
+
+				// The order leaves come out in depends on the shape of the tree, so sort them
+				std::sort(m_found.begin(), m_found.end());
+				for (unsigned int k = 0; k < m_found.size(); k++)
+				{
+					m_pairs.push_back(i);
+					m_pairs.push_back(m_found[k]);
+				}
+			}
+		}
+	});
+
+	for (int c = 0; c < m_pairChunks; c++)
+	{
+		m_candidates += m_chunkCandidates[c];
+		m_visits += m_chunkVisits[c];
+	}
+}
+
+/**
+ * Measures the shape of the tree and how much of it the last search for pairs walked
+ * @returns GridStats The nodes in use as the cells, the leaves as the occupied cells, the height of the tree as
+ *                    the fullest cell and the nodes visited by each particle's search as the mean
+ */
+GridStats DynamicAABBTree::GetStats()
+{
+	int m_leaves = (int)m_leaf.size() - m_skipped;
+	GridStats m_stats = { 0, std::max(2 * m_leaves - 1, 0), m_leaves, GetHeight(), 0.0f };
+	m_stats.m_meanOccupancy = (m_leaves > 0 ? (float)m_visits / m_leaves : 0.0f);
+
+	return m_stats;
+}
+
+/**
+ * Draws the boxes of the branches on the screen for debugging purposes
+ * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+ */
+void DynamicAABBTree::DrawBoxes(SDL_Renderer* _renderer)
+{
+	// Leaves are about the size of their particles, so only the branches are worth drawing
+	std::vector<SDL_Rect> m_rects;
+	for (unsigned int n = 0; n < m_nodes.size(); n++)
+	{
+		const Node &m_node = m_nodes[n];
+		if (m_node.m_height < 1)
+		{
+			continue;
+		}
+		// Far off boxes would overflow an int in pixels
+		AABB m_box = m_node.m_box;
+		if (m_box.m_minX < -1e6f || m_box.m_minY < -1e6f || m_box.m_maxX > 1e6f || m_box.m_maxY > 1e6f)
+		{
+			continue;
+		}
+		SDL_Rect m_rect = { (int)m_box.m_minX, (int)m_box.m_minY, (int)(m_box.m_maxX - m_box.m_minX), (int)(m_box.m_maxY - m_box.m_minY) };
+		m_rects.push_back(m_rect);
+	}
+
+	SDL_SetRenderDrawColor(_renderer, 43, 206, 239, 255);
+	SDL_RenderDrawRects(_renderer, m_rects.data(), (int)m_rects.size());
+}
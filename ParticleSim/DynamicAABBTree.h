@@ -0,0 +1,277 @@
+#ifndef _DYNAMICAABBTREE_H_
+#define _DYNAMICAABBTREE_H_
+/**
+ * Broad phase for particles of very different sizes. Every particle is a leaf of a binary tree of axis aligned
+ * bounding boxes, each branch bounding its two children, so a search only walks down the branches its bounds
+ * overlap however big or small the particles are, and a big particle is one leaf rather than a run of cells. A leaf
+ * holds a fat box, the particle's box grown by a margin, and only leaves the tree and goes back in once the particle
+ * moves out of it, so a particle jostling in place costs nothing to update. Along each axis the margin is a fixed pixel
+ * or so plus the distance the particle's velocity carries it over a few steps, so a fast particle isn't put back in
+ * every step and a slow one doesn't make the searches around it walk into a box far bigger than it needs. Going back in picks the sibling that
+ * grows the perimeter of the tree least, then refits the boxes on the way back up to the root, swapping a child
+ * with a grandchild wherever that shrinks a branch. Without the swaps, branches left behind by particles going back
+ * in overlap more and more until the tree is built again, and a search walks several times as many nodes. A branch
+ * whose children drift too far apart in height has its taller child rotated up first, which keeps searches shallow.
+ *
+ * The tree is only changed on one thread, in particle order. Searches only read it, so the pairs are searched for
+ * across the job system. A search keeps only the leaves whose particle's own box overlaps and sorts each
+ * particle's pairs, which makes the pairs found depend only on where the particles are and never on the shape the
+ * tree has grown into or the fat boxes it was left with.
+ */
+class ParticleStore;
+class DynamicAABBTree
+{
+private:
+	// The steps of a particle's velocity its leaf's box reaches past it on top of the margin
+	static constexpr float VELOCITY_STEPS = 4.0f;
+	// The amount of particles handed to a job at once
+	static const int PARTICLES_PER_JOB = 1024;
+	// The nodes a search keeps on its own stack before spilling onto the heap, the tree stays within a few levels of
+	// balanced so this is far deeper than a search ever needs
+	static const int STACK_SIZE = 256;
+	// How much taller one child of a branch can be than the other before the taller is rotated up
+	static const int MAX_IMBALANCE = 4;
+	// Marks a missing node
+	static const int NULL_NODE = -1;
+
+	// An axis aligned bounding box
+	struct AABB
+	{
+		float m_minX, m_minY;
+		float m_maxX, m_maxY;
+	};
+
+	// A leaf or branch of the tree
+	struct Node
+	{
+		AABB m_box; // The fat box of a leaf, or the box around both children of a branch
+		int m_parent; // The branch above, or the next free node while the node is free
+		int m_left, m_right; // The children of a branch, NULL_NODE for a leaf
+		int m_height; // 0 for a leaf, one more than the taller child for a branch and -1 while free
+		int m_particle; // The particle a leaf holds
+	};
+
+	// The job system the pairs are searched for across
+	JobSystem* m_jobs;
+	// How far a leaf's box reaches past its particle before its velocity is added, in pixels
+	float m_margin;
+
+	// Every node, with the free ones linked through their parent
+	std::vector<Node> m_nodes;
+	int m_root;
+	int m_freeList;
+	// The leaf each particle is in, NULL_NODE if it has no position
+	std::vector<int> m_leaf;
+
+	// The store the tree was built for and its generation at the time, the tree is built again if either changes
+	ParticleStore* m_store;
+	unsigned int m_generation;
+	// Cleared when something outside the store means the tree has to be built again
+	bool m_valid;
+
+	// The particles each job found outside their leaf's box, put back in order once every job has finished
+	std::vector<std::vector<int>> m_chunkMoved;
+	// The pairs each job found, two particle indices a pair, and how many jobs the last search was split into
+	std::vector<std::vector<int>> m_chunkPairs;
+	int m_pairChunks;
+	// The leaves each job found and the nodes it visited finding them
+	std::vector<long long> m_chunkCandidates, m_chunkVisits;
+
+	// The amount of particles without a position during the last update
+	int m_skipped;
+	// The leaves moved and the rotations made during the last update
+	int m_reinserted;
+	int m_rotations;
+	// The leaves moved over every update
+	long long m_totalReinserted;
+	// The leaves found and the nodes visited during the last search for pairs
+	long long m_candidates;
+	long long m_visits;
+
+	/**
+	 * Takes a node off the free list, or adds one if there are none
+	 * @returns int The new node, a leaf with no parent
+	 */
+	int AllocateNode();
+
+	/**
+	 * Puts a node on the free list
+	 * @param _node int The node to free
+	 */
+	void FreeNode(int _node);
+
+	/**
+	 * Puts a leaf into the tree next to the node that grows the tree least
+	 * @param _leaf int The leaf to insert, with its box already set
+	 */
+	void InsertLeaf(int _leaf);
+
+	/**
+	 * Takes a leaf out of the tree, freeing the branch it hung from
+	 * @param _leaf int The leaf to remove
+	 */
+	void RemoveLeaf(int _leaf);
+
+	/**
+	 * Refits the boxes and heights of a branch and every branch above it, balancing and rotating each on the way
+	 * @param _node int The lowest branch to refit
+	 */
+	void Refit(int _node);
+
+	/**
+	 * Rotates a branch's taller child up into its place if its children differ in height by more than MAX_IMBALANCE
+	 * @param _node int The branch to balance
+	 * @returns int The node now in the branch's place
+	 */
+	int Balance(int _node);
+
+	/**
+	 * Swaps one of a branch's children with a grandchild under its other child if that shrinks the branches below it
+	 * @param _node int The branch to rotate
+	 */
+	void Rotate(int _node);
+
+	/**
+	 * Calls a function for every leaf whose box overlaps the given box
+	 * @param _box const AABB& The box to search
+	 * @param _function Function Called as _function(int _particle) for each leaf found
+	 * @returns int The amount of nodes visited
+	 */
+	template <typename Function>
+	int Query(const AABB &_box, Function _function)
+	{
+		if (m_root == NULL_NODE)
+		{
+			return 0;
+		}
+
+		if (!Overlaps(m_nodes[m_root].m_box, _box))
+		{
+			return 1;
+		}
+
+		// Only nodes overlapping the box go on the stack, and each branch taken off swaps itself for at most two
+		// children, so the stack never holds more than the height. A tree too tall for the fixed stack carries on in
+		// the spill, which is always emptied before the stack so the nodes still come off in the same order
+		int m_stack[STACK_SIZE];
+		std::vector<int> m_spill;
+		int m_top = 0;
+		int m_visited = 1;
+		m_stack[m_top++] = m_root;
+		while (m_top > 0 || !m_spill.empty())
+		{
+			int m_index;
+			if (!m_spill.empty())
+			{
+				m_index = m_spill.back();
+				m_spill.pop_back();
+			}
+			else
+			{
+				m_index = m_stack[--m_top];
+			}
+			const Node &m_node = m_nodes[m_index];
+			if (m_node.m_left == NULL_NODE)
+			{
+				_function(m_node.m_particle);
+				continue;
+			}
+			m_visited += 2;
+			int m_children[2] = { m_node.m_left, m_node.m_right };
+			for (int k = 0; k < 2; k++)
+			{
+				if (!Overlaps(m_nodes[m_children[k]].m_box, _box))
+				{
+					continue;
+				}
+				if (m_top < STACK_SIZE && m_spill.empty())
+				{
+					m_stack[m_top++] = m_children[k];
+				}
+				else
+				{
+					m_spill.push_back(m_children[k]);
+				}
+			}
+		}
+		return m_visited;
+	}
+
+	// Box helpers
+	static AABB Union(const AABB &_a, const AABB &_b) { AABB m_box = { std::min(_a.m_minX, _b.m_minX), std::min(_a.m_minY, _b.m_minY), std::max(_a.m_maxX, _b.m_maxX), std::max(_a.m_maxY, _b.m_maxY) }; return m_box; }
+	static float Perimeter(const AABB &_box) { return 2.0f * ((_box.m_maxX - _box.m_minX) + (_box.m_maxY - _box.m_minY)); }
+	static bool Contains(const AABB &_outer, const AABB &_inner) { return _outer.m_minX <= _inner.m_minX && _outer.m_minY <= _inner.m_minY && _outer.m_maxX >= _inner.m_maxX && _outer.m_maxY >= _inner.m_maxY; }
+	static bool Overlaps(const AABB &_a, const AABB &_b) { return _a.m_minX <= _b.m_maxX && _a.m_maxX >= _b.m_minX && _a.m_minY <= _b.m_maxY && _a.m_maxY >= _b.m_minY; }
+public:
+	/**
+	 * Constructs an empty tree
+	 * @param _jobs JobSystem* The job system to search for pairs across
+	 * @param _margin float How far a leaf's box reaches past its particle before its velocity is added, in pixels
+	 */
+	DynamicAABBTree(JobSystem* _jobs, float _margin);
+	~DynamicAABBTree();
+
+	/**
+	 * Moves every particle that has left its leaf's box back into the tree, or builds the tree again if the
+	 * particles have been added, removed or reordered
+	 * @param _particles ParticleStore& The particles to track
+	 * @param _deltaTime float The time each step advances by, which sets how far a leaf's box reaches for the
+	 *                         particle's velocity
+	 */
+	void Update(ParticleStore &_particles, float _deltaTime);
+
+	/**
+	 * Searches the tree once for every particle, collecting each pair from the later particle. The tree must have
+	 * been updated first
+	 * @param _particles ParticleStore& The particles the tree was updated from
+	 */
+	void FindPairs(ParticleStore &_particles);
+
+	/**
+	 * Calls a function for every particle whose leaf's box overlaps the given bounds. The tree must have been
+	 * updated first
+	 * @param _position glm::vec2 The position to use as the search case
+	 * @param _radius float The radius to use as the search case
+	 * @param _function Function Called as _function(int _index) for each particle found
+	 */
+	template <typename Function>
+	void ForEachNeighbour(glm::vec2 _position, float _radius, Function _function)
+	{
+		// A particle without a position isn't in the tree and can't touch anything
+		if (!std::isfinite(_position.x) || !std::isfinite(_position.y))
+		{
+			return;
+		}
+		AABB m_box = { _position.x - _radius, _position.y - _radius, _position.x + _radius, _position.y + _radius };
+		Query(m_box, _function);
+	}
+
+	/**
+	 * Measures the shape of the tree and how much of it the last search for pairs walked
+	 * @returns GridStats The nodes in use as the cells, the leaves as the occupied cells, the height of the tree as
+	 *                    the fullest cell and the nodes visited by each particle's search as the mean
+	 */
+	GridStats GetStats();
+
+	/**
+	 * Draws the boxes of the branches on the screen for debugging purposes
+	 * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+	 */
+	void DrawBoxes(SDL_Renderer* _renderer);
+
+	// Marks the tree as needing to be built again, for when the store is replaced
+	void Invalidate() { m_valid = false; }
+
+	/** Getters **/
+	float GetMargin() { return m_margin; }
+	int GetHeight() { return m_root == NULL_NODE ? 0 : m_nodes[m_root].m_height; }
+	int GetSkipped() { return m_skipped; }
+	int GetReinserted() { return m_reinserted; }
+	long long GetTotalReinserted() { return m_totalReinserted; }
+	int GetRotations() { return m_rotations; }
+	long long GetCandidates() { return m_candidates; }
+	int GetPairChunks() { return m_pairChunks; }
+	const int* GetPairs(int _chunk) { return m_chunkPairs[_chunk].data(); }
+	int GetPairCount(int _chunk) { return (int)m_chunkPairs[_chunk].size() / 2; }
+};
+#endif // !_DYNAMICAABBTREE_H_
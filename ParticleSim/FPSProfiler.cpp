@@ -31,7 +31,14 @@ FPSProfiler::FPSProfiler(std::string _outputFile)
 	m_frameTimeLast = SDL_GetTicks();
 
 	m_lastParticleCount = 0;
-	m_collisionChecks = 0;
+	// Only the calling thread counts until we know how many threads the job system has
+	SetThreadCount(0);
+	m_collisionStats = { { 0, 0, 0 }, 0, 0.0f };
+	m_collisionTotals = { 0, 0, 0 };
+	m_gridStats = { 0, 0, 0, 0, 0.0f };
+	m_locality = 1.0f;
+	m_reorders = 0;
+	m_reorderTime = 0.0;
 }
 
 FPSProfiler::~FPSProfiler()
@@ -105,6 +112,53 @@ void FPSProfiler::Run(int _particleCount)
 	m_fpsMap[_particleCount] = m_currentFPS;
 }
 
+/**
+ * Records how full the broad phase's cells were after it was last built
+ * @param _stats const GridStats& The occupancy of the cells
+ */
+void FPSProfiler::SetGridStats(const GridStats &_stats)
+{
+	m_gridStats = _stats;
+	m_gridMap[_stats.m_cellSize] = _stats;
+}
+
+/**
+ * Gives each thread of the job system its own collision counts, must be called before the collision pass runs
+ * @param _threadCount int The amount of threads in the job system
+ */
+void FPSProfiler::SetThreadCount(int _threadCount)
+{
+	CounterSlot m_empty;
+	memset(&m_empty, 0, sizeof(m_empty));
+	m_counterSlots.assign(_threadCount + 1, m_empty);
+}
+
+/**
+ * Merges every thread's collision counts into the stats of the step that just ran and the totals, then resets
+ * them for the next step. Must be called once the collision pass has finished, after SetGridStats
+ * @param _particleCount int The amount of particles that were solved
+ */
+void FPSProfiler::MergeCollisionCounts(int _particleCount)
+{
+	CollisionCounts m_counts = { 0, 0, 0 };
+	for (auto &m_slot : m_counterSlots)
+	{
+		m_counts.m_candidates += m_slot.m_counts.m_candidates;
+		m_counts.m_distanceTests += m_slot.m_counts.m_distanceTests;
+		m_counts.m_contacts += m_slot.m_counts.m_contacts;
+		m_slot.m_counts = { 0, 0, 0 };
+	}
+
+	m_collisionStats.m_counts = m_counts;
+	m_collisionStats.m_maxBucketOccupancy = m_gridStats.m_maxOccupancy;
+	// Each distance test is a neighbour of both particles in the pair
+	m_collisionStats.m_averageNeighbours = (_particleCount > 0 ? 2.0f * m_counts.m_distanceTests / _particleCount : 0.0f);
+
+	m_collisionTotals.m_candidates += m_counts.m_candidates;
+	m_collisionTotals.m_distanceTests += m_counts.m_distanceTests;
+	m_collisionTotals.m_contacts += m_counts.m_contacts;
+}
+
 /**
 * Exports the fps profile to a file
 */
@@ -127,7 +181,11 @@ void FPSProfiler::Export()
 			<< "-" << (m_now.tm_year + 1900) << " " << std::setfill('0') << std::setw(2) << m_now.tm_hour << ":" << std::setfill('0') << std::setw(2) << m_now.tm_min << ":" << std::setfill('0') << std::setw(2) << m_now.tm_sec << " ==\n";
 		// Output the total runtime in seconds
 		m_output << "Total Runtime: " << SDL_GetTicks() / 1000.0f << " seconds\n";
-		m_output << "Total Collision Calculations: " << m_collisionChecks << "\n\n";
+		m_output << "Total Candidate Pairs: " << m_collisionTotals.m_candidates << "\n";
+		m_output << "Total Distance Tests: " << m_collisionTotals.m_distanceTests << "\n";
+		m_output << "Total Contacts: " << m_collisionTotals.m_contacts << "\n";
+		m_output << "Particle Reorders: " << m_reorders << " (" << m_reorderTime << " ms)\n";
+		m_output << "Final Locality: " << m_locality << "\n\n";
 
 		// Output the headers to our table
 		m_output << std::setfill(' ') << std::left << std::setw(20) << "Particle Count" << std::left << std::setw(20) << "Average FPS" << std::left << std::setw(20) << "Maximum FPS" << std::left << std::setw(20) << "Minimum FPS" << "\n";
@@ -138,6 +196,15 @@ void FPSProfiler::Export()
 			// Output each fps data for each particle count
 			m_output << std::left << std::setw(20) << data.first << std::left << std::setw(20) << data.second.m_average << std::left << std::setw(20) << data.second.m_max << std::left << std::setw(20) << data.second.m_min << "\n";
 		}
+
+		// Output how full the cells were at each cell size the grid was tuned to
+		m_output << "\n" << std::left << std::setw(20) << "Cell Size" << std::left << std::setw(20) << "Cells" << std::left << std::setw(20) << "Occupied Cells"
+			<< std::left << std::setw(20) << "Mean Occupancy" << std::left << std::setw(20) << "Max Occupancy" << "\n";
+		for (auto const &data : m_gridMap)
+		{
+			m_output << std::left << std::setw(20) << data.first << std::left << std::setw(20) << data.second.m_cells << std::left << std::setw(20) << data.second.m_occupiedCells
+				<< std::left << std::setw(20) << data.second.m_meanOccupancy << std::left << std::setw(20) << data.second.m_maxOccupancy << "\n";
+		}
 		// close the file
 		m_output.close();
 	}
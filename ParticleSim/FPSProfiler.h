@@ -8,6 +8,32 @@ struct FPSPacket
 	int m_average;
 };
 
+// How full the broad phase's cells were when it was last built
+struct GridStats
+{
+	int m_cellSize; // The cell size in pixels
+	int m_cells; // The amount of cells in the grid
+	int m_occupiedCells; // The amount of cells holding at least one particle
+	int m_maxOccupancy; // The most particles in one cell
+	float m_meanOccupancy; // The average particles in an occupied cell
+};
+
+// What the collision pass did, counted up by each thread
+struct CollisionCounts
+{
+	long long m_candidates; // Neighbours the broad phase handed over, including repeats and the particle itself
+	long long m_distanceTests; // Pairs the distance between was measured for
+	long long m_contacts; // Pairs found touching and responded to
+};
+
+// What the collision pass did on the last step
+struct CollisionStats
+{
+	CollisionCounts m_counts; // Every thread's counts merged together
+	int m_maxBucketOccupancy; // The most particles in one cell or bucket of the broad phase
+	float m_averageNeighbours; // The average amount of particles each particle was distance tested against
+};
+
 class FPSProfiler
 {
 private:
@@ -31,8 +57,28 @@ private:
 
 	// The last particle count
 	int m_lastParticleCount;
-	// Total number of collision checks
-	int m_collisionChecks;
+	// Each thread's collision counts for the current step, indexed by job system thread index + 1 so threads outside
+	// the job system share slot 0. Slots are padded two cache lines apart so neighbouring threads never write to the
+	// same line, whatever the alignment of the vector
+	struct CounterSlot
+	{
+		CollisionCounts m_counts;
+		char m_padding[128 - sizeof(CollisionCounts)];
+	};
+	std::vector<CounterSlot> m_counterSlots;
+	// The merged counts of the last step, and of every step so far. 64 bit as long benchmarks overflow an int
+	CollisionStats m_collisionStats;
+	CollisionCounts m_collisionTotals;
+
+	// The cell occupancy of the last build, and the last one seen at each cell size the grid has been tuned to
+	GridStats m_gridStats;
+	std::map<int, GridStats> m_gridMap;
+
+	// How close in memory the particles the collision pass reads one after another were on the last step
+	float m_locality;
+	// The amount of times the particles have been reordered and the milliseconds it took altogether
+	int m_reorders;
+	double m_reorderTime;
 public:
 	FPSProfiler(std::string _outputFile);
 	~FPSProfiler();
@@ -43,6 +89,38 @@ public:
 	 */
 	void Run(int _particleCount);
 
+	/**
+	 * Records how full the broad phase's cells were after it was last built
+	 * @param _stats const GridStats& The occupancy of the cells
+	 */
+	void SetGridStats(const GridStats &_stats);
+
+	/**
+	 * Gives each thread of the job system its own collision counts, must be called before the collision pass runs
+	 * @param _threadCount int The amount of threads in the job system
+	 */
+	void SetThreadCount(int _threadCount);
+
+	/**
+	 * Merges every thread's collision counts into the stats of the step that just ran and the totals, then resets
+	 * them for the next step. Must be called once the collision pass has finished, after SetGridStats
+	 * @param _particleCount int The amount of particles that were solved
+	 */
+	void MergeCollisionCounts(int _particleCount);
+
+	/**
+	 * Adds collision counts to the calling thread's own slot. Nothing is shared between threads, so a job only
+	 * needs to add its counts once when it has finished
+	 * @param _counts const CollisionCounts& The counts to add
+	 */
+	void AddCollisionCounts(const CollisionCounts &_counts)
+	{
+		CollisionCounts &m_slot = m_counterSlots[JobSystem::GetThreadIndex() + 1].m_counts;
+		m_slot.m_candidates += _counts.m_candidates;
+		m_slot.m_distanceTests += _counts.m_distanceTests;
+		m_slot.m_contacts += _counts.m_contacts;
+	}
+
 	/**
 	 * Exports the fps profile to a file
 	 */
@@ -50,8 +128,18 @@ public:
 
 	// Getters for profile feeds
 	FPSPacket GetCurrentFPS() { return m_currentFPS; }
-	// Pluses the collisions by one
-	void AddCollision() { m_collisionChecks++; }
+	std::string GetOutputFile() { return m_outputFile; }
+	long long GetCollisionChecks() { return m_collisionTotals.m_distanceTests; }
+	CollisionStats GetCollisionStats() { return m_collisionStats; }
+	CollisionCounts GetCollisionTotals() { return m_collisionTotals; }
+	GridStats GetGridStats() { return m_gridStats; }
+	float GetLocality() { return m_locality; }
+	int GetReorders() { return m_reorders; }
+	double GetReorderTime() { return m_reorderTime; }
+	// Sets how close in memory the particles the collision pass reads one after another were, from 0 to 1
+	void SetLocality(float _locality) { m_locality = _locality; }
+	// Counts a reorder of the particles that took an amount of milliseconds
+	void AddReorder(double _milliseconds) { m_reorders++; m_reorderTime += _milliseconds; }
 };
 #endif // !_FPSPROFILER_H_
 
@@ -0,0 +1,205 @@
+#include "Stdafx.h"
+#include "JobSystem.h"
+
+// Threads that don't belong to a job system push their jobs to queue 0
+thread_local int JobSystem::s_threadIndex = -1;
+
+/**
+ * Constructs the job system and starts its worker threads
+ * @param _threadCount int The amount of threads to run jobs on including the calling thread.
+ *                     0 uses every hardware thread
+ */
+JobSystem::JobSystem(int _threadCount)
+{
+	if (_threadCount <= 0)
+	{
+		_threadCount = (int)std::thread::hardware_concurrency();
+		// hardware_concurrency is allowed to return 0 when it can't tell
+		if (_threadCount <= 0)
+		{
+			_threadCount = 1;
+		}
+	}
+
+	m_queuedJobs = 0;
+	m_running = true;
+
+	// Every thread gets a work queue, including the calling thread
+	for (int i = 0; i < _threadCount; i++)
+	{
+		m_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+	s_threadIndex = 0;
+
+	for (int i = 1; i < _threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	// Tell the workers to stop and wait for them to finish
+	m_running = false;
+	WakeWorkers(true);
+
+	for (unsigned int i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+/**
+ * The loop each worker thread runs until the job system is destroyed
+ * @param _threadIndex int The index of this worker's work queue
+ */
+void JobSystem::WorkerLoop(int _threadIndex)
+{
+	s_threadIndex = _threadIndex;
+	Job m_job;
+
+	while (m_running)
+	{
+		if (PopJob(_threadIndex, m_job))
+		{
+			RunJob(m_job);
+			continue;
+		}
+
+		// Nothing to run or steal, sleep until more jobs are queued
+		std::unique_lock<std::mutex> m_lock(m_sleepMutex);
+		m_wake.wait(m_lock, [this]() { return m_queuedJobs > 0 || !m_running; });
+	}
+}
+
+/**
+ * Takes a job for a thread, from the back of its own queue or stolen from the front of another
+ * @param _threadIndex int The index of the thread looking for work
+ * @param _job Job& Set to the job found
+ * @returns bool Returns true if a job was found
+ */
+bool JobSystem::PopJob(int _threadIndex, Job &_job)
+{
+	int m_queueCount = (int)m_queues.size();
+
+	for (int i = 0; i < m_queueCount; i++)
+	{
+		// Start with our own queue and then walk around the other threads
+		int m_victim = (_threadIndex + i) % m_queueCount;
+		WorkQueue &m_queue = *m_queues[m_victim];
+
+		std::lock_guard<std::mutex> m_lock(m_queue.m_mutex);
+		if (m_queue.m_jobs.empty())
+		{
+			continue;
+		}
+
+		if (i == 0)
+		{
+			// Our own work, newest first
+			_job = std::move(m_queue.m_jobs.back());
+			m_queue.m_jobs.pop_back();
+		}
+		else
+		{
+			// Stolen work, oldest first as it is usually the largest piece left
+			_job = std::move(m_queue.m_jobs.front());
+			m_queue.m_jobs.pop_front();
+		}
+
+		m_queuedJobs--;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Runs a job inside the profiler zone it was queued from
+ * @param _job Job& The job to run
+ */
+void JobSystem::RunJob(Job &_job)
+{
+	// Whatever this thread had open belongs to a different piece of work, so swap it out while the job runs
+	int m_threadZone = ZoneProfiler::GetCurrentZone();
+	ZoneProfiler::SetCurrentZone(_job.m_zone);
+	_job.m_function();
+	ZoneProfiler::SetCurrentZone(m_threadZone);
+}
+
+/**
+ * Pushes a job to the back of the current thread's queue without waking any workers
+ * @param _job std::function<void()> The job to queue
+ */
+void JobSystem::Push(std::function<void()> _job)
+{
+	WorkQueue &m_queue = *m_queues[s_threadIndex < 0 ? 0 : s_threadIndex];
+
+	Job m_job;
+	m_job.m_function = std::move(_job);
+	m_job.m_zone = ZoneProfiler::GetCurrentZone();
+
+	std::lock_guard<std::mutex> m_lock(m_queue.m_mutex);
+	m_queue.m_jobs.push_back(std::move(m_job));
+	m_queuedJobs++;
+}
+
+// Wakes sleeping workers after jobs have been pushed
+void JobSystem::WakeWorkers(bool _all)
+{
+	// Taking the sleep lock makes sure a worker that just found nothing can't miss this wake up
+	{
+		std::lock_guard<std::mutex> m_lock(m_sleepMutex);
+	}
+
+	if (_all)
+	{
+		m_wake.notify_all();
+	}
+	else
+	{
+		m_wake.notify_one();
+	}
+}
+
+/**
+ * Queues a job to be run by any thread
+ * @param _job std::function<void()> The job to run
+ */
+void JobSystem::Submit(std::function<void()> _job)
+{
+	Push(std::move(_job));
+	WakeWorkers(false);
+}
+
+/**
+ * Runs a single queued job on the calling thread if one can be found
+ * @returns bool Returns true if a job was run, false if there was no work
+ */
+bool JobSystem::RunPendingJob()
+{
+	Job m_job;
+
+	if (!PopJob(s_threadIndex < 0 ? 0 : s_threadIndex, m_job))
+	{
+		return false;
+	}
+
+	RunJob(m_job);
+	return true;
+}
+
+/**
+ * Runs queued jobs on the calling thread until a counter reaches zero
+ * @param _counter std::atomic<int>& The counter to wait on, decremented by the jobs being waited for
+ */
+void JobSystem::Wait(std::atomic<int> &_counter)
+{
+	while (_counter > 0)
+	{
+		if (!RunPendingJob())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,163 @@
+#ifndef _JOBSYSTEM_H_
+#define _JOBSYSTEM_H_
+/**
+ * A small work-stealing job system. Every thread owns a deque of jobs: it pushes and pops its own jobs at
+ * the back (most recent first, which keeps split ranges hot in its cache) and when it runs dry it steals the
+ * oldest job from the front of another thread's deque. The thread that creates the job system is thread 0
+ * and helps run jobs whenever it waits, so a job system of N threads has N - 1 workers.
+ */
+class JobSystem
+{
+private:
+	// A queued job
+	struct Job
+	{
+		// The work to run
+		std::function<void()> m_function;
+		// The profiler zone open where the job was queued, zones opened by the job nest under it
+		int m_zone;
+	};
+
+	// A deque of jobs owned by one thread
+	struct WorkQueue
+	{
+		// Guards the deque against thieves
+		std::mutex m_mutex;
+		// The owner works from the back, thieves take from the front
+		std::deque<Job> m_jobs;
+	};
+
+	// Our worker threads
+	std::vector<std::thread> m_workers;
+	// One work queue per thread, index 0 belongs to the thread that created the job system
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+	// The amount of jobs waiting across every queue, lets idle workers sleep
+	std::atomic<int> m_queuedJobs;
+	// Used by idle workers to sleep until jobs are queued or the system is shutting down
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;
+	// Keeps the workers alive, cleared in the destructor
+	std::atomic<bool> m_running;
+
+	// The index of the current thread's work queue, -1 for threads that don't belong to the job system
+	static thread_local int s_threadIndex;
+
+	/**
+	 * The loop each worker thread runs until the job system is destroyed
+	 * @param _threadIndex int The index of this worker's work queue
+	 */
+	void WorkerLoop(int _threadIndex);
+
+	/**
+	 * Takes a job for a thread, from the back of its own queue or stolen from the front of another
+	 * @param _threadIndex int The index of the thread looking for work
+	 * @param _job Job& Set to the job found
+	 * @returns bool Returns true if a job was found
+	 */
+	bool PopJob(int _threadIndex, Job &_job);
+
+	/**
+	 * Runs a job inside the profiler zone it was queued from
+	 * @param _job Job& The job to run
+	 */
+	void RunJob(Job &_job);
+
+	/**
+	 * Pushes a job to the back of the current thread's queue without waking any workers
+	 * @param _job std::function<void()> The job to queue
+	 */
+	void Push(std::function<void()> _job);
+
+	// Wakes sleeping workers after jobs have been pushed
+	void WakeWorkers(bool _all);
+public:
+	/**
+	 * Constructs the job system and starts its worker threads
+	 * @param _threadCount int The amount of threads to run jobs on including the calling thread.
+	 *                     0 uses every hardware thread
+	 */
+	JobSystem(int _threadCount);
+	~JobSystem();
+
+	/**
+	 * Queues a job to be run by any thread
+	 * @param _job std::function<void()> The job to run
+	 */
+	void Submit(std::function<void()> _job);
+
+	/**
+	 * Runs a single queued job on the calling thread if one can be found
+	 * @returns bool Returns true if a job was run, false if there was no work
+	 */
+	bool RunPendingJob();
+
+	/**
+	 * Runs queued jobs on the calling thread until a counter reaches zero
+	 * @param _counter std::atomic<int>& The counter to wait on, decremented by the jobs being waited for
+	 */
+	void Wait(std::atomic<int> &_counter);
+
+	/**
+	 * Splits the range [_begin, _end) into chunks and runs them across the threads, returning once every
+	 * chunk has finished
+	 * @param _begin int The first index of the range
+	 * @param _end int One past the last index of the range
+	 * @param _grainSize int The maximum amount of indices handed to a job at once
+	 * @param _function Function Called as _function(int _chunkBegin, int _chunkEnd) for each chunk
+	 */
+	template <typename Function>
+	void ParallelFor(int _begin, int _end, int _grainSize, Function _function);
+
+	// Getters
+	int GetThreadCount() { return (int)m_queues.size(); }
+	// The index of the calling thread in the job system, -1 if it doesn't belong to it
+	static int GetThreadIndex() { return s_threadIndex; }
+};
+
+/**
+ * Splits the range [_begin, _end) into chunks and runs them across the threads, returning once every
+ * chunk has finished
+ * @param _begin int The first index of the range
+ * @param _end int One past the last index of the range
+ * @param _grainSize int The maximum amount of indices handed to a job at once
+ * @param _function Function Called as _function(int _chunkBegin, int _chunkEnd) for each chunk
+ */
+template <typename Function>
+void JobSystem::ParallelFor(int _begin, int _end, int _grainSize, Function _function)
+{
+	if (_grainSize < 1)
+	{
+		_grainSize = 1;
+	}
+
+	// Don't bother the workers for a single chunk
+	if (m_workers.empty() || _end - _begin <= _grainSize)
+	{
+		if (_end > _begin)
+		{
+			_function(_begin, _end);
+		}
+		return;
+	}
+
+	// The amount of chunks still to finish
+	std::atomic<int> m_remaining((_end - _begin + _grainSize - 1) / _grainSize);
+
+	// Queue every chunk but the first on our own deque for the other threads to steal
+	for (int m_chunk = _begin + _grainSize; m_chunk < _end; m_chunk += _grainSize)
+	{
+		int m_chunkEnd = std::min(m_chunk + _grainSize, _end);
+		Push([&_function, &m_remaining, m_chunk, m_chunkEnd]()
+		{
+			_function(m_chunk, m_chunkEnd);
+			m_remaining--;
+		});
+	}
+	WakeWorkers(true);
+
+	// Run the first chunk ourselves, then help until every chunk of ours has finished
+	_function(_begin, std::min(_begin + _grainSize, _end));
+	m_remaining--;
+	Wait(m_remaining);
+}
+#endif // !_JOBSYSTEM_H_
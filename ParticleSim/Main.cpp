@@ -10,5 +10,11 @@
 
 int main(int argc, char* argv[])
 {
+	// Read our command line options, eg: --headless
+	if (!Application::Instance()->ParseArguments(argc, argv))
+	{
+		return -1;
+	}
+
 	return (Application::Instance()->Run() ? 0 : -1);
 }
\ No newline at end of file
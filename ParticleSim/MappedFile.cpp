@@ -0,0 +1,135 @@
+#include "Stdafx.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	m_data = nullptr;
+	m_size = 0;
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = nullptr;
+#else
+	m_file = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/**
+ * Maps a file into memory, closing anything already open
+ * @param _inputFile const std::string& The file to map
+ * @returns bool Returns false if the file couldn't be opened or mapped
+ */
+bool MappedFile::Open(const std::string &_inputFile)
+{
+	Close();
+
+#ifdef _WIN32
+	m_file = CreateFileA(_inputFile.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "Failed to open " << _inputFile << " for mapping\n";
+		return false;
+	}
+
+	LARGE_INTEGER m_fileSize;
+	if (!GetFileSizeEx(m_file, &m_fileSize) || m_fileSize.QuadPart == 0)
+	{
+		std::cerr << "Failed to map " << _inputFile << ", it is empty\n";
+		Close();
+		return false;
+	}
+	m_size = (size_t)m_fileSize.QuadPart;
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		std::cerr << "Failed to map " << _inputFile << "\n";
+		Close();
+		return false;
+	}
+	m_data = (const Uint8*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	m_file = open(_inputFile.c_str(), O_RDONLY);
+	if (m_file < 0)
+	{
+		std::cerr << "Failed to open " << _inputFile << " for mapping\n";
+		return false;
+	}
+
+	struct stat m_stat;
+	if (fstat(m_file, &m_stat) != 0 || m_stat.st_size == 0)
+	{
+		std::cerr << "Failed to map " << _inputFile << ", it is empty\n";
+		Close();
+		return false;
+	}
+	m_size = (size_t)m_stat.st_size;
+
+	void* m_mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	m_data = (m_mapped == MAP_FAILED ? nullptr : (const Uint8*)m_mapped);
+	if (m_data != nullptr)
+	{
+		// Everything is read front to back
+		madvise(m_mapped, m_size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	if (m_data == nullptr)
+	{
+		std::cerr << "Failed to map " << _inputFile << "\n";
+		Close();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Unmaps the file, anything pointing into it is no longer valid
+ */
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+	}
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+	}
+	m_mapping = nullptr;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if (m_data != nullptr)
+	{
+		munmap((void*)m_data, m_size);
+	}
+	if (m_file >= 0)
+	{
+		close(m_file);
+	}
+	m_file = -1;
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -0,0 +1,45 @@
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+/**
+ * Maps a whole file into memory read only, so it can be read in place without copying it through a stream.
+ * Pages are only read from disk when they are first touched. Uses file mappings on Windows and mmap everywhere
+ * else.
+ */
+class MappedFile
+{
+private:
+	// The start of the mapped file, nullptr when nothing is open
+	const Uint8* m_data;
+	// The size of the file in bytes
+	size_t m_size;
+
+#ifdef _WIN32
+	// The file and mapping handles
+	void* m_file;
+	void* m_mapping;
+#else
+	// The file descriptor
+	int m_file;
+#endif
+public:
+	MappedFile();
+	~MappedFile();
+
+	/**
+	 * Maps a file into memory, closing anything already open
+	 * @param _inputFile const std::string& The file to map
+	 * @returns bool Returns false if the file couldn't be opened or mapped
+	 */
+	bool Open(const std::string &_inputFile);
+
+	/**
+	 * Unmaps the file, anything pointing into it is no longer valid
+	 */
+	void Close();
+
+	// Getters
+	const Uint8* GetData() { return m_data; }
+	size_t GetSize() { return m_size; }
+	bool IsOpen() { return m_data != nullptr; }
+};
+#endif // !_MAPPEDFILE_H_
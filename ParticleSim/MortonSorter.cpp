@@ -0,0 +1,186 @@
+#include "Stdafx.h"
+#include "MortonSorter.h"
+
+/**
+ * Constructs a sorter
+ * @param _jobs JobSystem* The job system to sort across
+ */
+MortonSorter::MortonSorter(JobSystem* _jobs)
+{
+	m_jobs = _jobs;
+}
+
+MortonSorter::~MortonSorter()
+{
+}
+
+/**
+ * Spreads the bits of a 16 bit value out to the even bits of a 32 bit value
+ * @param _value Uint32 The value to spread
+ * @returns Uint32 The spread value
+ */
+Uint32 MortonSorter::SpreadBits(Uint32 _value)
+{
+	_value &= 0x0000FFFF;
+	_value = (_value | (_value << 8)) & 0x00FF00FF;
+	_value = (_value | (_value << 4)) & 0x0F0F0F0F;
+	_value = (_value | (_value << 2)) & 0x33333333;
+	_value = (_value | (_value << 1)) & 0x55555555;
+	return _value;
+}
+
+/**
+ * Reorders every particle along the Z-order curve of the cells they are in
+ * @param _particles ParticleStore& The particles to reorder
+ * @param _cellSize int The size of the cells the curve runs through, normally the broad phase's cell size
+ */
+void MortonSorter::Sort(ParticleStore &_particles, int _cellSize)
+{
+	int m_count = _particles.Size();
+	if (m_count < 2)
+	{
+		return;
+	}
+
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float m_cellSize = (float)_cellSize;
+	int m_chunks = (m_count + KEYS_PER_JOB - 1) / KEYS_PER_JOB;
+
+	m_keys.resize(m_count);
+	m_keysScratch.resize(m_count);
+	m_order.resize(m_count);
+	m_orderScratch.resize(m_count);
+	m_histograms.resize(m_chunks * RADIX_SIZE);
+	m_chunkMinX.resize(m_chunks);
+	m_chunkMinY.resize(m_chunks);
+
+	// Find the smallest cell so the keys start from 0, particles can be anywhere in an unbounded world
+	m_jobs->ParallelFor(0, m_chunks, 1, [&](int _begin, int _end)
+	{
+		for (int c = _begin; c < _end; c++)
+		{
+			float m_minX = FLT_MAX, m_minY = FLT_MAX;
+			for (int i = c * KEYS_PER_JOB; i < std::min((c + 1) * KEYS_PER_JOB, m_count); i++)
+			{
+				if (std::isfinite(m_x[i]) && std::isfinite(m_y[i]))
+				{
+					m_minX = std::min(m_minX, floorf(m_x[i] / m_cellSize));
+					m_minY = std::min(m_minY, floorf(m_y[i] / m_cellSize));
+				}
+			}
+			m_chunkMinX[c] = m_minX;
+			m_chunkMinY[c] = m_minY;
+		}
+	});
+	float m_minX = *std::min_element(m_chunkMinX.begin(), m_chunkMinX.end());
+	float m_minY = *std::min_element(m_chunkMinY.begin(), m_chunkMinY.end());
+
+	// Key every particle by its cell. Coordinates are kept as floats until they are clamped so cells far out can't
+	// overflow, and particles without a position sort to the end
+	m_jobs->ParallelFor(0, m_count, KEYS_PER_JOB, [&](int _begin, int _end)
+	{
+		for (int i = _begin; i < _end; i++)
+		{
+			m_order[i] = i;
+			if (!std::isfinite(m_x[i]) || !std::isfinite(m_y[i]))
+			{
+				m_keys[i] = 0xFFFFFFFF;
+				continue;
+			}
+			float m_column = std::min(floorf(m_x[i] / m_cellSize) - m_minX, (float)MAX_CELL_COORD);
+			float m_row = std::min(floorf(m_y[i] / m_cellSize) - m_minY, (float)MAX_CELL_COORD);
+			m_keys[i] = MortonCode((Uint32)m_column, (Uint32)m_row);
+		}
+	});
+
+	// Nothing to do if the particles haven't moved out of order since the last sort
+	if (std::is_sorted(m_keys.begin(), m_keys.end()))
+	{
+		return;
+	}
+
+	for (int m_shift = 0; m_shift < 32; m_shift += RADIX_BITS)
+	{
+		// Count the digits in each chunk
+		m_jobs->ParallelFor(0, m_chunks, 1, [&](int _begin, int _end)
+		{
+			for (int c = _begin; c < _end; c++)
+			{
+				int* m_histogram = &m_histograms[c * RADIX_SIZE];
+				std::fill(m_histogram, m_histogram + RADIX_SIZE, 0);
+				for (int i = c * KEYS_PER_JOB; i < std::min((c + 1) * KEYS_PER_JOB, m_count); i++)
+				{
+					m_histogram[(m_keys[i] >> m_shift) & (RADIX_SIZE - 1)]++;
+				}
+			}
+		});
+
+		// Turn the counts into where each chunk writes each digit, every chunk's run of a digit following the run of
+		// the chunk before so the pass is stable. A digit every key shares leaves the order as it is, so skip it
+		bool m_oneDigit = false;
+		int m_offset = 0;
+		for (int d = 0; d < RADIX_SIZE; d++)
+		{
+			int m_digitStart = m_offset;
+			for (int c = 0; c < m_chunks; c++)
+			{
+				int m_digits = m_histograms[c * RADIX_SIZE + d];
+				m_histograms[c * RADIX_SIZE + d] = m_offset;
+				m_offset += m_digits;
+			}
+			if (m_offset - m_digitStart == m_count)
+			{
+				m_oneDigit = true;
+			}
+		}
+		if (m_oneDigit)
+		{
+			continue;
+		}
+
+		// Scatter each chunk into place
+		m_jobs->ParallelFor(0, m_chunks, 1, [&](int _begin, int _end)
+		{
+			for (int c = _begin; c < _end; c++)
+			{
+				int* m_cursor = &m_histograms[c * RADIX_SIZE];
+				for (int i = c * KEYS_PER_JOB; i < std::min((c + 1) * KEYS_PER_JOB, m_count); i++)
+				{
+					int m_position = m_cursor[(m_keys[i] >> m_shift) & (RADIX_SIZE - 1)]++;
+					m_keysScratch[m_position] = m_keys[i];
+					m_orderScratch[m_position] = m_order[i];
+				}
+			}
+		});
+		m_keys.swap(m_keysScratch);
+		m_order.swap(m_orderScratch);
+	}
+
+	_particles.Permute(m_order.data());
+}
+
+/**
+ * Measures how close in memory particles are to the particle before them in a broad phase's cell order, which is
+ * the order the collision pass reads them in
+ * @param _sortedIndices const int* The particle indices in the order the broad phase walks them
+ * @param _count int The amount of indices
+ * @returns float The fraction of particles within LOCALITY_WINDOW indices of the one before, 1 if there are none
+ */
+float MortonSorter::MeasureLocality(const int* _sortedIndices, int _count)
+{
+	if (_count < 2)
+	{
+		return 1.0f;
+	}
+
+	int m_close = 0;
+	for (int k = 1; k < _count; k++)
+	{
+		if (abs(_sortedIndices[k] - _sortedIndices[k - 1]) <= LOCALITY_WINDOW)
+		{
+			m_close++;
+		}
+	}
+	return (float)m_close / (_count - 1);
+}
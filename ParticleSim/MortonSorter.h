@@ -0,0 +1,73 @@
+#ifndef _MORTONSORTER_H_
+#define _MORTONSORTER_H_
+/**
+ * Reorders the particle store along a Z-order (Morton) curve of the cells the particles are in, so particles that
+ * are close on the screen are close in memory and the collision pass walking a cell's neighbours touches a few cache
+ * lines rather than one per particle. Each particle's cell coordinates are interleaved into a 32 bit key and the keys
+ * are sorted with a parallel least significant digit radix sort: every job counts the digits in its chunk, the
+ * counts are prefix summed digit by digit across the chunks, then every job scatters its chunk. Each pass is stable,
+ * so the order only depends on the particles and never on the thread count.
+ */
+class MortonSorter
+{
+private:
+	// The bits sorted in each radix pass, and the amount of digits that gives
+	static const int RADIX_BITS = 8;
+	static const int RADIX_SIZE = 1 << RADIX_BITS;
+	// The amount of keys each job counts and scatters
+	static const int KEYS_PER_JOB = 8192;
+	// The most cells along each axis that get a key of their own, cells further out share the edge key
+	static const int MAX_CELL_COORD = 0xFFFF;
+	// How far apart in memory two particles can be and still count as close, about a cache line of each array
+	static const int LOCALITY_WINDOW = 16;
+
+	// The job system the sort runs across
+	JobSystem* m_jobs;
+
+	// The key and old index of every particle, and the buffers each radix pass scatters them into
+	std::vector<Uint32> m_keys, m_keysScratch;
+	std::vector<int> m_order, m_orderScratch;
+	// The digit counts of each chunk, turned into each chunk's scatter offsets
+	std::vector<int> m_histograms;
+	// The smallest cell coordinates in each chunk, for unbounded worlds where cells can be negative
+	std::vector<float> m_chunkMinX, m_chunkMinY;
+
+	/**
+	 * Spreads the bits of a 16 bit value out to the even bits of a 32 bit value
+	 * @param _value Uint32 The value to spread
+	 * @returns Uint32 The spread value
+	 */
+	static Uint32 SpreadBits(Uint32 _value);
+public:
+	/**
+	 * Constructs a sorter
+	 * @param _jobs JobSystem* The job system to sort across
+	 */
+	MortonSorter(JobSystem* _jobs);
+	~MortonSorter();
+
+	/**
+	 * Reorders every particle along the Z-order curve of the cells they are in
+	 * @param _particles ParticleStore& The particles to reorder
+	 * @param _cellSize int The size of the cells the curve runs through, normally the broad phase's cell size
+	 */
+	void Sort(ParticleStore &_particles, int _cellSize);
+
+	/**
+	 * Measures how close in memory particles are to the particle before them in a broad phase's cell order, which is
+	 * the order the collision pass reads them in
+	 * @param _sortedIndices const int* The particle indices in the order the broad phase walks them
+	 * @param _count int The amount of indices
+	 * @returns float The fraction of particles within LOCALITY_WINDOW indices of the one before, 1 if there are none
+	 */
+	static float MeasureLocality(const int* _sortedIndices, int _count);
+
+	/**
+	 * Interleaves two cell coordinates into a Morton code, x in the even bits and y in the odd bits
+	 * @param _x Uint32 The cell column, up to 16 bits
+	 * @param _y Uint32 The cell row, up to 16 bits
+	 * @returns Uint32 The Morton code
+	 */
+	static Uint32 MortonCode(Uint32 _x, Uint32 _y) { return SpreadBits(_x) | (SpreadBits(_y) << 1); }
+};
+#endif // !_MORTONSORTER_H_
@@ -0,0 +1,140 @@
+#include "Stdafx.h"
+#include "ParticleRenderer.h"
+
+/**
+ * Constructs a particle renderer
+ * @param _jobs JobSystem* The job system the draw list is built across
+ */
+ParticleRenderer::ParticleRenderer(JobSystem* _jobs)
+{
+	m_jobs = _jobs;
+	m_drawCalls = 0;
+}
+
+ParticleRenderer::~ParticleRenderer()
+{
+}
+
+/**
+ * Draws every particle to the screen
+ * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+ * @param _particles ParticleStore& The particles to draw
+ * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+ */
+void ParticleRenderer::Draw(SDL_Renderer* _renderer, ParticleStore &_particles, float _alpha)
+{
+	int m_size = _particles.Size();
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_lastX = _particles.LastX();
+	float* m_lastY = _particles.LastY();
+	SDL_Color* m_colour = _particles.Colour();
+
+	m_drawCalls = 0;
+	if (m_size == 0)
+	{
+		return;
+	}
+
+#ifdef PARTICLERENDERER_GEOMETRY
+	// The indices only depend on the particle count, so only write the new ones when it grows
+	int m_indexedParticles = (int)m_indices.size() / 6;
+	if (m_indexedParticles < m_size)
+	{
+		m_indices.resize(m_size * 6);
+		for (int i = m_indexedParticles; i < m_size; i++)
+		{
+			int m_vertex = i * 4;
+			int* m_index = &m_indices[i * 6];
+			m_index[0] = m_vertex;
+			m_index[1] = m_vertex + 1;
+			m_index[2] = m_vertex + 2;
+			m_index[3] = m_vertex + 2;
+			m_index[4] = m_vertex + 1;
+			m_index[5] = m_vertex + 3;
+		}
+	}
+	m_vertices.resize(m_size * 4);
+
+	// A one pixel quad per particle covering the pixel it would have been drawn as a point
+	SDL_Vertex* m_vertexData = m_vertices.data();
+	m_jobs->ParallelFor(0, m_size, PARTICLES_PER_JOB, [&](int _begin, int _end)
+	{
+		for (int i = _begin; i < _end; i++)
+		{
+			// Between the last and current position, snapped to the pixel grid like a point
+			float m_left = floorf(m_lastX[i] + (m_x[i] - m_lastX[i]) * _alpha);
+			float m_top = floorf(m_lastY[i] + (m_y[i] - m_lastY[i]) * _alpha);
+			SDL_Color m_vertexColour = { m_colour[i].r, m_colour[i].g, m_colour[i].b, 255 };
+
+			SDL_Vertex* m_quad = &m_vertexData[i * 4];
+			m_quad[0].position = { m_left, m_top };
+			m_quad[1].position = { m_left + 1.0f, m_top };
+			m_quad[2].position = { m_left, m_top + 1.0f };
+			m_quad[3].position = { m_left + 1.0f, m_top + 1.0f };
+			for (int v = 0; v < 4; v++)
+			{
+				m_quad[v].color = m_vertexColour;
+				m_quad[v].tex_coord = { 0.0f, 0.0f };
+			}
+		}
+	});
+
+	// Everything in one call
+	SDL_RenderGeometry(_renderer, nullptr, m_vertexData, m_size * 4, m_indices.data(), m_size * 6);
+	m_drawCalls = 1;
+#else
+	m_points.resize(m_size);
+	m_particleBucket.resize(m_size);
+	m_sortedPoints.resize(m_size);
+	m_bucketStart.assign(COLOUR_BUCKETS + 1, 0);
+
+	// Work out every particle's point and colour bucket
+	m_jobs->ParallelFor(0, m_size, PARTICLES_PER_JOB, [&](int _begin, int _end)
+	{
+		for (int i = _begin; i < _end; i++)
+		{
+			m_points[i].x = (int)(m_lastX[i] + (m_x[i] - m_lastX[i]) * _alpha);
+			m_points[i].y = (int)(m_lastY[i] + (m_y[i] - m_lastY[i]) * _alpha);
+			m_particleBucket[i] = ((m_colour[i].r >> (8 - COLOUR_BITS)) << (COLOUR_BITS * 2)) |
+				((m_colour[i].g >> (8 - COLOUR_BITS)) << COLOUR_BITS) | (m_colour[i].b >> (8 - COLOUR_BITS));
+		}
+	});
+
+	// Counting sort the points by bucket, the same way the cell grid sorts particles by cell
+	for (int i = 0; i < m_size; i++)
+	{
+		m_bucketStart[m_particleBucket[i] + 1]++;
+	}
+	for (int b = 0; b < COLOUR_BUCKETS; b++)
+	{
+		m_bucketStart[b + 1] += m_bucketStart[b];
+	}
+	for (int i = 0; i < m_size; i++)
+	{
+		// Each bucket's start doubles as its cursor, leaving it at the bucket's end once every point is placed
+		m_sortedPoints[m_bucketStart[m_particleBucket[i]]++] = m_points[i];
+	}
+
+	// One colour change and one call per bucket in use. Bucket b now ends at m_bucketStart[b] and starts where
+	// the bucket before it ends
+	for (int b = 0; b < COLOUR_BUCKETS; b++)
+	{
+		int m_begin = (b == 0 ? 0 : m_bucketStart[b - 1]);
+		int m_count = m_bucketStart[b] - m_begin;
+		if (m_count == 0)
+		{
+			continue;
+		}
+
+		// Spread the bucket's bits across the whole channel so white stays white
+		Uint8 m_red = (Uint8)(((b >> (COLOUR_BITS * 2)) & 15) * 17);
+		Uint8 m_green = (Uint8)(((b >> COLOUR_BITS) & 15) * 17);
+		Uint8 m_blue = (Uint8)((b & 15) * 17);
+
+		SDL_SetRenderDrawColor(_renderer, m_red, m_green, m_blue, 255);
+		SDL_RenderDrawPoints(_renderer, &m_sortedPoints[m_begin], m_count);
+		m_drawCalls++;
+	}
+#endif
+}
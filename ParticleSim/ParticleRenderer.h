@@ -0,0 +1,64 @@
+#ifndef _PARTICLERENDERER_H_
+#define _PARTICLERENDERER_H_
+
+// SDL_RenderGeometry arrived in SDL 2.0.18, older versions fall back to batched points
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define PARTICLERENDERER_GEOMETRY
+#endif
+
+/**
+ * Draws every particle in a handful of renderer calls instead of a colour change and a point per particle.
+ * With SDL 2.0.18 or newer each particle is a one pixel coloured quad and the whole store goes out in a single
+ * SDL_RenderGeometry call. Older versions bucket the particles by colour, quantised to 4 bits a channel, and
+ * draw each bucket with one SDL_RenderDrawPoints call. Both work with the software renderer. The per-particle
+ * work is split across the job system.
+ */
+class ParticleRenderer
+{
+private:
+	// The bits kept of each colour channel when bucketing by colour
+	static const int COLOUR_BITS = 4;
+	// The amount of colour buckets
+	static const int COLOUR_BUCKETS = 1 << (COLOUR_BITS * 3);
+	// The amount of particles handed to a job at once
+	static const int PARTICLES_PER_JOB = 8192;
+
+	// The job system the draw list is built across
+	JobSystem* m_jobs;
+	// The amount of renderer calls the last draw made
+	int m_drawCalls;
+
+#ifdef PARTICLERENDERER_GEOMETRY
+	// Four vertices per particle
+	std::vector<SDL_Vertex> m_vertices;
+	// Six indices per particle, two triangles per quad. Only grows when the particle count does
+	std::vector<int> m_indices;
+#else
+	// Each particle's point and colour bucket
+	std::vector<SDL_Point> m_points;
+	std::vector<int> m_particleBucket;
+	// Where each bucket starts in m_sortedPoints, COLOUR_BUCKETS + 1 entries
+	std::vector<int> m_bucketStart;
+	// The points sorted by colour bucket
+	std::vector<SDL_Point> m_sortedPoints;
+#endif
+public:
+	/**
+	 * Constructs a particle renderer
+	 * @param _jobs JobSystem* The job system the draw list is built across
+	 */
+	ParticleRenderer(JobSystem* _jobs);
+	~ParticleRenderer();
+
+	/**
+	 * Draws every particle to the screen
+	 * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+	 * @param _particles ParticleStore& The particles to draw
+	 * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+	 */
+	void Draw(SDL_Renderer* _renderer, ParticleStore &_particles, float _alpha);
+
+	// Getters
+	int GetDrawCalls() { return m_drawCalls; }
+};
+#endif // !_PARTICLERENDERER_H_
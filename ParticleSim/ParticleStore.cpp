@@ -0,0 +1,483 @@
+#include "Stdafx.h"
+#include "ParticleStore.h"
+
+/**
+ * Constructs an empty particle store
+ * @param _screenWidth int The width of the screen the particles are kept within
+ * @param _screenHeight int The height of the screen the particles are kept within
+ * @param _velocityMax float Maximum velocity reached via acceleration
+ * @param _profiler FPSProfiler* The profiler used to count collision checks
+ */
+ParticleStore::ParticleStore(int _screenWidth, int _screenHeight, float _velocityMax, FPSProfiler* _profiler)
+{
+	m_screenWidth = _screenWidth;
+	m_screenHeight = _screenHeight;
+	m_velocityMax = _velocityMax;
+	m_profiler = _profiler;
+	m_bounded = true;
+	m_generation = 0;
+}
+
+ParticleStore::~ParticleStore()
+{
+}
+
+/**
+ * Adds a particle to the end of the store
+ * @param _position glm::vec2 The starting position
+ * @param _velocity glm::vec2 The starting velocity
+ * @param _acceleration glm::vec2 The constant acceleration
+ * @param _colour glm::vec3 The colour of the particle
+ * @param _radius float The radius of the particle
+ * @returns int The particle's id
+ */
+int ParticleStore::Add(glm::vec2 _position, glm::vec2 _velocity, glm::vec2 _acceleration, glm::vec3 _colour, float _radius)
+{
+	// Grow geometrically rather than leaving it to each array
+	if (Size() == Capacity())
+	{
+		Reserve(Size() + 1);
+	}
+
+	// Reuse a released id before making a new one
+	int m_newId;
+	if (!m_freeIds.empty())
+	{
+		m_newId = m_freeIds.back();
+		m_freeIds.pop_back();
+	}
+	else
+	{
+		m_newId = (int)m_slot.size();
+		m_slot.push_back(-1);
+	}
+	m_slot[m_newId] = Size();
+	m_id.push_back(m_newId);
+
+	m_x.push_back(_position.x);
+	m_y.push_back(_position.y);
+	m_lastX.push_back(_position.x);
+	m_lastY.push_back(_position.y);
+	m_vx.push_back(_velocity.x);
+	m_vy.push_back(_velocity.y);
+	m_ax.push_back(_acceleration.x);
+	m_ay.push_back(_acceleration.y);
+	m_radius.push_back(_radius);
+	// Colour channels wrap into a byte the same way the renderer used to receive them
+	m_colour.push_back({ (Uint8)(int)_colour.r, (Uint8)(int)_colour.g, (Uint8)(int)_colour.b, 255 });
+	m_generation++;
+
+	return m_newId;
+}
+
+/**
+ * Removes particles from the end of the store
+ * @param _amount int Amount of particles to remove, nothing is removed unless it is above 0
+ */
+void ParticleStore::Remove(int _amount)
+{
+	// A negative amount would grow the arrays past the ids, and removing nothing shouldn't make the broad phases
+	// start again
+	if (_amount <= 0)
+	{
+		return;
+	}
+
+	// Work out the new size, making sure we don't go below 0
+	int m_size = Size() - _amount;
+	if (m_size < 0)
+	{
+		m_size = 0;
+	}
+
+	// Release the ids of everything past the new end
+	for (int i = m_size; i < Size(); i++)
+	{
+		m_slot[m_id[i]] = -1;
+		m_freeIds.push_back(m_id[i]);
+	}
+
+	m_id.resize(m_size);
+	m_x.resize(m_size);
+	m_y.resize(m_size);
+	m_lastX.resize(m_size);
+	m_lastY.resize(m_size);
+	m_vx.resize(m_size);
+	m_vy.resize(m_size);
+	m_ax.resize(m_size);
+	m_ay.resize(m_size);
+	m_radius.resize(m_size);
+	m_colour.resize(m_size);
+	m_generation++;
+}
+
+/**
+ * Removes a particle by id, moving the last particle into its place
+ * @param _id int The id of the particle to remove
+ * @returns bool Returns false if the id isn't in use
+ */
+bool ParticleStore::RemoveById(int _id)
+{
+	int m_index = IndexOf(_id);
+	if (m_index < 0)
+	{
+		return false;
+	}
+
+	// Swap the last particle into the hole, then pop the end
+	int m_last = Size() - 1;
+	if (m_index != m_last)
+	{
+		m_x[m_index] = m_x[m_last];
+		m_y[m_index] = m_y[m_last];
+		m_lastX[m_index] = m_lastX[m_last];
+		m_lastY[m_index] = m_lastY[m_last];
+		m_vx[m_index] = m_vx[m_last];
+		m_vy[m_index] = m_vy[m_last];
+		m_ax[m_index] = m_ax[m_last];
+		m_ay[m_index] = m_ay[m_last];
+		m_radius[m_index] = m_radius[m_last];
+		m_colour[m_index] = m_colour[m_last];
+		m_id[m_index] = m_id[m_last];
+		m_slot[m_id[m_index]] = m_index;
+	}
+
+	// Popping the end releases the removed id
+	m_id[m_last] = _id;
+	Remove(1);
+	return true;
+}
+
+/**
+ * Removes every particle and releases every id
+ */
+void ParticleStore::Clear()
+{
+	// Nothing is in use, so the ids can simply start again from 0
+	Remove(Size());
+	m_slot.clear();
+	m_freeIds.clear();
+}
+
+/**
+ * Replaces every particle with an amount of uninitialised particles with the ids 0 to _size - 1, ready to
+ * be filled in through the array getters
+ * @param _size int The amount of particles
+ */
+void ParticleStore::Resize(int _size)
+{
+	Clear();
+	Reserve(_size);
+
+	m_x.resize(_size);
+	m_y.resize(_size);
+	m_lastX.resize(_size);
+	m_lastY.resize(_size);
+	m_vx.resize(_size);
+	m_vy.resize(_size);
+	m_ax.resize(_size);
+	m_ay.resize(_size);
+	m_radius.resize(_size);
+	m_colour.resize(_size);
+	m_id.resize(_size);
+	m_slot.resize(_size);
+	for (int i = 0; i < _size; i++)
+	{
+		m_id[i] = i;
+		m_slot[i] = i;
+	}
+	m_generation++;
+}
+
+/**
+ * Rebuilds the slot table and free list from the ids, after they have been filled in through Id()
+ */
+void ParticleStore::RebuildIds()
+{
+	int m_maxId = -1;
+	for (int i = 0; i < Size(); i++)
+	{
+		m_maxId = std::max(m_maxId, m_id[i]);
+	}
+
+	m_slot.assign(m_maxId + 1, -1);
+	for (int i = 0; i < Size(); i++)
+	{
+		m_slot[m_id[i]] = i;
+	}
+
+	// Every gap below the largest id is free, lowest handed out first
+	m_freeIds.clear();
+	for (int i = m_maxId; i >= 0; i--)
+	{
+		if (m_slot[i] < 0)
+		{
+			m_freeIds.push_back(i);
+		}
+	}
+}
+
+/**
+ * Gathers one particle array into a new order through a scratch buffer
+ * @param _array std::vector<T>& The array to reorder
+ * @param _order const int* The old index of each new index
+ * @param _scratch std::vector<char>& Room for the gathered array, grown if needed
+ */
+template <typename T>
+static void GatherArray(std::vector<T> &_array, const int* _order, std::vector<char> &_scratch)
+{
+	int m_size = (int)_array.size();
+	_scratch.resize(m_size * sizeof(T));
+	T* m_gathered = (T*)_scratch.data();
+	for (int i = 0; i < m_size; i++)
+	{
+		m_gathered[i] = _array[_order[i]];
+	}
+	std::copy(m_gathered, m_gathered + m_size, _array.begin());
+}
+
+/**
+ * Reorders the particles so the particle at index _order[i] moves to index i. Ids follow their particles
+ * @param _order const int* The old index of each new index, every index from 0 to Size() - 1 exactly once
+ */
+void ParticleStore::Permute(const int* _order)
+{
+	// Copying back into the arrays rather than swapping buffers keeps the capacity they have grown to
+	GatherArray(m_x, _order, m_scratch);
+	GatherArray(m_y, _order, m_scratch);
+	GatherArray(m_lastX, _order, m_scratch);
+	GatherArray(m_lastY, _order, m_scratch);
+	GatherArray(m_vx, _order, m_scratch);
+	GatherArray(m_vy, _order, m_scratch);
+	GatherArray(m_ax, _order, m_scratch);
+	GatherArray(m_ay, _order, m_scratch);
+	GatherArray(m_radius, _order, m_scratch);
+	GatherArray(m_colour, _order, m_scratch);
+	GatherArray(m_id, _order, m_scratch);
+
+	for (int i = 0; i < Size(); i++)
+	{
+		m_slot[m_id[i]] = i;
+	}
+	m_generation++;
+}
+
+/**
+ * Checks a set of ids could be given to a store, none negative, too large or used twice
+ * @param _ids const int* The ids
+ * @param _count int The amount of ids
+ * @returns bool Returns true if the ids are valid
+ */
+bool ParticleStore::ValidateIds(const int* _ids, int _count)
+{
+	std::vector<bool> m_used;
+	for (int i = 0; i < _count; i++)
+	{
+		if (_ids[i] < 0 || _ids[i] >= MAX_ID)
+		{
+			return false;
+		}
+		if (_ids[i] >= (int)m_used.size())
+		{
+			m_used.resize(std::max(_ids[i] + 1, (int)m_used.size() * 2), false);
+		}
+		if (m_used[_ids[i]])
+		{
+			return false;
+		}
+		m_used[_ids[i]] = true;
+	}
+	return true;
+}
+
+/**
+ * Checks the ids and the slot table agree: every particle's id leads back to its index, and every id not in use
+ * is on the free list once and leads nowhere
+ * @returns bool Returns true if the ids are consistent
+ */
+bool ParticleStore::CheckIds()
+{
+	for (int i = 0; i < Size(); i++)
+	{
+		if (IndexOf(m_id[i]) != i)
+		{
+			return false;
+		}
+	}
+
+	// Every slot is either a particle above or on the free list
+	if (Size() + (int)m_freeIds.size() != (int)m_slot.size() || !ValidateIds(m_freeIds.data(), (int)m_freeIds.size()))
+	{
+		return false;
+	}
+	for (unsigned int k = 0; k < m_freeIds.size(); k++)
+	{
+		if (IndexOf(m_freeIds[k]) != -1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Reserves room for a number of particles so adding them doesn't reallocate. Grows to at least double the
+ * current capacity so repeatedly reserving a little more stays amortised
+ * @param _capacity int The amount of particles to make room for
+ */
+void ParticleStore::Reserve(int _capacity)
+{
+	if (_capacity <= Capacity())
+	{
+		return;
+	}
+	_capacity = std::max(_capacity, Capacity() * 2);
+
+	m_id.reserve(_capacity);
+	m_slot.reserve(_capacity);
+	m_x.reserve(_capacity);
+	m_y.reserve(_capacity);
+	m_lastX.reserve(_capacity);
+	m_lastY.reserve(_capacity);
+	m_vx.reserve(_capacity);
+	m_vy.reserve(_capacity);
+	m_ax.reserve(_capacity);
+	m_ay.reserve(_capacity);
+	m_radius.reserve(_capacity);
+	m_colour.reserve(_capacity);
+}
+
+/**
+ * Check if two particles are colliding and respond to the collision if they are
+ * @param _a int The index of the first particle
+ * @param _b int The index of the second particle
+ * @returns bool Returns true if they are colliding, false if not
+ */
+bool ParticleStore::CheckCollision(int _a, int _b)
+{
+	// Get combined radii
+	float m_combinedRadii = m_radius[_a] + m_radius[_b];
+	// Calculate the difference between both circle centers
+	float m_diffX = m_x[_a] - m_x[_b];
+	float m_diffY = m_y[_a] - m_y[_b];
+	// Calculate the squared distance using pythagoras' beautiful theorem
+	float m_distanceSquared = m_diffX * m_diffX + m_diffY * m_diffY;
+
+	// Check if the overall distance is less than both the particles radii combined. Comparing the squares
+	// matches the collision kernel and leaves the square root to the pairs that actually collide
+	if (m_distanceSquared < m_combinedRadii * m_combinedRadii)
+	{
+		// Collision has been detected lets handle it
+		HandleCollision(_a, _b, m_diffX, m_diffY, sqrtf(m_distanceSquared), m_combinedRadii);
+		// Also return true
+		return true;
+	}
+	// No collision, return false
+	return false;
+}
+
+/**
+ * Handles the collision response for two particles. Calculates linear momentum as a response
+ * @param _a int The index of the first particle
+ * @param _b int The index of the second particle
+ * @param _diffX float The difference in x between the two particles (a - b)
+ * @param _diffY float The difference in y between the two particles (a - b)
+ * @param _distance float The distance between the two particles
+ * @param _combinedRadii float The combined radii of both particles
+ */
+void ParticleStore::HandleCollision(int _a, int _b, float _diffX, float _diffY, float _distance, float _combinedRadii)
+{
+	// normalise the difference vector
+	float m_normX = _diffX / _distance;
+	float m_normY = _diffY / _distance;
+
+	// Calculate how much the two particles are colliding by
+	float m_amount = -(_distance - _combinedRadii);
+
+	// Add the normal vector multiplied by the amount the particles are colliding by
+	m_x[_a] += m_normX * m_amount;
+	m_y[_a] += m_normY * m_amount;
+
+	// And negate it from the other particle
+	m_x[_b] -= m_normX * m_amount;
+	m_y[_b] -= m_normY * m_amount;
+
+	// Do the velocity inversion seperately for each axis
+	// Invert the velocities for X if the difference between x positions is greater than the combined radii /2
+	if (fabsf(_diffX) >= _combinedRadii / 2)
+	{
+		m_vx[_a] *= -1.0f;
+		m_vx[_b] *= -1.0f;
+	}
+
+	// Invert the velocities for Y if the difference between x positions is greater than the combined radii /2
+	if (fabsf(_diffY) >= _combinedRadii / 2)
+	{
+		m_vy[_a] *= -1.0f;
+		m_vy[_b] *= -1.0f;
+	}
+}
+
+/**
+ * Runs the integration pass over a range of particles, applying acceleration and velocity and bouncing
+ * them off the edges of the screen if the world is bounded. Particles don't affect each other here, so
+ * ranges can run in parallel
+ * @param _deltaTime float The time step to integrate over
+ * @param _begin int The index of the first particle to integrate
+ * @param _end int One past the index of the last particle to integrate
+ */
+void ParticleStore::Integrate(float _deltaTime, int _begin, int _end)
+{
+	for (int i = _begin; i < _end; i++)
+	{
+		// Acceleration - Velocity calculation
+		if (m_vx[i] < m_velocityMax)
+		{
+			m_vx[i] += m_ax[i] * _deltaTime;
+		}
+
+		if (m_vy[i] < m_velocityMax)
+		{
+			m_vy[i] += m_ay[i] * _deltaTime;
+		}
+
+		// Check to see if a particle is hitting the wall. if it is provide the correct response
+		if (m_bounded)
+		{
+			if (m_x[i] > m_screenWidth)
+			{
+				m_vx[i] = -m_vx[i];
+				m_x[i] = (float)(m_screenWidth - 1);
+			}
+			else if (m_x[i] < 0)
+			{
+				m_vx[i] = -m_vx[i];
+				m_x[i] = 1;
+			}
+
+			if (m_y[i] > m_screenHeight)
+			{
+				m_vy[i] = -m_vy[i];
+				m_y[i] = (float)(m_screenHeight - 1);
+			}
+			else if (m_y[i] < 0)
+			{
+				m_vy[i] = -m_vy[i];
+				m_y[i] = 1;
+			}
+		}
+
+		// Velocity - Position calculation
+		m_x[i] += m_vx[i] * _deltaTime;
+		m_y[i] += m_vy[i] * _deltaTime;
+	}
+}
+
+/**
+ * Stores the current positions as the last state, called before each fixed step
+ */
+void ParticleStore::StoreLastState()
+{
+	std::copy(m_x.begin(), m_x.end(), m_lastX.begin());
+	std::copy(m_y.begin(), m_y.end(), m_lastY.begin());
+}
@@ -0,0 +1,228 @@
+#ifndef _PARTICLESTORE_H_
+#define _PARTICLESTORE_H_
+/**
+ * Structure-of-arrays storage for every particle in the simulation. Each attribute (position, velocity,
+ * acceleration, radius and colour) lives in its own contiguous array, so the update passes only pull the
+ * fields they actually touch through the cache. Particles are addressed by their index into the arrays.
+ *
+ * Indices move when particles are removed, so every particle also has a stable id. Ids are handed out from a free
+ * list and map to the particle's current index through a slot table. Removing a particle by id swaps the last
+ * particle into its place and pops the end, so nothing after it has to shuffle down. The arrays grow geometrically
+ * and never shrink, so adding and removing particles in bulk doesn't touch the heap once they have grown.
+ */
+class ParticleStore
+{
+private:
+	// Particle positions
+	std::vector<float> m_x, m_y;
+	// Particle positions at the start of the current step, used to interpolate rendering
+	std::vector<float> m_lastX, m_lastY;
+	// Particle velocities (movement force)
+	std::vector<float> m_vx, m_vy;
+	// Particle accelerations (change in velocity)
+	std::vector<float> m_ax, m_ay;
+	// Particle radii
+	std::vector<float> m_radius;
+	// Particle colours
+	std::vector<SDL_Color> m_colour;
+	// Each particle's stable id
+	std::vector<int> m_id;
+
+	// The current index of each id, -1 for ids that are free
+	std::vector<int> m_slot;
+	// Ids that have been released and can be handed out again
+	std::vector<int> m_freeIds;
+	// Room to gather one array into while reordering the particles
+	std::vector<char> m_scratch;
+
+	// The largest id a store can be given from outside, keeps the slot table a sane size
+	static const int MAX_ID = 1 << 26;
+
+	// Maximum velocity reached via acceleration, shared by every particle
+	float m_velocityMax;
+	// The screen bounds the particles bounce around in
+	int m_screenWidth, m_screenHeight;
+	// Bounces particles off the screen bounds when true, lets them carry on out into an unbounded world when false
+	bool m_bounded;
+	// Counts every change to which particle is at which index, so anything caching indices can tell it is stale
+	unsigned int m_generation;
+
+	// Our profiler, used to count collision checks
+	FPSProfiler* m_profiler;
+
+	/**
+	 * Handles the collision response for two particles. Calculates linear momentum as a response
+	 * @param _a int The index of the first particle
+	 * @param _b int The index of the second particle
+	 * @param _diffX float The difference in x between the two particles (a - b)
+	 * @param _diffY float The difference in y between the two particles (a - b)
+	 * @param _distance float The distance between the two particles
+	 * @param _combinedRadii float The combined radii of both particles
+	 */
+	void HandleCollision(int _a, int _b, float _diffX, float _diffY, float _distance, float _combinedRadii);
+public:
+	/**
+	 * Constructs an empty particle store
+	 * @param _screenWidth int The width of the screen the particles are kept within
+	 * @param _screenHeight int The height of the screen the particles are kept within
+	 * @param _velocityMax float Maximum velocity reached via acceleration
+	 * @param _profiler FPSProfiler* The profiler used to count collision checks
+	 */
+	ParticleStore(int _screenWidth, int _screenHeight, float _velocityMax, FPSProfiler* _profiler);
+	~ParticleStore();
+
+	/**
+	 * Adds a particle to the end of the store
+	 * @param _position glm::vec2 The starting position
+	 * @param _velocity glm::vec2 The starting velocity
+	 * @param _acceleration glm::vec2 The constant acceleration
+	 * @param _colour glm::vec3 The colour of the particle
+	 * @param _radius float The radius of the particle
+	 * @returns int The particle's id
+	 */
+	int Add(glm::vec2 _position, glm::vec2 _velocity, glm::vec2 _acceleration, glm::vec3 _colour, float _radius);
+
+	/**
+	 * Removes particles from the end of the store
+	 * @param _amount int Amount of particles to remove, nothing is removed unless it is above 0
+	 */
+	void Remove(int _amount);
+
+	/**
+	 * Removes a particle by id, moving the last particle into its place
+	 * @param _id int The id of the particle to remove
+	 * @returns bool Returns false if the id isn't in use
+	 */
+	bool RemoveById(int _id);
+
+	/**
+	 * Removes every particle and releases every id
+	 */
+	void Clear();
+
+	/**
+	 * Replaces every particle with an amount of uninitialised particles with the ids 0 to _size - 1, ready to
+	 * be filled in through the array getters
+	 * @param _size int The amount of particles
+	 */
+	void Resize(int _size);
+
+	/**
+	 * Rebuilds the slot table and free list from the ids, after they have been filled in through Id()
+	 */
+	void RebuildIds();
+
+	/**
+	 * Reorders the particles so the particle at index _order[i] moves to index i. Ids follow their particles
+	 * @param _order const int* The old index of each new index, every index from 0 to Size() - 1 exactly once
+	 */
+	void Permute(const int* _order);
+
+	/**
+	 * Checks a set of ids could be given to a store, none negative, too large or used twice
+	 * @param _ids const int* The ids
+	 * @param _count int The amount of ids
+	 * @returns bool Returns true if the ids are valid
+	 */
+	static bool ValidateIds(const int* _ids, int _count);
+
+	/**
+	 * Checks the ids and the slot table agree: every particle's id leads back to its index, and every id not in use
+	 * is on the free list once and leads nowhere
+	 * @returns bool Returns true if the ids are consistent
+	 */
+	bool CheckIds();
+
+	/**
+	 * Reserves room for a number of particles so adding them doesn't reallocate. Grows to at least double the
+	 * current capacity so repeatedly reserving a little more stays amortised
+	 * @param _capacity int The amount of particles to make room for
+	 */
+	void Reserve(int _capacity);
+
+	/**
+	 * Runs the collision pass over every particle using a broad phase to find neighbours
+	 * @param _broadPhase TBroadPhase& The broad phase holding every particle. Anything with a
+	 *                   ForEachNeighbour(glm::vec2, float, Function) query can be used
+	 */
+	template <class TBroadPhase>
+	void SolveCollisions(TBroadPhase &_broadPhase);
+
+	/**
+	 * Check if two particles are colliding and respond to the collision if they are
+	 * @param _a int The index of the first particle
+	 * @param _b int The index of the second particle
+	 * @returns bool Returns true if they are colliding, false if not
+	 */
+	bool CheckCollision(int _a, int _b);
+
+	/**
+	 * Runs the integration pass over a range of particles, applying acceleration and velocity and bouncing
+	 * them off the edges of the screen if the world is bounded. Particles don't affect each other here, so
+	 * ranges can run in parallel
+	 * @param _deltaTime float The time step to integrate over
+	 * @param _begin int The index of the first particle to integrate
+	 * @param _end int One past the index of the last particle to integrate
+	 */
+	void Integrate(float _deltaTime, int _begin, int _end);
+
+	/**
+	 * Stores the current positions as the last state, called before each fixed step
+	 */
+	void StoreLastState();
+
+	// Setters
+	void SetBounded(bool _bounded) { m_bounded = _bounded; }
+
+	// Getters
+	int Size() { return (int)m_x.size(); }
+	bool IsBounded() { return m_bounded; }
+	unsigned int GetGeneration() { return m_generation; }
+	float* X() { return m_x.data(); }
+	float* Y() { return m_y.data(); }
+	float* LastX() { return m_lastX.data(); }
+	float* LastY() { return m_lastY.data(); }
+	float* VelocityX() { return m_vx.data(); }
+	float* VelocityY() { return m_vy.data(); }
+	float* AccelerationX() { return m_ax.data(); }
+	float* AccelerationY() { return m_ay.data(); }
+	float* Radius() { return m_radius.data(); }
+	SDL_Color* Colour() { return m_colour.data(); }
+	int* Id() { return m_id.data(); }
+	int IndexOf(int _id) { return (_id >= 0 && _id < (int)m_slot.size() ? m_slot[_id] : -1); }
+	int Capacity() { return (int)m_x.capacity(); }
+	glm::vec2 Position(int _index) { return glm::vec2(m_x[_index], m_y[_index]); }
+};
+
+/**
+ * Runs the collision pass over every particle using a broad phase to find neighbours
+ * @param _broadPhase TBroadPhase& The broad phase holding every particle. Anything with a
+ *                   ForEachNeighbour(glm::vec2, float, Function) query can be used
+ */
+template <class TBroadPhase>
+void ParticleStore::SolveCollisions(TBroadPhase &_broadPhase)
+{
+	CollisionCounts m_counts = { 0, 0, 0 };
+	for (int i = 0; i < Size(); i++)
+	{
+		// Walk the neighbours in place in the broad phase
+		_broadPhase.ForEachNeighbour(glm::vec2(m_x[i], m_y[i]), m_radius[i], [this, i, &m_counts](int _neighbour)
+		{
+			// Every neighbour handed over is a candidate, even the particle itself
+			m_counts.m_candidates++;
+			// Only check against particles before this one, each pair is then responded to from one side only.
+			// Responding from both sides would invert the velocities twice and cancel the response out
+			if (_neighbour < i)
+			{
+				m_counts.m_distanceTests++;
+				// Check the collision with this particle and the neighbour
+				if (CheckCollision(i, _neighbour))
+				{
+					m_counts.m_contacts++;
+				}
+			}
+		});
+	}
+	m_profiler->AddCollisionCounts(m_counts);
+}
+#endif // !_PARTICLESTORE_H_
@@ -0,0 +1,267 @@
+#include "Stdafx.h"
+#include "Rasteriser.h"
+
+/**
+ * Constructs a rasteriser for a framebuffer size
+ * @param _width int The width of the framebuffer in pixels
+ * @param _height int The height of the framebuffer in pixels
+ * @param _jobs JobSystem* The job system the bands are drawn across
+ */
+Rasteriser::Rasteriser(int _width, int _height, JobSystem* _jobs)
+{
+	m_width = _width;
+	m_height = _height;
+	m_bandCount = (_height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	m_jobs = _jobs;
+	m_texture = nullptr;
+}
+
+Rasteriser::~Rasteriser()
+{
+	if (m_texture != nullptr)
+	{
+		SDL_DestroyTexture(m_texture);
+	}
+}
+
+/**
+ * Creates the streaming texture particles are drawn into when there is a window
+ * @param _renderer SDL_Renderer* The renderer the texture belongs to
+ * @returns bool Returns false if the texture couldn't be made
+ */
+bool Rasteriser::CreateTexture(SDL_Renderer* _renderer)
+{
+	m_texture = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, m_width, m_height);
+	if (m_texture == nullptr)
+	{
+		std::cerr << "Failed to create the rasteriser texture. " << SDL_GetError() << "\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Works out every particle's screen position and sorts them into the bands they touch
+ * @param _particles ParticleStore& The particles to draw
+ * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+ */
+void Rasteriser::BinParticles(ParticleStore &_particles, float _alpha)
+{
+	int m_size = _particles.Size();
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_lastX = _particles.LastX();
+	float* m_lastY = _particles.LastY();
+	float* m_radius = _particles.Radius();
+
+	m_drawX.resize(m_size);
+	m_drawY.resize(m_size);
+	m_firstBand.resize(m_size);
+	m_lastBand.resize(m_size);
+	m_jobs->ParallelFor(0, m_size, PARTICLES_PER_JOB, [&](int _begin, int _end)
+	{
+		for (int i = _begin; i < _end; i++)
+		{
+			m_drawX[i] = m_lastX[i] + (m_x[i] - m_lastX[i]) * _alpha;
+			m_drawY[i] = m_lastY[i] + (m_y[i] - m_lastY[i]) * _alpha;
+
+			// A particle with no real position touches no bands
+			if (!std::isfinite(m_drawX[i]) || !std::isfinite(m_drawY[i]))
+			{
+				m_firstBand[i] = 0;
+				m_lastBand[i] = -1;
+				continue;
+			}
+
+			// Clamp the rows to the screen before converting so particles far off screen can't overflow, anything
+			// entirely above or below the screen ends up with its last band before its first
+			float m_top = std::min(std::max(floorf(m_drawY[i] - m_radius[i]), 0.0f), (float)m_height);
+			float m_bottom = std::min(floorf(m_drawY[i] + m_radius[i]), (float)m_height);
+			m_firstBand[i] = (int)m_top / BAND_HEIGHT;
+			m_lastBand[i] = (m_bottom < 0.0f ? -1 : std::min((int)m_bottom / BAND_HEIGHT, m_bandCount - 1));
+		}
+	});
+
+	// Counting sort the particles into every band between their top and bottom rows
+	m_bandStart.assign(m_bandCount + 1, 0);
+	int m_entries = 0;
+	for (int i = 0; i < m_size; i++)
+	{
+		for (int b = m_firstBand[i]; b <= m_lastBand[i]; b++)
+		{
+			m_bandStart[b + 1]++;
+			m_entries++;
+		}
+	}
+	for (int b = 0; b < m_bandCount; b++)
+	{
+		m_bandStart[b + 1] += m_bandStart[b];
+	}
+
+	// Scatter using each band's start as its cursor, then shift the starts back into place
+	m_bandParticles.resize(m_entries);
+	for (int i = 0; i < m_size; i++)
+	{
+		for (int b = m_firstBand[i]; b <= m_lastBand[i]; b++)
+		{
+			m_bandParticles[m_bandStart[b]++] = i;
+		}
+	}
+	for (int b = m_bandCount; b > 0; b--)
+	{
+		m_bandStart[b] = m_bandStart[b - 1];
+	}
+	m_bandStart[0] = 0;
+}
+
+/**
+ * Clears one band and fills in every particle touching it
+ * @param _particles ParticleStore& The particles to draw
+ * @param _band int The band to draw
+ * @param _pixels Uint32* The top left pixel of the framebuffer
+ * @param _pitch int The amount of pixels from the start of one row to the next
+ */
+void Rasteriser::DrawBand(ParticleStore &_particles, int _band, Uint32* _pixels, int _pitch)
+{
+	int m_top = _band * BAND_HEIGHT;
+	int m_bottom = std::min(m_top + BAND_HEIGHT, m_height);
+	float* m_radius = _particles.Radius();
+	SDL_Color* m_colour = _particles.Colour();
+
+	// Clear the band
+	for (int y = m_top; y < m_bottom; y++)
+	{
+		std::fill(_pixels + y * _pitch, _pixels + y * _pitch + m_width, CLEAR_COLOUR);
+	}
+
+	for (int k = m_bandStart[_band]; k < m_bandStart[_band + 1]; k++)
+	{
+		int i = m_bandParticles[k];
+		float m_centreX = m_drawX[i];
+		float m_centreY = m_drawY[i];
+		float m_radiusSquared = m_radius[i] * m_radius[i];
+		Uint32 m_pixel = 0xFF000000 | (m_colour[i].r << 16) | (m_colour[i].g << 8) | m_colour[i].b;
+
+		// Particles too small to cover a pixel centre still light the pixel they are in
+		if (m_radius[i] < 0.5f)
+		{
+			int m_pixelY = (int)floorf(m_centreY);
+			if (m_pixelY >= m_top && m_pixelY < m_bottom && m_centreX >= 0.0f && m_centreX < (float)m_width)
+			{
+				_pixels[m_pixelY * _pitch + (int)m_centreX] = m_pixel;
+			}
+			continue;
+		}
+
+		// Fill every pixel whose centre is inside the disc, clipped to this band
+		int m_rowTop = std::max((int)floorf(m_centreY - m_radius[i]), m_top);
+		int m_rowBottom = std::min((int)floorf(m_centreY + m_radius[i]), m_bottom - 1);
+		for (int y = m_rowTop; y <= m_rowBottom; y++)
+		{
+			float m_diffY = (y + 0.5f) - m_centreY;
+			float m_spanSquared = m_radiusSquared - m_diffY * m_diffY;
+			if (m_spanSquared < 0.0f)
+			{
+				continue;
+			}
+
+			// The half width of the disc on this row
+			float m_span = sqrtf(m_spanSquared);
+			int m_left = (int)std::max(ceilf(m_centreX - m_span - 0.5f), 0.0f);
+			int m_right = (int)std::min(floorf(m_centreX + m_span - 0.5f), (float)(m_width - 1));
+			if (m_left <= m_right)
+			{
+				std::fill(_pixels + y * _pitch + m_left, _pixels + y * _pitch + m_right + 1, m_pixel);
+			}
+		}
+	}
+}
+
+/**
+ * Draws every particle into any ARGB framebuffer the size of this rasteriser
+ * @param _particles ParticleStore& The particles to draw
+ * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+ * @param _pixels Uint32* The top left pixel of the framebuffer
+ * @param _pitch int The amount of pixels from the start of one row to the next
+ */
+void Rasteriser::Draw(ParticleStore &_particles, float _alpha, Uint32* _pixels, int _pitch)
+{
+	BinParticles(_particles, _alpha);
+
+	// Bands never share a row, so they can all be drawn at once
+	m_jobs->ParallelFor(0, m_bandCount, 1, [&](int _begin, int _end)
+	{
+		for (int b = _begin; b < _end; b++)
+		{
+			DrawBand(_particles, b, _pixels, _pitch);
+		}
+	});
+}
+
+/**
+ * Draws every particle into the streaming texture and copies it over the whole screen
+ * @param _renderer SDL_Renderer* The renderer the texture belongs to
+ * @param _particles ParticleStore& The particles to draw
+ * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+ */
+void Rasteriser::DrawToTexture(SDL_Renderer* _renderer, ParticleStore &_particles, float _alpha)
+{
+	void* m_pixels = nullptr;
+	int m_pitch = 0;
+	if (SDL_LockTexture(m_texture, nullptr, &m_pixels, &m_pitch) < 0)
+	{
+		std::cerr << "Failed to lock the rasteriser texture. " << SDL_GetError() << "\n";
+		return;
+	}
+
+	// The pitch is in bytes
+	Draw(_particles, _alpha, (Uint32*)m_pixels, m_pitch / (int)sizeof(Uint32));
+	SDL_UnlockTexture(m_texture);
+
+	SDL_RenderCopy(_renderer, m_texture, nullptr, nullptr);
+}
+
+/**
+ * Draws every particle into our own framebuffer, used when running headless
+ * @param _particles ParticleStore& The particles to draw
+ * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+ */
+void Rasteriser::DrawToBuffer(ParticleStore &_particles, float _alpha)
+{
+	m_buffer.resize(m_width * m_height);
+	Draw(_particles, _alpha, m_buffer.data(), m_width);
+}
+
+/**
+ * Writes our own framebuffer to a binary PPM image
+ * @param _outputFile const std::string& The file to write to
+ * @returns bool Returns false if the file couldn't be written
+ */
+bool Rasteriser::WritePPM(const std::string &_outputFile)
+{
+	std::ofstream m_output(_outputFile, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!m_output.is_open() || m_buffer.empty())
+	{
+		std::cerr << "Failed to open output file for the frame dump\n";
+		return false;
+	}
+
+	m_output << "P6\n" << m_width << " " << m_height << "\n255\n";
+
+	// PPM wants plain RGB triples
+	std::vector<Uint8> m_row(m_width * 3);
+	for (int y = 0; y < m_height; y++)
+	{
+		for (int x = 0; x < m_width; x++)
+		{
+			Uint32 m_pixel = m_buffer[y * m_width + x];
+			m_row[x * 3] = (Uint8)(m_pixel >> 16);
+			m_row[x * 3 + 1] = (Uint8)(m_pixel >> 8);
+			m_row[x * 3 + 2] = (Uint8)m_pixel;
+		}
+		m_output.write((const char*)m_row.data(), m_row.size());
+	}
+
+	m_output.close();
+	return true;
+}
@@ -0,0 +1,110 @@
+#ifndef _RASTERISER_H_
+#define _RASTERISER_H_
+/**
+ * Draws particles on the CPU straight into a 32 bit ARGB framebuffer, either a locked streaming texture that is
+ * then copied to the screen in one call, or its own buffer when running headless. The framebuffer is split into
+ * horizontal bands and the particles are counting sorted into the bands they touch, so every band can be filled
+ * by a different thread without any two threads writing to the same pixel. Particles are drawn as filled discs
+ * of their radius.
+ */
+class Rasteriser
+{
+private:
+	// The height in pixels of each band
+	static const int BAND_HEIGHT = 16;
+	// The amount of particles handed to a job at once when working out their screen positions
+	static const int PARTICLES_PER_JOB = 8192;
+	// The background colour, matching the colour the renderer clears to
+	static const Uint32 CLEAR_COLOUR = 0xFF191919;
+
+	// The size of the framebuffer
+	int m_width;
+	int m_height;
+	// The amount of bands the framebuffer is split into
+	int m_bandCount;
+	// The job system the bands are drawn across
+	JobSystem* m_jobs;
+
+	// The streaming texture drawn into when there is a window, nullptr when headless
+	SDL_Texture* m_texture;
+	// Our own framebuffer for headless runs
+	std::vector<Uint32> m_buffer;
+
+	// Each particle's interpolated screen position
+	std::vector<float> m_drawX;
+	std::vector<float> m_drawY;
+	// The first and last band each particle touches, the last is before the first for particles touching none
+	std::vector<int> m_firstBand;
+	std::vector<int> m_lastBand;
+	// Where each band's particles start in m_bandParticles, m_bandCount + 1 entries
+	std::vector<int> m_bandStart;
+	// The particles touching each band, sorted by band. A particle is listed once for every band it touches
+	std::vector<int> m_bandParticles;
+
+	/**
+	 * Works out every particle's screen position and sorts them into the bands they touch
+	 * @param _particles ParticleStore& The particles to draw
+	 * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+	 */
+	void BinParticles(ParticleStore &_particles, float _alpha);
+
+	/**
+	 * Clears one band and fills in every particle touching it
+	 * @param _particles ParticleStore& The particles to draw
+	 * @param _band int The band to draw
+	 * @param _pixels Uint32* The top left pixel of the framebuffer
+	 * @param _pitch int The amount of pixels from the start of one row to the next
+	 */
+	void DrawBand(ParticleStore &_particles, int _band, Uint32* _pixels, int _pitch);
+public:
+	/**
+	 * Constructs a rasteriser for a framebuffer size
+	 * @param _width int The width of the framebuffer in pixels
+	 * @param _height int The height of the framebuffer in pixels
+	 * @param _jobs JobSystem* The job system the bands are drawn across
+	 */
+	Rasteriser(int _width, int _height, JobSystem* _jobs);
+	~Rasteriser();
+
+	/**
+	 * Creates the streaming texture particles are drawn into when there is a window
+	 * @param _renderer SDL_Renderer* The renderer the texture belongs to
+	 * @returns bool Returns false if the texture couldn't be made
+	 */
+	bool CreateTexture(SDL_Renderer* _renderer);
+
+	/**
+	 * Draws every particle into any ARGB framebuffer the size of this rasteriser
+	 * @param _particles ParticleStore& The particles to draw
+	 * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+	 * @param _pixels Uint32* The top left pixel of the framebuffer
+	 * @param _pitch int The amount of pixels from the start of one row to the next
+	 */
+	void Draw(ParticleStore &_particles, float _alpha, Uint32* _pixels, int _pitch);
+
+	/**
+	 * Draws every particle into the streaming texture and copies it over the whole screen
+	 * @param _renderer SDL_Renderer* The renderer the texture belongs to
+	 * @param _particles ParticleStore& The particles to draw
+	 * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+	 */
+	void DrawToTexture(SDL_Renderer* _renderer, ParticleStore &_particles, float _alpha);
+
+	/**
+	 * Draws every particle into our own framebuffer, used when running headless
+	 * @param _particles ParticleStore& The particles to draw
+	 * @param _alpha float How far between the last state (0) and the current state (1) to draw the particles
+	 */
+	void DrawToBuffer(ParticleStore &_particles, float _alpha);
+
+	/**
+	 * Writes our own framebuffer to a binary PPM image
+	 * @param _outputFile const std::string& The file to write to
+	 * @returns bool Returns false if the file couldn't be written
+	 */
+	bool WritePPM(const std::string &_outputFile);
+
+	// Getters
+	Uint32* GetBuffer() { return m_buffer.data(); }
+};
+#endif // !_RASTERISER_H_
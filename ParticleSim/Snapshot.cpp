@@ -0,0 +1,174 @@
+#include "Stdafx.h"
+#include "Snapshot.h"
+
+/**
+ * Gets the start of each particle array in the store, in the order they are saved. Every array is 4 bytes
+ * per particle
+ * @param _particles ParticleStore& The particles to get the arrays of
+ * @param _arrays void** Filled with ARRAY_COUNT pointers
+ */
+void Snapshot::GetArrays(ParticleStore &_particles, void** _arrays)
+{
+	_arrays[0] = _particles.X();
+	_arrays[1] = _particles.Y();
+	_arrays[2] = _particles.LastX();
+	_arrays[3] = _particles.LastY();
+	_arrays[4] = _particles.VelocityX();
+	_arrays[5] = _particles.VelocityY();
+	_arrays[6] = _particles.AccelerationX();
+	_arrays[7] = _particles.AccelerationY();
+	_arrays[8] = _particles.Radius();
+	_arrays[9] = _particles.Colour();
+	_arrays[10] = _particles.Id();
+}
+
+/**
+ * Saves every particle and the simulation state to a file
+ * @param _outputFile const std::string& The file to write to
+ * @param _particles ParticleStore& The particles to save
+ * @param _state const SnapshotState& The simulation state to save
+ * @returns bool Returns false if the file couldn't be written
+ */
+bool Snapshot::Save(const std::string &_outputFile, ParticleStore &_particles, const SnapshotState &_state)
+{
+	Header m_header;
+	memset(&m_header, 0, sizeof(m_header));
+	memcpy(m_header.m_magic, "PSIMSNAP", 8);
+	m_header.m_version = VERSION;
+	m_header.m_headerSize = sizeof(Header);
+	m_header.m_particleCount = (Uint32)_particles.Size();
+	m_header.m_rngStateSize = (Uint32)_state.m_rngState.size();
+	m_header.m_simulationTime = _state.m_simulationTime;
+	m_header.m_fixedTimestep = _state.m_fixedTimestep;
+	m_header.m_subSteps = _state.m_subSteps;
+	m_header.m_screenWidth = _state.m_screenWidth;
+	m_header.m_screenHeight = _state.m_screenHeight;
+	m_header.m_cellSize = _state.m_cellSize;
+	m_header.m_broadPhase = _state.m_broadPhase;
+	m_header.m_stepsSinceReorder = _state.m_stepsSinceReorder;
+	m_header.m_sortedLocality = _state.m_sortedLocality;
+	m_header.m_locality = _state.m_locality;
+
+	// Lay the arrays out after the header and the random engine state
+	size_t m_arrayBytes = (size_t)m_header.m_particleCount * 4;
+	size_t m_offset = sizeof(Header) + m_header.m_rngStateSize;
+	for (int a = 0; a < ARRAY_COUNT; a++)
+	{
+		m_offset = (m_offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+		m_header.m_arrayOffset[a] = m_offset;
+		m_offset += m_arrayBytes;
+	}
+	m_header.m_fileSize = m_offset;
+
+	// Build the whole file in memory so it goes out in one write
+	std::vector<char> m_buffer(m_offset, 0);
+	memcpy(m_buffer.data(), &m_header, sizeof(Header));
+	memcpy(m_buffer.data() + sizeof(Header), _state.m_rngState.data(), m_header.m_rngStateSize);
+	void* m_arrays[ARRAY_COUNT];
+	GetArrays(_particles, m_arrays);
+	for (int a = 0; a < ARRAY_COUNT; a++)
+	{
+		if (m_arrayBytes > 0)
+		{
+			memcpy(m_buffer.data() + m_header.m_arrayOffset[a], m_arrays[a], m_arrayBytes);
+		}
+	}
+
+	std::ofstream m_output(_outputFile, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!m_output.is_open())
+	{
+		std::cerr << "Failed to open " << _outputFile << " to save a snapshot\n";
+		return false;
+	}
+	m_output.write(m_buffer.data(), m_buffer.size());
+	m_output.close();
+	if (m_output.fail())
+	{
+		std::cerr << "Failed to write the snapshot to " << _outputFile << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Replaces every particle and the simulation state with the contents of a file
+ * @param _inputFile const std::string& The file to read from
+ * @param _particles ParticleStore& The store to load the particles into
+ * @param _state SnapshotState& Filled with the saved simulation state
+ * @returns bool Returns false if the file couldn't be read or isn't a snapshot of this version, the store
+ *               is left untouched
+ */
+bool Snapshot::Load(const std::string &_inputFile, ParticleStore &_particles, SnapshotState &_state)
+{
+	MappedFile m_file;
+	if (!m_file.Open(_inputFile))
+	{
+		return false;
+	}
+
+	// Check it is a snapshot we can read before trusting anything in it
+	Header m_header;
+	if (m_file.GetSize() < sizeof(Header))
+	{
+		std::cerr << _inputFile << " is too small to be a snapshot\n";
+		return false;
+	}
+	memcpy(&m_header, m_file.GetData(), sizeof(Header));
+	if (memcmp(m_header.m_magic, "PSIMSNAP", 8) != 0)
+	{
+		std::cerr << _inputFile << " is not a snapshot\n";
+		return false;
+	}
+	if (m_header.m_version != VERSION || m_header.m_headerSize != sizeof(Header))
+	{
+		std::cerr << _inputFile << " is a version " << m_header.m_version << " snapshot, only version " << VERSION << " can be loaded\n";
+		return false;
+	}
+	size_t m_arrayBytes = (size_t)m_header.m_particleCount * 4;
+	bool m_valid = (m_header.m_fileSize == m_file.GetSize() && sizeof(Header) + m_header.m_rngStateSize <= m_file.GetSize());
+	for (int a = 0; a < ARRAY_COUNT && m_valid; a++)
+	{
+		m_valid = (m_header.m_arrayOffset[a] + m_arrayBytes <= m_file.GetSize());
+	}
+	if (!m_valid)
+	{
+		std::cerr << _inputFile << " is truncated or corrupt\n";
+		return false;
+	}
+
+	// Check the ids before touching the store, so a bad file leaves it as it was
+	const int* m_ids = (const int*)(m_file.GetData() + m_header.m_arrayOffset[ARRAY_COUNT - 1]);
+	if (!ParticleStore::ValidateIds(m_ids, (int)m_header.m_particleCount))
+	{
+		std::cerr << _inputFile << " has invalid particle ids\n";
+		return false;
+	}
+
+	_state.m_simulationTime = m_header.m_simulationTime;
+	_state.m_fixedTimestep = m_header.m_fixedTimestep;
+	_state.m_subSteps = m_header.m_subSteps;
+	_state.m_screenWidth = m_header.m_screenWidth;
+	_state.m_screenHeight = m_header.m_screenHeight;
+	_state.m_cellSize = m_header.m_cellSize;
+	_state.m_broadPhase = m_header.m_broadPhase;
+	_state.m_stepsSinceReorder = m_header.m_stepsSinceReorder;
+	_state.m_sortedLocality = m_header.m_sortedLocality;
+	_state.m_locality = m_header.m_locality;
+	_state.m_rngState.assign((const char*)m_file.GetData() + sizeof(Header), m_header.m_rngStateSize);
+
+	// Copy each array straight out of the mapping
+	_particles.Resize((int)m_header.m_particleCount);
+	void* m_arrays[ARRAY_COUNT];
+	GetArrays(_particles, m_arrays);
+	for (int a = 0; a < ARRAY_COUNT; a++)
+	{
+		if (m_arrayBytes > 0)
+		{
+			memcpy(m_arrays[a], m_file.GetData() + m_header.m_arrayOffset[a], m_arrayBytes);
+		}
+	}
+	_particles.RebuildIds();
+
+	return true;
+}
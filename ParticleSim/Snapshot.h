@@ -0,0 +1,83 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+// The simulation state saved alongside the particles
+struct SnapshotState
+{
+	double m_simulationTime; // The total simulated time in seconds
+	float m_fixedTimestep; // The fixed timestep the simulation advances by
+	int m_subSteps; // The amount of sub-steps each fixed step is split into
+	int m_screenWidth, m_screenHeight; // The screen bounds the particles bounce around in
+	int m_cellSize; // The cell size of the broad phase
+	int m_broadPhase; // The broad phase in use, a BroadPhaseType
+	int m_stepsSinceReorder; // The steps since the particles were last sorted into Morton order
+	float m_sortedLocality; // The locality measured just after the last reorder, -1 until measured
+	float m_locality; // The locality measured after the last step
+	std::string m_rngState; // The particle spawning random engine, as written by its stream operator
+};
+
+/**
+ * Saves and restores the whole simulation state as a versioned binary file. The file is a fixed header, the
+ * random engine state and then each particle array in turn, every array starting on a 64 byte boundary. The
+ * file is built in memory and written with one sequential write, and loaded by mapping it and copying each
+ * array straight into the particle store, so loading costs little more than the page faults.
+ */
+class Snapshot
+{
+private:
+	// Bumped whenever the layout changes, older files are refused rather than misread
+	static const Uint32 VERSION = 2;
+	// Every array starts on a multiple of this
+	static const int ALIGNMENT = 64;
+	// The amount of particle arrays stored: x, y, last x, last y, vx, vy, ax, ay, radius, colour and id
+	static const int ARRAY_COUNT = 11;
+
+	// The start of every snapshot file
+	struct Header
+	{
+		char m_magic[8]; // "PSIMSNAP"
+		Uint32 m_version; // VERSION when written
+		Uint32 m_headerSize; // sizeof(Header) when written, catches builds that pack it differently
+		Uint64 m_fileSize; // The size of the whole file in bytes
+		Uint32 m_particleCount; // The amount of particles stored
+		Uint32 m_rngStateSize; // The length of the random engine state that follows the header
+		double m_simulationTime;
+		float m_fixedTimestep;
+		Sint32 m_subSteps;
+		Sint32 m_screenWidth, m_screenHeight;
+		Sint32 m_cellSize;
+		Sint32 m_broadPhase;
+		Sint32 m_stepsSinceReorder;
+		float m_sortedLocality;
+		float m_locality;
+		Uint64 m_arrayOffset[ARRAY_COUNT]; // Where each particle array starts in the file
+	};
+
+	/**
+	 * Gets the start of each particle array in the store, in the order they are saved. Every array is 4 bytes
+	 * per particle
+	 * @param _particles ParticleStore& The particles to get the arrays of
+	 * @param _arrays void** Filled with ARRAY_COUNT pointers
+	 */
+	static void GetArrays(ParticleStore &_particles, void** _arrays);
+public:
+	/**
+	 * Saves every particle and the simulation state to a file
+	 * @param _outputFile const std::string& The file to write to
+	 * @param _particles ParticleStore& The particles to save
+	 * @param _state const SnapshotState& The simulation state to save
+	 * @returns bool Returns false if the file couldn't be written
+	 */
+	static bool Save(const std::string &_outputFile, ParticleStore &_particles, const SnapshotState &_state);
+
+	/**
+	 * Replaces every particle and the simulation state with the contents of a file
+	 * @param _inputFile const std::string& The file to read from
+	 * @param _particles ParticleStore& The store to load the particles into
+	 * @param _state SnapshotState& Filled with the saved simulation state
+	 * @returns bool Returns false if the file couldn't be read or isn't a snapshot of this version, the store
+	 *               is left untouched
+	 */
+	static bool Load(const std::string &_inputFile, ParticleStore &_particles, SnapshotState &_state);
+};
+#endif // !_SNAPSHOT_H_
@@ -0,0 +1,237 @@
+#include "Stdafx.h"
+#include "SparseHashGrid.h"
+
+SparseHashGrid::SparseHashGrid(int _cellSize)
+{
+	m_cellSize = _cellSize;
+
+	// Start with an empty table, it grows with the occupied cells
+	Slot m_empty = { 0, 0, -1 };
+	m_table.assign(MIN_CAPACITY, m_empty);
+	m_mask = MIN_CAPACITY - 1;
+
+	m_cellStart.assign(1, 0);
+	memset(m_colourStart, 0, sizeof(m_colourStart));
+
+	m_maxRadius = 0.0f;
+	m_skipped = 0;
+}
+
+SparseHashGrid::~SparseHashGrid()
+{
+}
+
+/**
+ * Empties every occupied cell ready for the next rebuild, shrinking the hash table if it is mostly empty
+ */
+void SparseHashGrid::Clear()
+{
+	// Give memory back once the particles have gathered into far fewer cells than the table was sized for
+	int m_capacity = (int)m_table.size();
+	if (m_capacity > MIN_CAPACITY && (int)m_cellX.size() * 8 < m_capacity)
+	{
+		Slot m_empty = { 0, 0, -1 };
+		m_capacity = std::max(m_capacity / 4, MIN_CAPACITY);
+		m_table.assign(m_capacity, m_empty);
+		m_table.shrink_to_fit();
+		m_mask = m_capacity - 1;
+	}
+	else
+	{
+		// Only the slots that were used need emptying
+		for (unsigned int c = 0; c < m_cellSlot.size(); c++)
+		{
+			m_table[m_cellSlot[c]].m_cell = -1;
+		}
+	}
+
+	m_cellX.clear();
+	m_cellY.clear();
+	m_cellSlot.clear();
+	m_cellStart.assign(1, 0);
+	m_maxRadius = 0.0f;
+	m_skipped = 0;
+}
+
+/**
+ * Finds the occupied cell at a cell coordinate, adding it if it is new
+ * @param _x int The cell column
+ * @param _y int The cell row
+ * @returns int The number of the occupied cell
+ */
+int SparseHashGrid::Insert(int _x, int _y)
+{
+	// Linear probe until we find the cell or an empty slot to put it in
+	int m_slot = HashSlot(_x, _y);
+	while (m_table[m_slot].m_cell >= 0)
+	{
+		if (m_table[m_slot].m_x == _x && m_table[m_slot].m_y == _y)
+		{
+			return m_table[m_slot].m_cell;
+		}
+		m_slot = (m_slot + 1) & m_mask;
+	}
+
+	int m_cell = (int)m_cellX.size();
+	m_table[m_slot].m_x = _x;
+	m_table[m_slot].m_y = _y;
+	m_table[m_slot].m_cell = m_cell;
+	m_cellX.push_back(_x);
+	m_cellY.push_back(_y);
+	m_cellSlot.push_back(m_slot);
+	m_cellStart.push_back(0);
+
+	// Keep the table at most half full so probes stay short
+	if ((int)m_cellX.size() * 2 > (int)m_table.size())
+	{
+		Rehash((int)m_table.size() * 2);
+	}
+
+	return m_cell;
+}
+
+/**
+ * Resizes the hash table and puts every occupied cell back into it
+ * @param _capacity int The new capacity, a power of two
+ */
+void SparseHashGrid::Rehash(int _capacity)
+{
+	Slot m_empty = { 0, 0, -1 };
+	m_table.assign(_capacity, m_empty);
+	m_mask = _capacity - 1;
+
+	for (unsigned int c = 0; c < m_cellX.size(); c++)
+	{
+		int m_slot = HashSlot(m_cellX[c], m_cellY[c]);
+		while (m_table[m_slot].m_cell >= 0)
+		{
+			m_slot = (m_slot + 1) & m_mask;
+		}
+		m_table[m_slot].m_x = m_cellX[c];
+		m_table[m_slot].m_y = m_cellY[c];
+		m_table[m_slot].m_cell = (int)c;
+		m_cellSlot[c] = m_slot;
+	}
+}
+
+/**
+ * Rebuilds the grid from the current particle positions using a counting sort. The grid must have been
+ * cleared first. Allocation free once the arrays have grown to the particle count
+ * @param _particles ParticleStore& The particles to bin into the grid
+ */
+void SparseHashGrid::Rebuild(ParticleStore &_particles)
+{
+	int m_count = _particles.Size();
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_radius = _particles.Radius();
+
+	// resize only reallocates when the particle count grows past what we have seen before
+	m_particleCell.resize(m_count);
+	m_sortedIndices.resize(m_count);
+
+	// Pass 1: find or add the cell of each particle and count the particles in it
+	for (int i = 0; i < m_count; i++)
+	{
+		// A position that isn't a number has no cell, leave it out rather than guess one
+		if (!std::isfinite(m_x[i]) || !std::isfinite(m_y[i]))
+		{
+			m_particleCell[i] = -1;
+			m_skipped++;
+			continue;
+		}
+
+		int m_cell = Insert(CellCoord(m_x[i]), CellCoord(m_y[i]));
+		m_particleCell[i] = m_cell;
+		m_cellStart[m_cell + 1]++;
+
+		if (m_radius[i] > m_maxRadius && std::isfinite(m_radius[i]))
+		{
+			m_maxRadius = m_radius[i];
+		}
+	}
+
+	// Prefix sum the counts so each cell knows where its run starts
+	int m_cells = (int)m_cellX.size();
+	m_cellCursor.resize(m_cells);
+	for (int c = 0; c < m_cells; c++)
+	{
+		m_cellStart[c + 1] += m_cellStart[c];
+		m_cellCursor[c] = m_cellStart[c];
+	}
+
+	// Pass 2: scatter the particle indices into their cells. Walking the particles in order keeps each cell
+	// sorted by index, so the result is deterministic
+	for (int i = 0; i < m_count; i++)
+	{
+		if (m_particleCell[i] >= 0)
+		{
+			m_sortedIndices[m_cellCursor[m_particleCell[i]]++] = i;
+		}
+	}
+	m_sortedIndices.resize(m_cellStart[m_cells]);
+
+	// List the cells by colour, the same counting sort again over the 3x2 checkerboard
+	memset(m_colourStart, 0, sizeof(m_colourStart));
+	m_colourCells.resize(m_cells);
+	for (int c = 0; c < m_cells; c++)
+	{
+		int m_colour = ((m_cellX[c] % COLOUR_COLUMNS) + COLOUR_COLUMNS) % COLOUR_COLUMNS + (((m_cellY[c] % COLOUR_ROWS) + COLOUR_ROWS) % COLOUR_ROWS) * COLOUR_COLUMNS;
+		m_colourStart[m_colour + 1]++;
+	}
+	for (int k = 0; k < COLOUR_COLUMNS * COLOUR_ROWS; k++)
+	{
+		m_colourStart[k + 1] += m_colourStart[k];
+	}
+	int m_colourCursor[COLOUR_COLUMNS * COLOUR_ROWS];
+	memcpy(m_colourCursor, m_colourStart, sizeof(m_colourCursor));
+	for (int c = 0; c < m_cells; c++)
+	{
+		int m_colour = ((m_cellX[c] % COLOUR_COLUMNS) + COLOUR_COLUMNS) % COLOUR_COLUMNS + (((m_cellY[c] % COLOUR_ROWS) + COLOUR_ROWS) % COLOUR_ROWS) * COLOUR_COLUMNS;
+		m_colourCells[m_colourCursor[m_colour]++] = c;
+	}
+}
+
+/**
+ * Measures how full the occupied cells and the hash table are. Only meaningful after the grid has been built
+ * this frame
+ * @returns GridStats The occupancy of the cells, with the hash table capacity as the cell count
+ */
+GridStats SparseHashGrid::GetStats()
+{
+	int m_cells = (int)m_cellX.size();
+	GridStats m_stats = { m_cellSize, (int)m_table.size(), m_cells, 0, 0.0f };
+	for (int c = 0; c < m_cells; c++)
+	{
+		m_stats.m_maxOccupancy = std::max(m_stats.m_maxOccupancy, m_cellStart[c + 1] - m_cellStart[c]);
+	}
+	m_stats.m_meanOccupancy = (m_cells > 0 ? (float)m_cellStart[m_cells] / m_cells : 0.0f);
+
+	return m_stats;
+}
+
+/**
+ * Draws the boundaries of the occupied cells on the screen for debugging purposes
+ * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+ * @param _screenWidth int The width of the screen
+ * @param _screenHeight int The height of the screen
+ */
+void SparseHashGrid::DrawCellLines(SDL_Renderer* _renderer, int _screenWidth, int _screenHeight)
+{
+	// There are no lines between empty cells, so outline the occupied ones that can be seen
+	std::vector<SDL_Rect> m_rects;
+	for (unsigned int c = 0; c < m_cellX.size(); c++)
+	{
+		// Far off cells would overflow an int in pixels, so check them in cell coordinates first
+		long long m_left = (long long)m_cellX[c] * m_cellSize;
+		long long m_top = (long long)m_cellY[c] * m_cellSize;
+		if (m_left + m_cellSize >= 0 && m_left < _screenWidth && m_top + m_cellSize >= 0 && m_top < _screenHeight)
+		{
+			SDL_Rect m_rect = { (int)m_left, (int)m_top, m_cellSize, m_cellSize };
+			m_rects.push_back(m_rect);
+		}
+	}
+
+	SDL_SetRenderDrawColor(_renderer, 43, 206, 239, 255);
+	SDL_RenderDrawRects(_renderer, m_rects.data(), (int)m_rects.size());
+}
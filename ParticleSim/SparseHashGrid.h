@@ -0,0 +1,186 @@
+#ifndef _SPARSEHASHGRID_H_
+#define _SPARSEHASHGRID_H_
+/**
+ * Broad phase for worlds of any size. Cells are keyed on their integer cell coordinates in an open addressing hash
+ * table rather than laid out as a dense columns * rows array, so only cells holding a particle take up memory and a
+ * particle far off the screen is binned like any other. The particles are counting sorted by cell like the
+ * CellGrid, so each occupied cell is one contiguous run of the sorted index array.
+ *
+ * Occupied cells are numbered in the order they are first seen, and also listed by their colour in the same 3x2
+ * checkerboard the CollisionSolver uses on the dense grid, so the solver can colour them without walking empty space.
+ */
+class ParticleStore;
+class SparseHashGrid
+{
+private:
+	// The smallest the hash table gets, a power of two
+	static const int MIN_CAPACITY = 1024;
+	// Large primes mixing the cell coordinates into a hash
+	static const unsigned int PRIME_X = 73856093;
+	static const unsigned int PRIME_Y = 19349663;
+	// Cell coordinates are clamped to this so positions too far out to fit an int still land in a cell
+	static const int MAX_CELL_COORD = 1 << 29;
+	// The amount of colours along each axis of the checkerboard
+	static const int COLOUR_COLUMNS = 3;
+	static const int COLOUR_ROWS = 2;
+
+	// A slot in the hash table
+	struct Slot
+	{
+		int m_x, m_y; // The cell coordinates
+		int m_cell; // The number of the occupied cell, -1 while the slot is empty
+	};
+
+	// The cell size passed through in the constructor
+	int m_cellSize;
+
+	// The hash table, its capacity is always a power of two and kept at least twice the occupied cells
+	std::vector<Slot> m_table;
+	int m_mask;
+
+	// The coordinates and hash table slot of each occupied cell, in the order they were first seen
+	std::vector<int> m_cellX, m_cellY;
+	std::vector<int> m_cellSlot;
+	// Start offset of each occupied cell into the sorted index array, with an extra entry so the last cell has an end
+	std::vector<int> m_cellStart;
+	// Write cursor for each occupied cell used while scattering
+	std::vector<int> m_cellCursor;
+	// The occupied cell each particle was binned into during the last rebuild, -1 if it had no position
+	std::vector<int> m_particleCell;
+	// Particle indices sorted by cell
+	std::vector<int> m_sortedIndices;
+	// The occupied cells of each colour and where each colour starts in that list
+	std::vector<int> m_colourCells;
+	int m_colourStart[COLOUR_COLUMNS * COLOUR_ROWS + 1];
+
+	// The largest particle radius seen during the last rebuild
+	float m_maxRadius;
+	// The amount of particles left out of the last rebuild because their position wasn't a number
+	int m_skipped;
+
+	/**
+	 * Finds the occupied cell at a cell coordinate, adding it if it is new
+	 * @param _x int The cell column
+	 * @param _y int The cell row
+	 * @returns int The number of the occupied cell
+	 */
+	int Insert(int _x, int _y);
+
+	/**
+	 * Resizes the hash table and puts every occupied cell back into it
+	 * @param _capacity int The new capacity, a power of two
+	 */
+	void Rehash(int _capacity);
+
+	/**
+	 * Hashes a cell coordinate into a hash table slot
+	 * @param _x int The cell column
+	 * @param _y int The cell row
+	 * @returns int The first slot to probe
+	 */
+	int HashSlot(int _x, int _y) { return (int)(((unsigned int)_x * PRIME_X ^ (unsigned int)_y * PRIME_Y) & (unsigned int)m_mask); }
+public:
+	// Constructor for the sparse hash grid
+	SparseHashGrid(int _cellSize);
+	~SparseHashGrid();
+
+	/**
+	 * Empties every occupied cell ready for the next rebuild, shrinking the hash table if it is mostly empty
+	 */
+	void Clear();
+
+	/**
+	 * Rebuilds the grid from the current particle positions using a counting sort. The grid must have been
+	 * cleared first. Allocation free once the arrays have grown to the particle count
+	 * @param _particles ParticleStore& The particles to bin into the grid
+	 */
+	void Rebuild(ParticleStore &_particles);
+
+	/**
+	 * Finds the occupied cell at a cell coordinate
+	 * @param _x int The cell column
+	 * @param _y int The cell row
+	 * @returns int The number of the occupied cell, -1 if no particle is in it
+	 */
+	int Find(int _x, int _y)
+	{
+		for (int m_slot = HashSlot(_x, _y); m_table[m_slot].m_cell >= 0; m_slot = (m_slot + 1) & m_mask)
+		{
+			if (m_table[m_slot].m_x == _x && m_table[m_slot].m_y == _y)
+			{
+				return m_table[m_slot].m_cell;
+			}
+		}
+		return -1;
+	}
+
+	/**
+	 * Calls a function for every particle index in the cells the given bounds can touch. Only occupied cells are
+	 * in the table, so empty cells cost a single probe and the walk never allocates
+	 * @param _position glm::vec2 The position to use as the search case
+	 * @param _radius float The radius to use as the search case
+	 * @param _function Function Called as _function(int _index) for each particle found
+	 */
+	template <typename Function>
+	void ForEachNeighbour(glm::vec2 _position, float _radius, Function _function)
+	{
+		// A particle without a position was never binned and can't touch anything
+		if (!std::isfinite(_position.x) || !std::isfinite(_position.y))
+		{
+			return;
+		}
+
+		// Particles are binned by their centre, so widen the search by the largest radius
+		float m_reach = _radius + m_maxRadius;
+		int m_columnMin = CellCoord(_position.x - m_reach);
+		int m_columnMax = CellCoord(_position.x + m_reach);
+		int m_rowMin = CellCoord(_position.y - m_reach);
+		int m_rowMax = CellCoord(_position.y + m_reach);
+
+		for (int m_row = m_rowMin; m_row <= m_rowMax; m_row++)
+		{
+			for (int m_column = m_columnMin; m_column <= m_columnMax; m_column++)
+			{
+				int m_cell = Find(m_column, m_row);
+				if (m_cell < 0)
+				{
+					continue;
+				}
+				for (int k = m_cellStart[m_cell]; k < m_cellStart[m_cell + 1]; k++)
+				{
+					_function(m_sortedIndices[k]);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Measures how full the occupied cells and the hash table are. Only meaningful after the grid has been built
+	 * this frame
+	 * @returns GridStats The occupancy of the cells, with the hash table capacity as the cell count
+	 */
+	GridStats GetStats();
+
+	/**
+	 * Draws the boundaries of the occupied cells on the screen for debugging purposes
+	 * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+	 * @param _screenWidth int The width of the screen
+	 * @param _screenHeight int The height of the screen
+	 */
+	void DrawCellLines(SDL_Renderer* _renderer, int _screenWidth, int _screenHeight);
+
+	/** Getters **/
+	int GetCellSize() { return m_cellSize; }
+	float GetMaxRadius() { return m_maxRadius; }
+	int GetOccupiedCells() { return (int)m_cellX.size(); }
+	int GetCapacity() { return (int)m_table.size(); }
+	int GetSkipped() { return m_skipped; }
+	int GetCellX(int _cell) { return m_cellX[_cell]; }
+	int GetCellY(int _cell) { return m_cellY[_cell]; }
+	int* GetCellStart() { return m_cellStart.data(); }
+	int* GetSortedIndices() { return m_sortedIndices.data(); }
+	int GetColourStart(int _colour) { return m_colourStart[_colour]; }
+	int* GetColourCells() { return m_colourCells.data(); }
+	int CellCoord(float _position) { float m_coord = floorf(_position / m_cellSize); return (int)std::min(std::max(m_coord, (float)-MAX_CELL_COORD), (float)MAX_CELL_COORD); }
+};
+#endif // !_SPARSEHASHGRID_H_
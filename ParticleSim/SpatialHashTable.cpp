@@ -8,19 +8,21 @@ SpatialHashTable::SpatialHashTable(int _screenWidth, int _screenHeight, int _cel
 	m_screenHeight = _screenHeight;
 	m_cellSize = _cellSize;
 
-	m_tableColumns = _screenWidth / _cellSize;
-	m_tableRows = _screenHeight / _cellSize;
+	// Round up so the cells always cover the whole screen, whatever the cell size
+	m_tableColumns = (_screenWidth + _cellSize - 1) / _cellSize;
+	m_tableRows = (_screenHeight + _cellSize - 1) / _cellSize;
 
 	m_tableSize = m_tableColumns * m_tableRows;
 
 	// Create our hashtable and run our Clear function to make sure its initialised
-	m_hashTable = new std::vector<Particle*>[m_tableSize];
+	m_hashTable = new std::vector<int>[m_tableSize];
 	
 	Clear();
 }
 
 SpatialHashTable::~SpatialHashTable()
 {
+	delete[] m_hashTable;
 }
 
 /**
@@ -37,72 +39,87 @@ void SpatialHashTable::Clear()
 
 /**
  * Adds a particle to the spatial hash table
- * @param _particle Particle* The particle to add to the hash table
+ * @param _index int The index of the particle in the particle store
+ * @param _position glm::vec2 The position of the particle
+ * @param _radius float The radius of the particle
  */
-void SpatialHashTable::AddParticle(Particle* _particle)
+void SpatialHashTable::AddParticle(int _index, glm::vec2 _position, float _radius)
 {
-	// Get the list of cell indicies that this particle falls into
-	std::list<int> m_cellIndices = GetCellIndices(_particle);
-	// Store an iterator of a list of ints
-	std::list<int>::iterator m_iter;
+	// Get the cell indicies that this particle falls into
+	int m_cellIndices[4];
+	int m_cellCount = GetCellIndices(_position, _radius, m_cellIndices);
 
-	// Iterate over the list adding the particle to each cell (bucket) that it is part of
-	for (m_iter = m_cellIndices.begin(); m_iter != m_cellIndices.end(); ++m_iter)
+	// Add the particle to each cell (bucket) that it is part of
+	for (int i = 0; i < m_cellCount; i++)
 	{
-		if (*m_iter >= 0 && *m_iter < m_tableSize)
-		{
-			m_hashTable[*m_iter].push_back(_particle);
-		}
+		m_hashTable[m_cellIndices[i]].push_back(_index);
 	}
 }
 
 /**
-* Returns a list of cell indices from the provided particle
-* @param _particle Particle* The particle to get the cell indices for
-* @returns list<int> A list of cell indices that this particle is in
+* Finds the cell indices that the provided particle bounds fall into without allocating
+* @param _position glm::vec2 The position of the particle
+* @param _radius float The radius of the particle
+* @param _cellIndices int[4] Filled with the unique, in range cell indices of the bounds
+* @returns int The number of cell indices written (between 0 and 4)
 */
-std::list<int> SpatialHashTable::GetCellIndices(Particle* _particle)
+int SpatialHashTable::GetCellIndices(glm::vec2 _position, float _radius, int _cellIndices[4])
 {
-	// Stores the cell indicies for the given particle (should range between 1 cell index to 4 indices depending
-	// on where the particle is
-	std::list<int> m_cellIndices;
+	// The number of cell indices found, should range between 1 cell index to 4 indices depending on where the particle is
+	int m_cellCount = 0;
 
 	// Get the bounding box of the particle
-	glm::vec2 m_boundMin = glm::vec2(_particle->Position().x - _particle->Radius(),
-		_particle->Position().y - _particle->Radius());
-	glm::vec2 m_boundMax = glm::vec2(_particle->Position().x + _particle->Radius(),
-		_particle->Position().y + _particle->Radius());
-
-	// Storage for the cell index
-	int m_currentCellIndex = -1;
+	glm::vec2 m_boundMin = glm::vec2(_position.x - _radius, _position.y - _radius);
+	glm::vec2 m_boundMax = glm::vec2(_position.x + _radius, _position.y + _radius);
 
 	// Now check the 4 corners of the bounding box to see what cell its in
-	// Top left
-	m_cellIndices.push_back(Hash(m_boundMin));
-	// Top right
-	m_cellIndices.push_back(Hash(glm::vec2(m_boundMax.x, m_boundMin.y)));
-	// Bottom left
-	m_cellIndices.push_back(Hash(glm::vec2(m_boundMin.x, m_boundMax.y)));
-	// Bottom Right
-	m_cellIndices.push_back(Hash(m_boundMax));
-
-	// Check that we do not have duplicate entries by running the unique function
-	m_cellIndices.unique();
-
-	// Return the indices
-	return m_cellIndices;
+	int m_corners[4] =
+	{
+		Hash(m_boundMin), // Top left
+		Hash(glm::vec2(m_boundMax.x, m_boundMin.y)), // Top right
+		Hash(glm::vec2(m_boundMin.x, m_boundMax.y)), // Bottom left
+		Hash(m_boundMax) // Bottom Right
+	};
+
+	for (int i = 0; i < 4; i++)
+	{
+		// Skip any corners that fall outside of the table
+		if (m_corners[i] < 0)
+		{
+			continue;
+		}
+
+		// Check that we do not have a duplicate entry, corners that share a cell can be anywhere in the list
+		bool m_duplicate = false;
+		for (int j = 0; j < m_cellCount; j++)
+		{
+			if (_cellIndices[j] == m_corners[i])
+			{
+				m_duplicate = true;
+				break;
+			}
+		}
+
+		if (!m_duplicate)
+		{
+			_cellIndices[m_cellCount++] = m_corners[i];
+		}
+	}
+
+	// Return the amount of indices
+	return m_cellCount;
 }
 
 /**
  * Generates a hash (or cell position) for a coordinate position
- * Hashes based on (floor(x / cell_size)) + (floor(y / cell_size)) * (screen_width / cell_size)
+ * Hashes based on (floor(x / cell_size)) + (floor(y / cell_size)) * table_columns
  * @param _position glm::vec2 The position of the particle on the screen eg:(235, 732)
  * @returns int Returns the hash (cell position) of this screen position. Also returns -1 if the hash is out of range of the table size
  */
 int SpatialHashTable::Hash(glm::vec2 _position)
 {
 	// Should return a number which is between 0 and (table_columns * table_rows) - 1
-	int m_hash = (int)((floor(_position.x / m_cellSize)) + (floor(_position.y / m_cellSize)) * (m_screenWidth / m_cellSize));
+	int m_hash = (int)((floor(_position.x / m_cellSize)) + (floor(_position.y / m_cellSize)) * m_tableColumns);
 
 	// force any outliers to just be in cell 1 for now (this isnt efficient but need to think of a better way around it)
 	if (m_hash > (m_tableSize - 1) || m_hash < 0)
@@ -114,34 +131,26 @@ int SpatialHashTable::Hash(glm::vec2 _position)
 }
 
 /**
- * Returns a vector of particles which are close to the given particle
- * @param _particle Particle* The particle to use as the search case
- * @returns vector<Particle*> A vector of particles near the given particle
+ * Measures how full the buckets are. A particle spanning several cells counts once in each of them
+ * @returns GridStats The occupancy of the buckets
  */
-std::vector<Particle*> SpatialHashTable::GetLocalObjects(Particle* _particle)
+GridStats SpatialHashTable::GetStats()
 {
-	// Get the list of cell indicies that this particle falls into
-	std::list<int> m_cellIndices = GetCellIndices(_particle);
-	// Store an iterator of a list of ints
-	std::list<int>::iterator m_iter;
-
-	// The return vector of particles
-	std::vector<Particle*> m_return;
-
-	// Iterate over the list finding any objects that are also in the given buckets and adding them to the return
-	// vector
-	for (m_iter = m_cellIndices.begin(); m_iter != m_cellIndices.end(); ++m_iter)
+	GridStats m_stats = { m_cellSize, m_tableSize, 0, 0, 0.0f };
+	int m_entries = 0;
+	for (int i = 0; i < m_tableSize; i++)
 	{
-		// Insert the buckets found onto the end of the return vector
-		if (*m_iter >= 0 && *m_iter < m_tableSize)
+		int m_occupancy = (int)m_hashTable[i].size();
+		if (m_occupancy > 0)
 		{
-			m_return.insert(m_return.end(), m_hashTable[*m_iter].begin(),
-				m_hashTable[*m_iter].end());
+			m_stats.m_occupiedCells++;
+			m_stats.m_maxOccupancy = std::max(m_stats.m_maxOccupancy, m_occupancy);
+			m_entries += m_occupancy;
 		}
 	}
+	m_stats.m_meanOccupancy = (m_stats.m_occupiedCells > 0 ? (float)m_entries / m_stats.m_occupiedCells : 0.0f);
 
-	// return the vector
-	return m_return;
+	return m_stats;
 }
 
 /**
@@ -11,8 +11,8 @@ private:
 	int m_tableColumns, m_tableRows;
 	int m_tableSize;
 
-	// Holds a pointer array of vectors for our buckets (hash map)
-	std::vector<Particle*>* m_hashTable;
+	// Holds a pointer array of vectors for our buckets (hash map). Each bucket stores particle indices into the ParticleStore
+	std::vector<int>* m_hashTable;
 public:
 	// Constructor for the spatial hash table
 	SpatialHashTable(int _screenWidth, int _screenHeight, int _cellSize);
@@ -25,16 +25,20 @@ public:
 
 	/**
 	 * Adds a particle to the spatial hash table
-	 * @param _particle Particle* The particle to add to the hash table
+	 * @param _index int The index of the particle in the particle store
+	 * @param _position glm::vec2 The position of the particle
+	 * @param _radius float The radius of the particle
 	 */
-	void AddParticle(Particle* _particle);
+	void AddParticle(int _index, glm::vec2 _position, float _radius);
 
 	/** 
-	 * Returns a list of cell indices from the provided particle
-	 * @param _particle Particle* The particle to get the cell indices for
-	 * @returns list<int> A list of cell indices that this particle is in
+	 * Finds the cell indices that the provided particle bounds fall into without allocating
+	 * @param _position glm::vec2 The position of the particle
+	 * @param _radius float The radius of the particle
+	 * @param _cellIndices int[4] Filled with the unique, in range cell indices of the bounds
+	 * @returns int The number of cell indices written (between 0 and 4)
 	 */
-	std::list<int> GetCellIndices(Particle* _particle);
+	int GetCellIndices(glm::vec2 _position, float _radius, int _cellIndices[4]);
 
 	/**
 	 * Generates a hash (or cell position) for a coordinate position
@@ -44,11 +48,33 @@ public:
 	int Hash(glm::vec2 _position);
 
 	/**
-	 * Returns a vector of particles which are close to the given particle
-	 * @param _particle Particle* The particle to use as the search case
-	 * @returns vector<Particle*> A vector of particles near the given particle
+	 * Calls a function for every particle index in the buckets the given bounds fall into. The buckets are
+	 * walked in place, so unlike building a list of neighbours this never allocates
+	 * @param _position glm::vec2 The position to use as the search case
+	 * @param _radius float The radius to use as the search case
+	 * @param _function Function Called as _function(int _index) for each particle found
 	 */
-	std::vector<Particle*> GetLocalObjects(Particle* _particle);
+	template <typename Function>
+	void ForEachNeighbour(glm::vec2 _position, float _radius, Function _function)
+	{
+		int m_cellIndices[4];
+		int m_cellCount = GetCellIndices(_position, _radius, m_cellIndices);
+
+		for (int c = 0; c < m_cellCount; c++)
+		{
+			std::vector<int> &m_bucket = m_hashTable[m_cellIndices[c]];
+			for (unsigned int i = 0; i < m_bucket.size(); i++)
+			{
+				_function(m_bucket[i]);
+			}
+		}
+	}
+
+	/**
+	 * Measures how full the buckets are. A particle spanning several cells counts once in each of them
+	 * @returns GridStats The occupancy of the buckets
+	 */
+	GridStats GetStats();
 
 	/**
 	 * Draws the cell boundaries for debugging purposes
@@ -57,7 +83,7 @@ public:
 	void DrawCellLines(SDL_Renderer* _renderer);
 
 	/** Getters **/
-	std::vector<Particle*>* GetHashTable() { return m_hashTable; }
+	std::vector<int>* GetHashTable() { return m_hashTable; }
 	int GetSize() { return m_tableSize; }
 };
 #endif // !_SPATIALHASHTABLE_H_
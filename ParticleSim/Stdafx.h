@@ -1,15 +1,25 @@
 // Standard Lib includes
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <climits>
+#include <chrono>
+#include <condition_variable>
 #include <ctime>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <iomanip>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <sstream>
 #include <stdarg.h>
 #include <string>
 #include <map>
+#include <thread>
 #include <vector>
 
 // Third-party Lib includes
@@ -22,7 +32,26 @@
 
 // Project includes
 #include "UIText.h"
+#include "MappedFile.h"
+#include "Benchmark.h"
+#include "TraceWriter.h"
+#include "ZoneProfiler.h"
+#include "JobSystem.h"
+#include "TaskGraph.h"
 #include "FPSProfiler.h"
-#include "Particle.h"
+#include "ParticleStore.h"
+#include "MortonSorter.h"
+#include "Snapshot.h"
+#include "Trajectory.h"
+#include "TrajectoryPlayer.h"
 #include "SpatialHashTable.h"
+#include "CellGrid.h"
+#include "SparseHashGrid.h"
+#include "SweepAndPrune.h"
+#include "DynamicAABBTree.h"
+#include "CollisionKernel.h"
+#include "CollisionSolver.h"
+#include "VerletList.h"
+#include "ParticleRenderer.h"
+#include "Rasteriser.h"
 #include "Application.h"
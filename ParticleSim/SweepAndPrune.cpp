@@ -0,0 +1,213 @@
+#include "Stdafx.h"
+#include "SweepAndPrune.h"
+
+/**
+ * Constructs an empty sweep and prune broad phase
+ * @param _jobs JobSystem* The job system to refresh and sweep the boxes across
+ */
+SweepAndPrune::SweepAndPrune(JobSystem* _jobs)
+{
+	m_jobs = _jobs;
+
+	m_store = nullptr;
+	m_generation = 0;
+	m_valid = false;
+	m_pairChunks = 0;
+
+	m_maxWidth = 0.0f;
+	m_skipped = 0;
+	m_moves = 0;
+	m_overlaps = 0;
+	m_maxOverlaps = 0;
+}
+
+SweepAndPrune::~SweepAndPrune()
+{
+}
+
+/**
+ * Refreshes every box from the current particle positions and puts them back in order
+ * @param _particles ParticleStore& The particles to track
+ */
+void SweepAndPrune::Update(ParticleStore &_particles)
+{
+	ScopedZone m_zone("SortBoxes");
+
+	int m_count = _particles.Size();
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_radius = _particles.Radius();
+
+	// Indices mean nothing once particles have been added, removed or reordered, so start again from one box each
+	bool m_resort = (!m_valid || &_particles != m_store || _particles.GetGeneration() != m_generation);
+	if (m_resort)
+	{
+		m_boxes.resize(m_count);
+		for (int k = 0; k < m_count; k++)
+		{
+			m_boxes[k].m_index = k;
+		}
+		m_store = &_particles;
+		m_generation = _particles.GetGeneration();
+		m_valid = true;
+	}
+
+	// Move every box to where its particle is now, each box is independent so split it across the threads
+	m_jobs->ParallelFor(0, m_count, BOXES_PER_JOB, [&](int _begin, int _end)
+	{
+		for (int k = _begin; k < _end; k++)
+		{
+			Box &m_box = m_boxes[k];
+			int i = m_box.m_index;
+			// A particle without a position gets a box past the end of the sweep that overlaps nothing
+			if (!std::isfinite(m_x[i]) || !std::isfinite(m_y[i]))
+			{
+				m_box.m_minX = m_box.m_minY = FLT_MAX;
+				m_box.m_maxX = m_box.m_maxY = -FLT_MAX;
+				continue;
+			}
+			m_box.m_minX = m_x[i] - m_radius[i];
+			m_box.m_maxX = m_x[i] + m_radius[i];
+			m_box.m_minY = m_y[i] - m_radius[i];
+			m_box.m_maxY = m_y[i] + m_radius[i];
+		}
+	});
+
+	if (m_resort)
+	{
+		std::sort(m_boxes.begin(), m_boxes.end(), Before);
+	}
+
+	// Insertion sort the boxes back into order. Each box only moves past the few boxes it overtook since the last
+	// step, which makes this close to linear where a full sort would start from nothing every time
+	m_maxWidth = 0.0f;
+	m_skipped = 0;
+	m_moves = 0;
+	for (int k = 0; k < m_count; k++)
+	{
+		Box m_box = m_boxes[k];
+		int m = k - 1;
+		while (m >= 0 && Before(m_box, m_boxes[m]))
+		{
+			m_boxes[m + 1] = m_boxes[m];
+			m--;
+		}
+		m_boxes[m + 1] = m_box;
+		m_moves += k - 1 - m;
+
+		if (m_box.m_minX == FLT_MAX)
+		{
+			m_skipped++;
+		}
+		else if (m_box.m_maxX - m_box.m_minX > m_maxWidth && std::isfinite(m_box.m_maxX - m_box.m_minX))
+		{
+			m_maxWidth = m_box.m_maxX - m_box.m_minX;
+		}
+	}
+
+	// The pairs from the last sweep belong to the old order
+	m_pairChunks = 0;
+	m_overlaps = 0;
+	m_maxOverlaps = 0;
+}
+
+/**
+ * Sweeps the sorted boxes for every pair overlapping on both axes. The boxes must have been updated first
+ */
+void SweepAndPrune::FindPairs()
+{
+	ScopedZone m_zone("SweepBoxes");
+
+	int m_count = (int)m_boxes.size();
+	const Box* m_sorted = m_boxes.data();
+	m_pairChunks = (m_count + BOXES_PER_JOB - 1) / BOXES_PER_JOB;
+	if ((int)m_chunkPairs.size() < m_pairChunks)
+	{
+		m_chunkPairs.resize(m_pairChunks);
+	}
+	m_chunkPairCounts.resize(m_pairChunks);
+	m_chunkOverlaps.assign(m_pairChunks, 0);
+	m_chunkMaxOverlaps.assign(m_pairChunks, 0);
+
+	// The boxes are only read, so every chunk can be swept at once into its own pairs
+	m_jobs->ParallelFor(0, m_pairChunks, 1, [&](int _begin, int _end)
+	{
+		for (int c = _begin; c < _end; c++)
+		{
+			std::vector<int> &m_pairs = m_chunkPairs[c];
+			int m_used = 0;
+			for (int a = c * BOXES_PER_JOB; a < std::min((c + 1) * BOXES_PER_JOB, m_count); a++)
+			{
+				// Copy the box out, writing the pairs would otherwise make the compiler read it again every time
+				Box m_box = m_sorted[a];
+
+				// Every box after this one starting before its right edge overlaps it along x
+				int m_end = a + 1;
+				while (m_end < m_count && m_sorted[m_end].m_minX <= m_box.m_maxX)
+				{
+					m_end++;
+				}
+				m_chunkOverlaps[c] += m_end - a - 1;
+				m_chunkMaxOverlaps[c] = std::max(m_chunkMaxOverlaps[c], m_end - a - 1);
+
+				// Make room for all of them, then keep the ones overlapping on y as well without a branch. Only a
+				// few boxes in a hundred do, and the branch cost more than the whole test. The buffer only ever grows
+				// so filling the new room doesn't cost every box
+				if ((int)m_pairs.size() < m_used + 2 * (m_end - a - 1))
+				{
+					m_pairs.resize(std::max(m_pairs.size() * 2, (size_t)(m_used + 2 * (m_end - a - 1))));
+				}
+				int* m_out = m_pairs.data() + m_used;
+				int m_kept = 0;
+				for (int b = a + 1; b < m_end; b++)
+				{
+					m_out[m_kept] = m_box.m_index;
+					m_out[m_kept + 1] = m_sorted[b].m_index;
+					m_kept += 2 * (int)((m_sorted[b].m_minY <= m_box.m_maxY) & (m_sorted[b].m_maxY >= m_box.m_minY));
+				}
+				m_used += m_kept;
+			}
+			m_chunkPairCounts[c] = m_used;
+		}
+	});
+
+	for (int c = 0; c < m_pairChunks; c++)
+	{
+		m_overlaps += m_chunkOverlaps[c];
+		m_maxOverlaps = std::max(m_maxOverlaps, m_chunkMaxOverlaps[c]);
+	}
+}
+
+/**
+ * Measures how many boxes overlapped along x during the last sweep
+ * @returns GridStats The boxes overlapping each box further along the sweep, each box counting as a cell
+ */
+GridStats SweepAndPrune::GetStats()
+{
+	int m_boxCount = (int)m_boxes.size();
+	int m_placed = m_boxCount - m_skipped;
+	GridStats m_stats = { 0, m_boxCount, m_placed, m_maxOverlaps, 0.0f };
+	m_stats.m_meanOccupancy = (m_placed > 0 ? (float)m_overlaps / m_placed : 0.0f);
+
+	return m_stats;
+}
+
+/**
+ * Draws a line where each job's run of the sweep starts, for debugging purposes
+ * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+ * @param _screenHeight int The height of the screen
+ */
+void SweepAndPrune::DrawSweepLines(SDL_Renderer* _renderer, int _screenHeight)
+{
+	SDL_SetRenderDrawColor(_renderer, 43, 206, 239, 255);
+	for (unsigned int k = 0; k < m_boxes.size(); k += BOXES_PER_JOB)
+	{
+		// Boxes past the end of the sweep have no position to draw at
+		if (m_boxes[k].m_minX == FLT_MAX)
+		{
+			break;
+		}
+		int m_x = (int)std::min(std::max(m_boxes[k].m_minX, -1.0f), 1e6f);
+		SDL_RenderDrawLine(_renderer, m_x, 0, m_x, _screenHeight);
+	}
+}
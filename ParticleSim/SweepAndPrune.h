@@ -0,0 +1,141 @@
+#ifndef _SWEEPANDPRUNE_H_
+#define _SWEEPANDPRUNE_H_
+/**
+ * Broad phase that sorts the bounding box of every particle along the x axis and sweeps the sorted boxes for
+ * overlaps, with no cells at all, so it doesn't care how big the particles are, how they are clustered or how far
+ * they spread. Boxes are kept sorted across steps: particles only move a little each step, so the order from the
+ * step before is almost right and an insertion sort puts it back in close to linear time. The boxes are only sorted
+ * from scratch when the store has added, removed or reordered particles.
+ *
+ * Boxes are ordered by their left edge, then by particle index, so the order only depends on where the particles
+ * are and a run carries on the same after a snapshot. The sweep walks each box forward until the boxes start past
+ * its right edge, keeping the pairs that overlap on y as well. It runs across the job system in chunks of the
+ * sorted boxes and keeps each chunk's pairs apart, so they can be responded to in sweep order afterwards.
+ */
+class ParticleStore;
+class SweepAndPrune
+{
+public:
+	// The bounds of one particle along both axes
+	struct Box
+	{
+		float m_minX, m_maxX;
+		float m_minY, m_maxY;
+		int m_index; // The particle the box belongs to
+	};
+private:
+	// The amount of boxes handed to a job at once
+	static const int BOXES_PER_JOB = 1024;
+
+	// The job system the boxes are refreshed and swept across
+	JobSystem* m_jobs;
+
+	// Every particle's box, sorted by left edge then index
+	std::vector<Box> m_boxes;
+	// The store the boxes were sorted for and its generation at the time, boxes are sorted again if either changes
+	ParticleStore* m_store;
+	unsigned int m_generation;
+	// Cleared when something outside the store means the boxes have to be sorted again
+	bool m_valid;
+
+	// The pairs each job found overlapping on both axes, two particle indices a pair, and how many jobs the last
+	// sweep was split into, 0 until the boxes have been swept since they were updated. Each job's buffer is kept at
+	// the most it has needed and the pairs found only fill the start of it
+	std::vector<std::vector<int>> m_chunkPairs;
+	std::vector<int> m_chunkPairCounts;
+	int m_pairChunks;
+	// The boxes each job found overlapping along x, and the most any one box overlapped
+	std::vector<long long> m_chunkOverlaps;
+	std::vector<int> m_chunkMaxOverlaps;
+
+	// The widest box seen during the last update
+	float m_maxWidth;
+	// The amount of particles without a position during the last update
+	int m_skipped;
+	// The amount of places boxes were moved by the last insertion sort
+	long long m_moves;
+	// The boxes found overlapping along x during the last sweep, and the most any one box overlapped
+	long long m_overlaps;
+	int m_maxOverlaps;
+
+	/**
+	 * Compares two boxes by the order they are swept in
+	 * @param _a const Box& The first box
+	 * @param _b const Box& The second box
+	 * @returns bool Returns true if the first box comes before the second
+	 */
+	static bool Before(const Box &_a, const Box &_b) { return _a.m_minX < _b.m_minX || (_a.m_minX == _b.m_minX && _a.m_index < _b.m_index); }
+public:
+	/**
+	 * Constructs an empty sweep and prune broad phase
+	 * @param _jobs JobSystem* The job system to refresh and sweep the boxes across
+	 */
+	SweepAndPrune(JobSystem* _jobs);
+	~SweepAndPrune();
+
+	/**
+	 * Refreshes every box from the current particle positions and puts them back in order
+	 * @param _particles ParticleStore& The particles to track
+	 */
+	void Update(ParticleStore &_particles);
+
+	/**
+	 * Sweeps the sorted boxes for every pair overlapping on both axes. The boxes must have been updated first
+	 */
+	void FindPairs();
+
+	/**
+	 * Calls a function for every particle whose box overlaps the given bounds. The boxes must have been updated first
+	 * @param _position glm::vec2 The position to use as the search case
+	 * @param _radius float The radius to use as the search case
+	 * @param _function Function Called as _function(int _index) for each particle found
+	 */
+	template <typename Function>
+	void ForEachNeighbour(glm::vec2 _position, float _radius, Function _function)
+	{
+		// A particle without a position was sorted to the end and can't touch anything
+		if (!std::isfinite(_position.x) || !std::isfinite(_position.y))
+		{
+			return;
+		}
+
+		// Boxes are sorted by their left edge, so any box reaching the bounds starts at most the widest box before them
+		Box m_first = { _position.x - _radius - m_maxWidth, 0.0f, 0.0f, 0.0f, -1 };
+		std::vector<Box>::iterator m_box = std::lower_bound(m_boxes.begin(), m_boxes.end(), m_first, Before);
+		for (; m_box != m_boxes.end() && m_box->m_minX <= _position.x + _radius; ++m_box)
+		{
+			if (m_box->m_maxX >= _position.x - _radius && m_box->m_minY <= _position.y + _radius && m_box->m_maxY >= _position.y - _radius)
+			{
+				_function(m_box->m_index);
+			}
+		}
+	}
+
+	/**
+	 * Measures how many boxes overlapped along x during the last sweep
+	 * @returns GridStats The boxes overlapping each box further along the sweep, each box counting as a cell
+	 */
+	GridStats GetStats();
+
+	/**
+	 * Draws a line where each job's run of the sweep starts, for debugging purposes
+	 * @param _renderer SDL_Renderer* The SDL renderer used to draw graphics
+	 * @param _screenHeight int The height of the screen
+	 */
+	void DrawSweepLines(SDL_Renderer* _renderer, int _screenHeight);
+
+	// Marks the boxes as needing a full sort, for when the store is replaced
+	void Invalidate() { m_valid = false; }
+
+	/** Getters **/
+	float GetMaxRadius() { return m_maxWidth * 0.5f; }
+	int GetSkipped() { return m_skipped; }
+	long long GetMoves() { return m_moves; }
+	long long GetOverlaps() { return m_overlaps; }
+	const Box* GetBoxes() { return m_boxes.data(); }
+	int GetBoxCount() { return (int)m_boxes.size(); }
+	int GetPairChunks() { return m_pairChunks; }
+	const int* GetPairs(int _chunk) { return m_chunkPairs[_chunk].data(); }
+	int GetPairCount(int _chunk) { return m_chunkPairCounts[_chunk] / 2; }
+};
+#endif // !_SWEEPANDPRUNE_H_
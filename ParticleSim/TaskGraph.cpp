@@ -0,0 +1,95 @@
+#include "Stdafx.h"
+#include "TaskGraph.h"
+
+/**
+ * Constructs an empty task graph
+ * @param _jobs JobSystem* The job system the tasks are run on
+ */
+TaskGraph::TaskGraph(JobSystem* _jobs)
+{
+	m_jobs = _jobs;
+	m_remaining = 0;
+}
+
+TaskGraph::~TaskGraph()
+{
+}
+
+/**
+ * Adds a task to the graph
+ * @param _name const char* The name of the task
+ * @param _function std::function<void()> The work the task does
+ * @returns int The id of the task, used to add dependencies
+ */
+int TaskGraph::AddTask(const char* _name, std::function<void()> _function)
+{
+	Task* m_task = new Task();
+	m_task->m_name = _name;
+	m_task->m_function = _function;
+	m_task->m_dependencyCount = 0;
+	m_task->m_waitingOn = 0;
+
+	m_tasks.push_back(std::unique_ptr<Task>(m_task));
+	return (int)m_tasks.size() - 1;
+}
+
+/**
+ * Makes one task wait for another to finish before it starts
+ * @param _before int The id of the task that has to finish first
+ * @param _after int The id of the task that waits
+ */
+void TaskGraph::AddDependency(int _before, int _after)
+{
+	m_tasks[_before]->m_dependents.push_back(_after);
+	m_tasks[_after]->m_dependencyCount++;
+}
+
+/**
+ * Runs every task in the graph, returning once they have all finished. The calling thread helps run tasks
+ */
+void TaskGraph::Run()
+{
+	// Reset the dependency counters for this run
+	m_remaining = (int)m_tasks.size();
+	for (unsigned int i = 0; i < m_tasks.size(); i++)
+	{
+		m_tasks[i]->m_waitingOn = m_tasks[i]->m_dependencyCount;
+	}
+
+	// Start every task that doesn't wait on anything
+	for (unsigned int i = 0; i < m_tasks.size(); i++)
+	{
+		if (m_tasks[i]->m_dependencyCount == 0)
+		{
+			Schedule(i);
+		}
+	}
+
+	// Help out until the whole graph has finished
+	m_jobs->Wait(m_remaining);
+}
+
+/**
+ * Queues a task on the job system. Once it finishes, any dependents it was the last dependency of are queued
+ * @param _task int The index of the task to queue
+ */
+void TaskGraph::Schedule(int _task)
+{
+	m_jobs->Submit([this, _task]()
+	{
+		Task &m_task = *m_tasks[_task];
+		m_task.m_function();
+
+		// Release the tasks that were waiting on this one
+		for (unsigned int i = 0; i < m_task.m_dependents.size(); i++)
+		{
+			int m_dependent = m_task.m_dependents[i];
+			if (--m_tasks[m_dependent]->m_waitingOn == 0)
+			{
+				Schedule(m_dependent);
+			}
+		}
+
+		m_remaining--;
+	});
+}
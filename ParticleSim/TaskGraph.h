@@ -0,0 +1,70 @@
+#ifndef _TASKGRAPH_H_
+#define _TASKGRAPH_H_
+/**
+ * A set of named tasks with dependencies between them, run on the job system. A task is queued as soon as
+ * every task it depends on has finished, so tasks that don't depend on each other overlap. The graph is built
+ * once and can then be run as many times as needed, for example once per frame.
+ */
+class TaskGraph
+{
+private:
+	// A single task in the graph
+	struct Task
+	{
+		// The name of the task, used for debugging and profiling
+		std::string m_name;
+		// The work this task does
+		std::function<void()> m_function;
+		// The tasks which depend on this one
+		std::vector<int> m_dependents;
+		// The amount of tasks this one depends on
+		int m_dependencyCount;
+		// The amount of dependencies still to finish in the current run
+		std::atomic<int> m_waitingOn;
+	};
+
+	// The job system the tasks are run on
+	JobSystem* m_jobs;
+	// Every task in the graph
+	std::vector<std::unique_ptr<Task>> m_tasks;
+	// The amount of tasks still to finish in the current run
+	std::atomic<int> m_remaining;
+
+	/**
+	 * Queues a task on the job system. Once it finishes, any dependents it was the last dependency of are queued
+	 * @param _task int The index of the task to queue
+	 */
+	void Schedule(int _task);
+public:
+	/**
+	 * Constructs an empty task graph
+	 * @param _jobs JobSystem* The job system the tasks are run on
+	 */
+	TaskGraph(JobSystem* _jobs);
+	~TaskGraph();
+
+	/**
+	 * Adds a task to the graph
+	 * @param _name const char* The name of the task
+	 * @param _function std::function<void()> The work the task does
+	 * @returns int The id of the task, used to add dependencies
+	 */
+	int AddTask(const char* _name, std::function<void()> _function);
+
+	/**
+	 * Makes one task wait for another to finish before it starts
+	 * @param _before int The id of the task that has to finish first
+	 * @param _after int The id of the task that waits
+	 */
+	void AddDependency(int _before, int _after);
+
+	/**
+	 * Runs every task in the graph, returning once they have all finished. The calling thread helps run tasks
+	 */
+	void Run();
+
+	// Getters
+	int GetTaskCount() { return (int)m_tasks.size(); }
+	const std::string& GetTaskName(int _task) { return m_tasks[_task]->m_name; }
+};
+#endif // !_TASKGRAPH_H_
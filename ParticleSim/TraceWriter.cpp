@@ -0,0 +1,212 @@
+#include "Stdafx.h"
+#include "TraceWriter.h"
+
+TraceWriter::TraceWriter()
+{
+	m_ring.reset(new TraceEvent[RING_SIZE]);
+	m_head = 0;
+	m_tail = 0;
+	m_dropped = 0;
+	m_running = false;
+	m_wroteEvent = false;
+
+	m_startTicks = SDL_GetPerformanceCounter();
+	m_usPerTick = 1e6 / (double)SDL_GetPerformanceFrequency();
+}
+
+TraceWriter::~TraceWriter()
+{
+	Close();
+}
+
+/**
+ * Opens the trace file and starts the writer thread
+ * @param _outputFile const std::string& The file to write to
+ * @returns bool Returns false if the file couldn't be opened
+ */
+bool TraceWriter::Open(const std::string &_outputFile)
+{
+	m_output.open(_outputFile, std::ios::out | std::ios::trunc);
+	if (!m_output.is_open())
+	{
+		std::cerr << "Failed to open output file for the trace\n";
+		return false;
+	}
+
+	// The JSON array format, which viewers can still read if the run dies before the closing bracket
+	m_output << "[\n";
+	m_output << std::fixed << std::setprecision(3);
+
+	m_startTicks = SDL_GetPerformanceCounter();
+	m_running = true;
+	m_thread = std::thread(&TraceWriter::WriterLoop, this);
+
+	return true;
+}
+
+// Writes any events still in the ring, finishes the file and stops the writer thread
+void TraceWriter::Close()
+{
+	if (!m_running)
+	{
+		return;
+	}
+
+	// The writer thread empties the ring one last time before it stops
+	{
+		std::lock_guard<std::mutex> m_lock(m_ringMutex);
+		m_running = false;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+
+	// Record how much was lost so a gap in the trace can be explained
+	if (m_dropped > 0)
+	{
+		m_output << (m_wroteEvent ? ",\n" : "") << "{\"name\":\"DroppedEvents\",\"ph\":\"M\",\"pid\":1,\"args\":{\"count\":" << m_dropped << "}}";
+		m_wroteEvent = true;
+	}
+
+	m_output << "\n]\n";
+	m_output.close();
+}
+
+// The loop the writer thread runs until the trace is closed
+void TraceWriter::WriterLoop()
+{
+	std::vector<TraceEvent> m_batch;
+	m_batch.reserve(RING_SIZE);
+	bool m_finished = false;
+
+	while (!m_finished)
+	{
+		{
+			// Sleep until the ring is filling up, the trace is closing or it is time for a flush anyway
+			std::unique_lock<std::mutex> m_lock(m_ringMutex);
+			m_wake.wait_for(m_lock, std::chrono::milliseconds(FLUSH_INTERVAL), [this]()
+			{
+				return !m_running || m_head - m_tail >= RING_SIZE / 2;
+			});
+			m_finished = !m_running;
+
+			// Copy everything out so the lock isn't held while writing
+			m_batch.clear();
+			for (; m_tail < m_head; m_tail++)
+			{
+				m_batch.push_back(m_ring[m_tail % RING_SIZE]);
+			}
+		}
+
+		for (unsigned int i = 0; i < m_batch.size(); i++)
+		{
+			Write(m_batch[i]);
+		}
+		m_output.flush();
+	}
+}
+
+/**
+ * Pushes an event to the ring, dropping it if the ring is full
+ * @param _event const TraceEvent& The event to push
+ */
+void TraceWriter::Push(const TraceEvent &_event)
+{
+	bool m_wakeWriter = false;
+	{
+		std::lock_guard<std::mutex> m_lock(m_ringMutex);
+		if (!m_running)
+		{
+			return;
+		}
+		if (m_head - m_tail == RING_SIZE)
+		{
+			m_dropped++;
+			return;
+		}
+
+		m_ring[m_head % RING_SIZE] = _event;
+		m_head++;
+		m_wakeWriter = (m_head - m_tail == RING_SIZE / 2);
+	}
+
+	if (m_wakeWriter)
+	{
+		m_wake.notify_one();
+	}
+}
+
+/**
+ * Writes an event to the file, naming its thread the first time the thread is seen
+ * @param _event const TraceEvent& The event to write
+ */
+void TraceWriter::Write(const TraceEvent &_event)
+{
+	// Threads outside the job system share one track after the workers
+	int m_thread = (_event.m_thread < 0 ? 1000 : _event.m_thread);
+
+	if (std::find(m_namedThreads.begin(), m_namedThreads.end(), m_thread) == m_namedThreads.end())
+	{
+		m_namedThreads.push_back(m_thread);
+
+		std::string m_threadName = (m_thread == 0 ? "Main Thread" : m_thread == 1000 ? "Other Threads" : "Worker " + std::to_string(m_thread));
+		m_output << (m_wroteEvent ? ",\n" : "") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << m_thread
+			<< ",\"args\":{\"name\":\"" << m_threadName << "\"}}";
+		m_wroteEvent = true;
+	}
+
+	// Zones opened before the trace started come out with a negative time, which viewers are fine with
+	double m_timestamp = (double)(long long)(_event.m_start - m_startTicks) * m_usPerTick;
+
+	m_output << (m_wroteEvent ? ",\n" : "") << "{\"name\":\"" << _event.m_name << "\",\"ph\":\"" << _event.m_phase
+		<< "\",\"ts\":" << m_timestamp << ",\"pid\":1,\"tid\":" << m_thread;
+	switch (_event.m_phase)
+	{
+		case 'X':
+		{
+			m_output << ",\"dur\":" << (double)(_event.m_end - _event.m_start) * m_usPerTick;
+			break;
+		}
+		case 'C':
+		{
+			m_output << ",\"args\":{\"value\":" << _event.m_value << "}";
+			break;
+		}
+	}
+	m_output << "}";
+	m_wroteEvent = true;
+}
+
+/**
+ * Adds a zone that has finished
+ * @param _name const char* The name of the zone, has to be a string literal
+ * @param _start Uint64 When the zone was opened in performance counter ticks
+ * @param _end Uint64 When the zone was closed in performance counter ticks
+ */
+void TraceWriter::AddZone(const char* _name, Uint64 _start, Uint64 _end)
+{
+	TraceEvent m_event;
+	m_event.m_name = _name;
+	m_event.m_phase = 'X';
+	m_event.m_thread = JobSystem::GetThreadIndex();
+	m_event.m_start = _start;
+	m_event.m_end = _end;
+	m_event.m_value = 0;
+	Push(m_event);
+}
+
+/**
+ * Adds a new value for a counter, eg: the particle count
+ * @param _name const char* The name of the counter, has to be a string literal
+ * @param _value long long The new value
+ */
+void TraceWriter::AddCounter(const char* _name, long long _value)
+{
+	TraceEvent m_event;
+	m_event.m_name = _name;
+	m_event.m_phase = 'C';
+	m_event.m_thread = JobSystem::GetThreadIndex();
+	m_event.m_start = SDL_GetPerformanceCounter();
+	m_event.m_end = m_event.m_start;
+	m_event.m_value = _value;
+	Push(m_event);
+}
@@ -0,0 +1,105 @@
+#ifndef _TRACEWRITER_H_
+#define _TRACEWRITER_H_
+/**
+ * Streams timeline events to a Chrome trace-event JSON file, which can be opened in Perfetto or about:tracing.
+ * Events are copied into a fixed size ring buffer and a background thread writes them out, so the threads
+ * recording events never touch the file. If the writer falls behind and the ring fills up, new events are
+ * dropped and counted rather than growing memory.
+ */
+class TraceWriter
+{
+private:
+	// The amount of events the ring buffer holds
+	static const int RING_SIZE = 1 << 16;
+	// How often the writer thread empties the ring when it isn't filling up, in milliseconds
+	static const int FLUSH_INTERVAL = 100;
+
+	// A single event in the ring
+	struct TraceEvent
+	{
+		// The name of the event, has to be a string literal
+		const char* m_name;
+		// The trace-event phase: 'X' for a zone, 'C' for a counter
+		char m_phase;
+		// The job system index of the thread that recorded the event
+		int m_thread;
+		// When the event started and ended, in performance counter ticks
+		Uint64 m_start;
+		Uint64 m_end;
+		// The value of a counter
+		long long m_value;
+	};
+
+	// The ring buffer and the total amount of events ever pushed to and popped from it
+	std::unique_ptr<TraceEvent[]> m_ring;
+	unsigned long long m_head;
+	unsigned long long m_tail;
+	// Guards the ring
+	std::mutex m_ringMutex;
+	// Wakes the writer thread early when the ring is filling up or the writer is closing
+	std::condition_variable m_wake;
+	// The amount of events dropped because the ring was full
+	std::atomic<long long> m_dropped;
+
+	// The writer thread, running while m_running is true
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+	// The file being written
+	std::ofstream m_output;
+	// True once the first event has been written, every event after it needs a comma before it
+	bool m_wroteEvent;
+	// The threads that have been given a name in the trace
+	std::vector<int> m_namedThreads;
+
+	// When the trace started, event times are written relative to it
+	Uint64 m_startTicks;
+	// Converts performance counter ticks to microseconds
+	double m_usPerTick;
+
+	// The loop the writer thread runs until the trace is closed
+	void WriterLoop();
+
+	/**
+	 * Pushes an event to the ring, dropping it if the ring is full
+	 * @param _event const TraceEvent& The event to push
+	 */
+	void Push(const TraceEvent &_event);
+
+	/**
+	 * Writes an event to the file, naming its thread the first time the thread is seen
+	 * @param _event const TraceEvent& The event to write
+	 */
+	void Write(const TraceEvent &_event);
+public:
+	TraceWriter();
+	~TraceWriter();
+
+	/**
+	 * Opens the trace file and starts the writer thread
+	 * @param _outputFile const std::string& The file to write to
+	 * @returns bool Returns false if the file couldn't be opened
+	 */
+	bool Open(const std::string &_outputFile);
+
+	// Writes any events still in the ring, finishes the file and stops the writer thread
+	void Close();
+
+	/**
+	 * Adds a zone that has finished
+	 * @param _name const char* The name of the zone, has to be a string literal
+	 * @param _start Uint64 When the zone was opened in performance counter ticks
+	 * @param _end Uint64 When the zone was closed in performance counter ticks
+	 */
+	void AddZone(const char* _name, Uint64 _start, Uint64 _end);
+
+	/**
+	 * Adds a new value for a counter, eg: the particle count
+	 * @param _name const char* The name of the counter, has to be a string literal
+	 * @param _value long long The new value
+	 */
+	void AddCounter(const char* _name, long long _value);
+
+	// Getters
+	long long GetDropped() { return m_dropped; }
+};
+#endif // !_TRACEWRITER_H_
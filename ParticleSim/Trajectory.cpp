@@ -0,0 +1,478 @@
+#include "Stdafx.h"
+#include "Trajectory.h"
+
+/**
+ * Turns a position into quantisation steps, positions that aren't numbers are stored as 0
+ * @param _position float The position in pixels
+ * @param _scale int The amount of quantisation steps per pixel
+ * @returns int The position in quantisation steps
+ */
+static int Quantise(float _position, int _scale)
+{
+	if (!std::isfinite(_position))
+	{
+		return 0;
+	}
+	// Far enough outside any window that clamping never matters, and the deltas still fit in an int
+	return (int)lroundf(std::min(std::max(_position * _scale, -16777216.0f), 16777216.0f));
+}
+
+/**
+ * Appends a value as a varint, 7 bits per byte with the top bit set on every byte but the last
+ * @param _output std::vector<Uint8>& The buffer to append to
+ * @param _value Uint32 The value to write
+ */
+static void WriteVarint(std::vector<Uint8> &_output, Uint32 _value)
+{
+	while (_value >= 0x80)
+	{
+		_output.push_back((Uint8)(_value | 0x80));
+		_value >>= 7;
+	}
+	_output.push_back((Uint8)_value);
+}
+
+/**
+ * Reads a varint
+ * @param _input const Uint8*& The next byte to read, moved past the varint
+ * @param _end const Uint8* One past the last byte that can be read
+ * @param _value Uint32& Filled with the value
+ * @returns bool Returns false if the varint runs past the end or is too long
+ */
+static bool ReadVarint(const Uint8* &_input, const Uint8* _end, Uint32 &_value)
+{
+	_value = 0;
+	for (int m_shift = 0; m_shift < 35; m_shift += 7)
+	{
+		if (_input == _end)
+		{
+			return false;
+		}
+		Uint8 m_byte = *_input++;
+		_value |= (Uint32)(m_byte & 0x7F) << m_shift;
+		if ((m_byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Zigzag encoding maps small negative and positive numbers to small unsigned ones: 0, -1, 1, -2 to 0, 1, 2, 3
+static Uint32 ZigzagEncode(int _value) { return ((Uint32)_value << 1) ^ (Uint32)(_value >> 31); }
+static int ZigzagDecode(Uint32 _value) { return (int)(_value >> 1) ^ -(int)(_value & 1); }
+
+TrajectoryRecorder::TrajectoryRecorder()
+{
+	m_head = 0;
+	m_tail = 0;
+	m_running = false;
+	m_frames = 0;
+	m_lastParticleCount = -1;
+	m_keyframeRequested = false;
+	m_bytesWritten = 0;
+	m_stallTicks = 0;
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+	Close();
+}
+
+/**
+ * Opens the file and starts the encoder thread
+ * @param _outputFile const std::string& The file to write to
+ * @param _width int The width of the screen the particles move in
+ * @param _height int The height of the screen the particles move in
+ * @param _fixedTimestep float The timestep between frames
+ * @param _keyframeInterval int The most frames between two keyframes
+ * @returns bool Returns false if the file couldn't be opened
+ */
+bool TrajectoryRecorder::Open(const std::string &_outputFile, int _width, int _height, float _fixedTimestep, int _keyframeInterval)
+{
+	m_output.open(_outputFile, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!m_output.is_open())
+	{
+		std::cerr << "Failed to open " << _outputFile << " to record to\n";
+		return false;
+	}
+
+	memcpy(m_header.m_magic, "PSIMTRAJ", 8);
+	m_header.m_version = VERSION;
+	m_header.m_headerSize = sizeof(TrajectoryFileHeader);
+	m_header.m_width = _width;
+	m_header.m_height = _height;
+	m_header.m_scale = SCALE;
+	m_header.m_keyframeInterval = std::max(_keyframeInterval, 1);
+	m_header.m_fixedTimestep = _fixedTimestep;
+	m_output.write((const char*)&m_header, sizeof(m_header));
+	m_bytesWritten = sizeof(m_header);
+
+	m_running = true;
+	m_thread = std::thread(&TrajectoryRecorder::EncoderLoop, this);
+
+	return true;
+}
+
+// Encodes any frames still waiting, finishes the file and stops the encoder thread
+void TrajectoryRecorder::Close()
+{
+	if (!m_running)
+	{
+		return;
+	}
+
+	// The encoder empties the queue before it stops
+	{
+		std::lock_guard<std::mutex> m_lock(m_queueMutex);
+		m_running = false;
+	}
+	m_frameReady.notify_one();
+	m_thread.join();
+
+	m_output.close();
+}
+
+/**
+ * Captures the current state of every particle as the next frame
+ * @param _particles ParticleStore& The particles to capture
+ * @param _simulationTime double The simulated time of the frame in seconds
+ */
+void TrajectoryRecorder::Capture(ParticleStore &_particles, double _simulationTime)
+{
+	if (!m_running)
+	{
+		return;
+	}
+
+	// Wait for the encoder to free up a slot
+	CapturedFrame* m_slot;
+	{
+		std::unique_lock<std::mutex> m_lock(m_queueMutex);
+		if (m_head - m_tail == QUEUE_SIZE)
+		{
+			Uint64 m_start = SDL_GetPerformanceCounter();
+			m_slotFree.wait(m_lock, [this]() { return m_head - m_tail < QUEUE_SIZE; });
+			m_stallTicks += SDL_GetPerformanceCounter() - m_start;
+		}
+		m_slot = &m_queue[m_head % QUEUE_SIZE];
+	}
+
+	// The encoder never touches slots past the tail, so the copy doesn't need the lock
+	int m_size = _particles.Size();
+	m_slot->m_particleCount = m_size;
+	m_slot->m_simulationTime = _simulationTime;
+	m_slot->m_keyframe = (m_frames % m_header.m_keyframeInterval == 0 || m_size != m_lastParticleCount || m_keyframeRequested);
+	m_keyframeRequested = false;
+	m_slot->m_x.assign(_particles.X(), _particles.X() + m_size);
+	m_slot->m_y.assign(_particles.Y(), _particles.Y() + m_size);
+	if (m_slot->m_keyframe)
+	{
+		m_slot->m_radius.assign(_particles.Radius(), _particles.Radius() + m_size);
+		m_slot->m_colour.assign(_particles.Colour(), _particles.Colour() + m_size);
+	}
+	m_frames++;
+	m_lastParticleCount = m_size;
+
+	{
+		std::lock_guard<std::mutex> m_lock(m_queueMutex);
+		m_head++;
+	}
+	m_frameReady.notify_one();
+}
+
+// The loop the encoder thread runs until the recorder is closed
+void TrajectoryRecorder::EncoderLoop()
+{
+	// The quantised positions of the last frame encoded, the next delta frame is relative to them
+	std::vector<int> m_lastX, m_lastY;
+	std::vector<Uint8> m_payload;
+	Uint32 m_frame = 0;
+
+	while (true)
+	{
+		CapturedFrame* m_captured;
+		{
+			std::unique_lock<std::mutex> m_lock(m_queueMutex);
+			m_frameReady.wait(m_lock, [this]() { return !m_running || m_tail < m_head; });
+			if (m_tail == m_head)
+			{
+				// Closing with nothing left to encode
+				break;
+			}
+			m_captured = &m_queue[m_tail % QUEUE_SIZE];
+		}
+
+		int m_size = m_captured->m_particleCount;
+		m_lastX.resize(m_size);
+		m_lastY.resize(m_size);
+		m_payload.clear();
+		if (m_captured->m_keyframe)
+		{
+			// Absolute positions, then the radii and colours which only change when particles do
+			for (int i = 0; i < m_size; i++)
+			{
+				m_lastX[i] = Quantise(m_captured->m_x[i], SCALE);
+				m_lastY[i] = Quantise(m_captured->m_y[i], SCALE);
+				WriteVarint(m_payload, ZigzagEncode(m_lastX[i]));
+				WriteVarint(m_payload, ZigzagEncode(m_lastY[i]));
+			}
+			size_t m_start = m_payload.size();
+			m_payload.resize(m_start + m_size * (sizeof(float) + 3));
+			if (m_size > 0)
+			{
+				memcpy(&m_payload[m_start], m_captured->m_radius.data(), m_size * sizeof(float));
+			}
+			for (int i = 0; i < m_size; i++)
+			{
+				Uint8* m_rgb = &m_payload[m_start + m_size * sizeof(float) + i * 3];
+				m_rgb[0] = m_captured->m_colour[i].r;
+				m_rgb[1] = m_captured->m_colour[i].g;
+				m_rgb[2] = m_captured->m_colour[i].b;
+			}
+		}
+		else
+		{
+			// How far each particle moved since the last frame
+			for (int i = 0; i < m_size; i++)
+			{
+				int m_x = Quantise(m_captured->m_x[i], SCALE);
+				int m_y = Quantise(m_captured->m_y[i], SCALE);
+				WriteVarint(m_payload, ZigzagEncode(m_x - m_lastX[i]));
+				WriteVarint(m_payload, ZigzagEncode(m_y - m_lastY[i]));
+				m_lastX[i] = m_x;
+				m_lastY[i] = m_y;
+			}
+		}
+
+		TrajectoryFrameHeader m_frameHeader;
+		memset(&m_frameHeader, 0, sizeof(m_frameHeader));
+		m_frameHeader.m_payloadSize = (Uint32)m_payload.size();
+		m_frameHeader.m_particleCount = (Uint32)m_size;
+		m_frameHeader.m_simulationTime = m_captured->m_simulationTime;
+		m_frameHeader.m_keyframe = (m_captured->m_keyframe ? 1 : 0);
+		m_frameHeader.m_frame = m_frame++;
+
+		// Hand the slot back before writing, the encoded copy is all we need now
+		{
+			std::lock_guard<std::mutex> m_lock(m_queueMutex);
+			m_tail++;
+		}
+		m_slotFree.notify_one();
+
+		m_output.write((const char*)&m_frameHeader, sizeof(m_frameHeader));
+		m_output.write((const char*)m_payload.data(), m_payload.size());
+		m_bytesWritten += sizeof(m_frameHeader) + m_payload.size();
+	}
+
+	m_output.flush();
+}
+
+TrajectoryReader::TrajectoryReader()
+{
+	memset(&m_header, 0, sizeof(m_header));
+	m_decoded = -1;
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+	Close();
+}
+
+/**
+ * Maps a trajectory file and indexes its frames. A file cut short, eg: by a crash, is read up to its last
+ * complete frame
+ * @param _inputFile const std::string& The file to read
+ * @returns bool Returns false if the file couldn't be mapped or isn't a trajectory of this version
+ */
+bool TrajectoryReader::Open(const std::string &_inputFile)
+{
+	Close();
+	if (!m_file.Open(_inputFile))
+	{
+		return false;
+	}
+
+	if (m_file.GetSize() < sizeof(TrajectoryFileHeader))
+	{
+		std::cerr << _inputFile << " is too small to be a trajectory\n";
+		Close();
+		return false;
+	}
+	memcpy(&m_header, m_file.GetData(), sizeof(m_header));
+	if (memcmp(m_header.m_magic, "PSIMTRAJ", 8) != 0)
+	{
+		std::cerr << _inputFile << " is not a trajectory\n";
+		Close();
+		return false;
+	}
+	if (m_header.m_version != TrajectoryRecorder::VERSION || m_header.m_headerSize != sizeof(TrajectoryFileHeader) || m_header.m_scale <= 0)
+	{
+		std::cerr << _inputFile << " is a version " << m_header.m_version << " trajectory, only version " << TrajectoryRecorder::VERSION << " can be read\n";
+		Close();
+		return false;
+	}
+
+	// Walk the frame headers, stopping at the first frame that runs off the end
+	size_t m_offset = sizeof(TrajectoryFileHeader);
+	while (m_offset + sizeof(TrajectoryFrameHeader) <= m_file.GetSize())
+	{
+		TrajectoryFrameHeader m_frameHeader;
+		memcpy(&m_frameHeader, m_file.GetData() + m_offset, sizeof(m_frameHeader));
+		if (m_offset + sizeof(TrajectoryFrameHeader) + m_frameHeader.m_payloadSize > m_file.GetSize())
+		{
+			break;
+		}
+
+		// A delta frame has to follow a frame with the same particles
+		bool m_keyframe = (m_frameHeader.m_keyframe != 0);
+		if (!m_keyframe && (m_index.empty() || m_index.back().m_particleCount != (int)m_frameHeader.m_particleCount))
+		{
+			break;
+		}
+
+		FrameIndex m_entry;
+		m_entry.m_offset = m_offset;
+		m_entry.m_particleCount = (int)m_frameHeader.m_particleCount;
+		m_entry.m_simulationTime = m_frameHeader.m_simulationTime;
+		m_entry.m_keyframe = m_keyframe;
+		m_index.push_back(m_entry);
+
+		m_offset += sizeof(TrajectoryFrameHeader) + m_frameHeader.m_payloadSize;
+	}
+
+	return true;
+}
+
+// Unmaps the file
+void TrajectoryReader::Close()
+{
+	m_file.Close();
+	m_index.clear();
+	m_decoded = -1;
+}
+
+/**
+ * Decodes a frame on top of the last one decoded
+ * @param _frame int The frame to decode, has to be a keyframe or the frame after the last one decoded
+ * @returns bool Returns false if the frame is corrupt
+ */
+bool TrajectoryReader::Decode(int _frame)
+{
+	const FrameIndex &m_entry = m_index[_frame];
+	const Uint8* m_input = m_file.GetData() + m_entry.m_offset + sizeof(TrajectoryFrameHeader);
+	TrajectoryFrameHeader m_frameHeader;
+	memcpy(&m_frameHeader, m_file.GetData() + m_entry.m_offset, sizeof(m_frameHeader));
+	const Uint8* m_end = m_input + m_frameHeader.m_payloadSize;
+	int m_size = m_entry.m_particleCount;
+
+	// Whatever happens the last frame decoded is no good to carry on from now
+	m_decoded = -1;
+	m_qx.resize(m_size);
+	m_qy.resize(m_size);
+	for (int i = 0; i < m_size; i++)
+	{
+		Uint32 m_x, m_y;
+		if (!ReadVarint(m_input, m_end, m_x) || !ReadVarint(m_input, m_end, m_y))
+		{
+			std::cerr << "Trajectory frame " << _frame << " is corrupt\n";
+			return false;
+		}
+		if (m_entry.m_keyframe)
+		{
+			m_qx[i] = ZigzagDecode(m_x);
+			m_qy[i] = ZigzagDecode(m_y);
+		}
+		else
+		{
+			m_qx[i] += ZigzagDecode(m_x);
+			m_qy[i] += ZigzagDecode(m_y);
+		}
+	}
+
+	if (m_entry.m_keyframe)
+	{
+		if ((size_t)(m_end - m_input) != m_size * (sizeof(float) + 3))
+		{
+			std::cerr << "Trajectory frame " << _frame << " is corrupt\n";
+			return false;
+		}
+		m_radius.resize(m_size);
+		m_colour.resize(m_size);
+		if (m_size > 0)
+		{
+			memcpy(m_radius.data(), m_input, m_size * sizeof(float));
+		}
+		m_input += m_size * sizeof(float);
+		for (int i = 0; i < m_size; i++)
+		{
+			m_colour[i] = { m_input[i * 3], m_input[i * 3 + 1], m_input[i * 3 + 2], 255 };
+		}
+	}
+
+	m_decoded = _frame;
+	return true;
+}
+
+/**
+ * Reads any frame in the file
+ * @param _frame int The index of the frame to read
+ * @param _output TrajectoryFrame& Filled with the frame
+ * @returns bool Returns false if the frame is out of range or corrupt
+ */
+bool TrajectoryReader::ReadFrame(int _frame, TrajectoryFrame &_output)
+{
+	if (_frame < 0 || _frame >= GetFrameCount())
+	{
+		return false;
+	}
+
+	// Carry on from the last frame when reading in order, otherwise start again from the keyframe before it
+	int m_start;
+	if (m_decoded >= 0 && m_decoded <= _frame)
+	{
+		m_start = m_decoded + 1;
+		for (int f = m_start; f <= _frame; f++)
+		{
+			// Jumping to a later keyframe is quicker than decoding up to it
+			if (m_index[f].m_keyframe)
+			{
+				m_start = f;
+			}
+		}
+	}
+	else
+	{
+		m_start = _frame;
+		while (!m_index[m_start].m_keyframe)
+		{
+			m_start--;
+		}
+	}
+
+	for (int f = m_start; f <= _frame; f++)
+	{
+		if (!Decode(f))
+		{
+			return false;
+		}
+	}
+
+	// Back to pixels
+	int m_size = m_index[_frame].m_particleCount;
+	float m_pixelsPerStep = 1.0f / m_header.m_scale;
+	_output.m_frame = _frame;
+	_output.m_simulationTime = m_index[_frame].m_simulationTime;
+	_output.m_x.resize(m_size);
+	_output.m_y.resize(m_size);
+	for (int i = 0; i < m_size; i++)
+	{
+		_output.m_x[i] = m_qx[i] * m_pixelsPerStep;
+		_output.m_y[i] = m_qy[i] * m_pixelsPerStep;
+	}
+	_output.m_radius = m_radius;
+	_output.m_colour = m_colour;
+
+	return true;
+}
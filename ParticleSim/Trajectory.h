@@ -0,0 +1,207 @@
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+
+// The start of every trajectory file
+struct TrajectoryFileHeader
+{
+	char m_magic[8]; // "PSIMTRAJ"
+	Uint32 m_version; // The layout version
+	Uint32 m_headerSize; // sizeof(TrajectoryFileHeader) when written
+	Sint32 m_width, m_height; // The screen the particles were recorded in
+	Sint32 m_scale; // The amount of quantisation steps per pixel
+	Sint32 m_keyframeInterval; // The most frames between two keyframes
+	float m_fixedTimestep; // The timestep between frames
+	Uint32 m_reserved;
+};
+
+// The start of every frame in a trajectory file
+struct TrajectoryFrameHeader
+{
+	Uint32 m_payloadSize; // The size of the encoded frame that follows in bytes
+	Uint32 m_particleCount; // The amount of particles in the frame
+	double m_simulationTime; // The simulated time of the frame in seconds
+	Uint32 m_keyframe; // 1 if the frame can be decoded on its own, 0 if it is relative to the frame before
+	Uint32 m_frame; // The index of the frame
+};
+
+// One decoded frame of a trajectory
+struct TrajectoryFrame
+{
+	int m_frame; // The index of the frame, -1 before anything has been read
+	double m_simulationTime; // The simulated time of the frame in seconds
+	std::vector<float> m_x, m_y; // Particle positions, rounded to the recording's quantisation
+	std::vector<float> m_radius; // Particle radii
+	std::vector<SDL_Color> m_colour; // Particle colours
+
+	TrajectoryFrame() : m_frame(-1), m_simulationTime(0.0) {}
+	int Size() { return (int)m_x.size(); }
+};
+
+/**
+ * Records the position of every particle after each step to a compact file for offline analysis. Positions are
+ * quantised to a fixed amount of steps per pixel and stored as the zigzag varint encoded change from the frame
+ * before, which for particles moving a few pixels a second is a byte or two per axis. Every so often, and
+ * whenever the particle count changes, a keyframe stores absolute positions along with the radii and colours so
+ * a reader can start from it.
+ *
+ * Capturing a frame only copies the particle arrays into one of a few preallocated slots. A background thread
+ * encodes and writes them, and if it falls behind, capturing waits for a free slot rather than dropping frames
+ * and breaking the chain of deltas.
+ */
+class TrajectoryRecorder
+{
+	// The reader checks files against our version
+	friend class TrajectoryReader;
+private:
+	// Bumped whenever the layout changes
+	static const Uint32 VERSION = 1;
+	// The amount of captured frames that can be waiting to be encoded
+	static const int QUEUE_SIZE = 4;
+	// The amount of quantisation steps per pixel, an eighth of a pixel is finer than anything drawn
+	static const int SCALE = 8;
+
+	// A captured frame waiting to be encoded
+	struct CapturedFrame
+	{
+		std::vector<float> m_x, m_y;
+		// Only filled in for keyframes
+		std::vector<float> m_radius;
+		std::vector<SDL_Color> m_colour;
+		int m_particleCount;
+		double m_simulationTime;
+		bool m_keyframe;
+	};
+
+	// The queue of captured frames and the total amount of frames ever pushed to and popped from it
+	CapturedFrame m_queue[QUEUE_SIZE];
+	unsigned long long m_head;
+	unsigned long long m_tail;
+	// Guards the queue counters
+	std::mutex m_queueMutex;
+	// Wakes the encoder when a frame is captured or the recorder is closing
+	std::condition_variable m_frameReady;
+	// Wakes capturing when the encoder frees up a slot
+	std::condition_variable m_slotFree;
+
+	// The encoder thread, running while m_running is true
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+	// The file being written
+	std::ofstream m_output;
+	// The file header, kept for the settings it holds
+	TrajectoryFileHeader m_header;
+
+	// The amount of frames captured, and the particle count of the last one
+	int m_frames;
+	int m_lastParticleCount;
+	// Makes the next frame captured a keyframe when true
+	bool m_keyframeRequested;
+	// The amount of bytes written, including headers
+	std::atomic<long long> m_bytesWritten;
+	// The performance counter ticks capturing spent waiting for a free slot
+	std::atomic<Uint64> m_stallTicks;
+
+	// The loop the encoder thread runs until the recorder is closed
+	void EncoderLoop();
+public:
+	TrajectoryRecorder();
+	~TrajectoryRecorder();
+
+	/**
+	 * Opens the file and starts the encoder thread
+	 * @param _outputFile const std::string& The file to write to
+	 * @param _width int The width of the screen the particles move in
+	 * @param _height int The height of the screen the particles move in
+	 * @param _fixedTimestep float The timestep between frames
+	 * @param _keyframeInterval int The most frames between two keyframes
+	 * @returns bool Returns false if the file couldn't be opened
+	 */
+	bool Open(const std::string &_outputFile, int _width, int _height, float _fixedTimestep, int _keyframeInterval);
+
+	// Encodes any frames still waiting, finishes the file and stops the encoder thread
+	void Close();
+
+	/**
+	 * Captures the current state of every particle as the next frame
+	 * @param _particles ParticleStore& The particles to capture
+	 * @param _simulationTime double The simulated time of the frame in seconds
+	 */
+	void Capture(ParticleStore &_particles, double _simulationTime);
+
+	// Makes the next frame captured a keyframe, needed when the particles have moved to other indices
+	void RequestKeyframe() { m_keyframeRequested = true; }
+
+	// Getters
+	int GetFrames() { return m_frames; }
+	long long GetBytesWritten() { return m_bytesWritten; }
+	double GetStallSeconds() { return (double)m_stallTicks / SDL_GetPerformanceFrequency(); }
+};
+
+/**
+ * Reads a trajectory file written by TrajectoryRecorder. The file is mapped rather than read, and the frames
+ * are indexed when it is opened so any frame can be decoded by starting from the keyframe before it. Reading
+ * the frame after the last one read carries on from it without going back to the keyframe.
+ */
+class TrajectoryReader
+{
+private:
+	// Where a frame is in the file
+	struct FrameIndex
+	{
+		size_t m_offset; // The start of the frame's header
+		int m_particleCount;
+		double m_simulationTime;
+		bool m_keyframe;
+	};
+
+	// The mapped file
+	MappedFile m_file;
+	// The file header
+	TrajectoryFileHeader m_header;
+	// Every complete frame in the file
+	std::vector<FrameIndex> m_index;
+
+	// The quantised positions, radii and colours of the last frame decoded
+	std::vector<int> m_qx, m_qy;
+	std::vector<float> m_radius;
+	std::vector<SDL_Color> m_colour;
+	// The index of the last frame decoded, -1 for none
+	int m_decoded;
+
+	/**
+	 * Decodes a frame on top of the last one decoded
+	 * @param _frame int The frame to decode, has to be a keyframe or the frame after the last one decoded
+	 * @returns bool Returns false if the frame is corrupt
+	 */
+	bool Decode(int _frame);
+public:
+	TrajectoryReader();
+	~TrajectoryReader();
+
+	/**
+	 * Maps a trajectory file and indexes its frames. A file cut short, eg: by a crash, is read up to its last
+	 * complete frame
+	 * @param _inputFile const std::string& The file to read
+	 * @returns bool Returns false if the file couldn't be mapped or isn't a trajectory of this version
+	 */
+	bool Open(const std::string &_inputFile);
+
+	// Unmaps the file
+	void Close();
+
+	/**
+	 * Reads any frame in the file
+	 * @param _frame int The index of the frame to read
+	 * @param _output TrajectoryFrame& Filled with the frame
+	 * @returns bool Returns false if the frame is out of range or corrupt
+	 */
+	bool ReadFrame(int _frame, TrajectoryFrame &_output);
+
+	// Getters
+	int GetFrameCount() { return (int)m_index.size(); }
+	int GetWidth() { return m_header.m_width; }
+	int GetHeight() { return m_header.m_height; }
+	float GetFixedTimestep() { return m_header.m_fixedTimestep; }
+	int GetKeyframeInterval() { return m_header.m_keyframeInterval; }
+};
+#endif // !_TRAJECTORY_H_
@@ -0,0 +1,202 @@
+#include "Stdafx.h"
+#include "TrajectoryPlayer.h"
+
+TrajectoryPlayer::TrajectoryPlayer()
+{
+	m_frameCount = 0;
+	m_fixedTimestep = 0.0166666667f;
+	for (int i = 0; i < DECODE_AHEAD; i++)
+	{
+		m_slots[i].m_index = -1;
+	}
+	m_wanted = 0;
+	m_running = false;
+	m_playTime = 0.0;
+	m_speed = 1.0f;
+	m_paused = false;
+	m_looping = true;
+}
+
+TrajectoryPlayer::~TrajectoryPlayer()
+{
+	Close();
+}
+
+/**
+ * Maps a recording and starts the decode worker
+ * @param _inputFile const std::string& The recording to play
+ * @returns bool Returns false if the recording couldn't be read or has no frames
+ */
+bool TrajectoryPlayer::Open(const std::string &_inputFile)
+{
+	if (!m_reader.Open(_inputFile))
+	{
+		return false;
+	}
+	if (m_reader.GetFrameCount() == 0)
+	{
+		std::cerr << _inputFile << " has no complete frames to play\n";
+		m_reader.Close();
+		return false;
+	}
+
+	m_frameCount = m_reader.GetFrameCount();
+	m_fixedTimestep = (m_reader.GetFixedTimestep() > 0.0f ? m_reader.GetFixedTimestep() : 0.0166666667f);
+	m_wanted = 0;
+	m_playTime = 0.0;
+
+	m_running = true;
+	m_thread = std::thread(&TrajectoryPlayer::WorkerLoop, this);
+
+	return true;
+}
+
+// Stops the decode worker and unmaps the recording
+void TrajectoryPlayer::Close()
+{
+	if (!m_running)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> m_lock(m_slotMutex);
+		m_running = false;
+	}
+	m_wakeWorker.notify_one();
+	m_thread.join();
+
+	m_reader.Close();
+}
+
+// The loop the worker thread runs until the player is closed
+void TrajectoryPlayer::WorkerLoop()
+{
+	// The next frame to decode
+	int m_next = 0;
+	bool m_reportedError = false;
+
+	std::unique_lock<std::mutex> m_lock(m_slotMutex);
+	while (m_running)
+	{
+		// Start again from the wanted frame if it has moved outside the window we were decoding
+		if (m_next < m_wanted || m_next >= m_wanted + DECODE_AHEAD)
+		{
+			m_next = m_wanted;
+		}
+		// Skip anything already decoded
+		while (m_next < m_wanted + DECODE_AHEAD && m_next < m_frameCount && m_slots[m_next % DECODE_AHEAD].m_index == m_next)
+		{
+			m_next++;
+		}
+		if (m_next >= m_wanted + DECODE_AHEAD || m_next >= m_frameCount)
+		{
+			// Nothing left to decode until the wanted frame moves
+			m_wakeWorker.wait(m_lock);
+			continue;
+		}
+
+		// Claim the slot so the player doesn't read it half written, then decode without holding the lock
+		int m_frame = m_next;
+		Slot &m_slot = m_slots[m_frame % DECODE_AHEAD];
+		m_slot.m_index = -1;
+		m_lock.unlock();
+
+		if (!m_reader.ReadFrame(m_frame, m_slot.m_frame))
+		{
+			// Show nothing rather than a stale frame
+			m_slot.m_frame.m_x.clear();
+			m_slot.m_frame.m_y.clear();
+			m_slot.m_frame.m_radius.clear();
+			m_slot.m_frame.m_colour.clear();
+			m_slot.m_frame.m_frame = m_frame;
+			if (!m_reportedError)
+			{
+				std::cerr << "Failed to decode frame " << m_frame << " of the recording\n";
+				m_reportedError = true;
+			}
+		}
+
+		m_lock.lock();
+		m_slot.m_index = m_frame;
+		m_next = m_frame + 1;
+		m_frameDecoded.notify_all();
+	}
+}
+
+/**
+ * Moves the playback clock on
+ * @param _deltaTime float The real time passed in seconds
+ */
+void TrajectoryPlayer::Update(float _deltaTime)
+{
+	if (m_paused)
+	{
+		return;
+	}
+
+	m_playTime += _deltaTime * m_speed;
+
+	// Wrap around or stop on the last frame at the end of the recording
+	double m_length = m_frameCount * (double)m_fixedTimestep;
+	if (m_playTime >= m_length)
+	{
+		if (m_looping)
+		{
+			m_playTime = fmod(m_playTime, m_length);
+		}
+		else
+		{
+			m_playTime = (m_frameCount - 1) * (double)m_fixedTimestep;
+			m_paused = true;
+		}
+	}
+}
+
+/**
+ * Gets the frame at the playback clock, waiting for it to be decoded if it isn't already
+ * @returns TrajectoryFrame& The frame, valid until the next call
+ */
+TrajectoryFrame& TrajectoryPlayer::GetFrame()
+{
+	int m_frame = GetFrameIndex();
+	Slot &m_slot = m_slots[m_frame % DECODE_AHEAD];
+
+	std::unique_lock<std::mutex> m_lock(m_slotMutex);
+	if (m_wanted != m_frame)
+	{
+		// The worker never writes the wanted frame's slot, so it stays ours until the wanted frame moves again
+		m_wanted = m_frame;
+		m_wakeWorker.notify_one();
+	}
+	m_frameDecoded.wait(m_lock, [&]() { return m_slot.m_index == m_frame; });
+
+	return m_slot.m_frame;
+}
+
+/**
+ * Moves the playback clock, clamped to the recording
+ * @param _seconds float How far to move in seconds, negative moves backwards
+ */
+void TrajectoryPlayer::Seek(float _seconds)
+{
+	m_playTime = std::min(std::max(m_playTime + _seconds, 0.0), (m_frameCount - 1) * (double)m_fixedTimestep);
+}
+
+/**
+ * Moves the playback clock to a frame
+ * @param _frame int The frame to move to, clamped to the recording
+ */
+void TrajectoryPlayer::SeekToFrame(int _frame)
+{
+	m_playTime = std::min(std::max(_frame, 0), m_frameCount - 1) * (double)m_fixedTimestep;
+}
+
+/**
+ * Changes the play speed, clamped between MIN_SPEED and MAX_SPEED
+ * @param _speed float The new play speed, 1 plays at the recorded rate
+ */
+void TrajectoryPlayer::SetSpeed(float _speed)
+{
+	m_speed = std::min(std::max(_speed, MIN_SPEED), MAX_SPEED);
+}
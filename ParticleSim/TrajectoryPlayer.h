@@ -0,0 +1,111 @@
+#ifndef _TRAJECTORYPLAYER_H_
+#define _TRAJECTORYPLAYER_H_
+/**
+ * Plays back a trajectory recording. A worker thread decodes the frames ahead of the one being shown into a
+ * small ring, so showing a frame while playing forwards is normally just a lookup. Seeking moves the window the
+ * worker decodes into, and the reader starts again from the nearest keyframe. Playback runs on its own clock,
+ * which can be paused, sped up, slowed down and looped.
+ */
+class TrajectoryPlayer
+{
+private:
+	// The amount of frames decoded ahead of the one being shown, including it
+	static const int DECODE_AHEAD = 8;
+	// The slowest and fastest play speeds
+	static constexpr float MIN_SPEED = 0.0625f;
+	static constexpr float MAX_SPEED = 64.0f;
+
+	// A decoded frame in the ring
+	struct Slot
+	{
+		TrajectoryFrame m_frame;
+		// The index of the frame held, -1 while empty or being decoded
+		int m_index;
+	};
+
+	// Only touched by the worker once open
+	TrajectoryReader m_reader;
+	// The amount of frames in the recording and the time between them
+	int m_frameCount;
+	float m_fixedTimestep;
+
+	// The ring of decoded frames, frame f lives in slot f % DECODE_AHEAD
+	Slot m_slots[DECODE_AHEAD];
+	// The frame being shown, the worker decodes the frames after it
+	int m_wanted;
+	// Guards the slot indices and m_wanted
+	std::mutex m_slotMutex;
+	// Wakes the worker when the wanted frame moves or the player is closing
+	std::condition_variable m_wakeWorker;
+	// Wakes the player when a frame has been decoded
+	std::condition_variable m_frameDecoded;
+
+	// The decode worker, running while m_running is true
+	std::thread m_thread;
+	std::atomic<bool> m_running;
+
+	// The playback clock in seconds from the first frame
+	double m_playTime;
+	float m_speed;
+	bool m_paused;
+	bool m_looping;
+
+	// The loop the worker thread runs until the player is closed
+	void WorkerLoop();
+public:
+	TrajectoryPlayer();
+	~TrajectoryPlayer();
+
+	/**
+	 * Maps a recording and starts the decode worker
+	 * @param _inputFile const std::string& The recording to play
+	 * @returns bool Returns false if the recording couldn't be read or has no frames
+	 */
+	bool Open(const std::string &_inputFile);
+
+	// Stops the decode worker and unmaps the recording
+	void Close();
+
+	/**
+	 * Moves the playback clock on
+	 * @param _deltaTime float The real time passed in seconds
+	 */
+	void Update(float _deltaTime);
+
+	/**
+	 * Gets the frame at the playback clock, waiting for it to be decoded if it isn't already
+	 * @returns TrajectoryFrame& The frame, valid until the next call
+	 */
+	TrajectoryFrame& GetFrame();
+
+	/**
+	 * Moves the playback clock, clamped to the recording
+	 * @param _seconds float How far to move in seconds, negative moves backwards
+	 */
+	void Seek(float _seconds);
+
+	/**
+	 * Moves the playback clock to a frame
+	 * @param _frame int The frame to move to, clamped to the recording
+	 */
+	void SeekToFrame(int _frame);
+
+	/**
+	 * Changes the play speed, clamped between MIN_SPEED and MAX_SPEED
+	 * @param _speed float The new play speed, 1 plays at the recorded rate
+	 */
+	void SetSpeed(float _speed);
+
+	void TogglePause() { m_paused = !m_paused; }
+	void ToggleLoop() { m_looping = !m_looping; }
+
+	// Getters
+	int GetFrameIndex() { return std::min((int)(m_playTime / m_fixedTimestep + 1e-6), m_frameCount - 1); }
+	int GetFrameCount() { return m_frameCount; }
+	float GetSpeed() { return m_speed; }
+	bool IsPaused() { return m_paused; }
+	bool IsLooping() { return m_looping; }
+	int GetWidth() { return m_reader.GetWidth(); }
+	int GetHeight() { return m_reader.GetHeight(); }
+};
+#endif // !_TRAJECTORYPLAYER_H_
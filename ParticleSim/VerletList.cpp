@@ -0,0 +1,287 @@
+#include "Stdafx.h"
+#include "VerletList.h"
+
+/**
+ * Constructs empty neighbour lists
+ * @param _jobs JobSystem* The job system to build and check the lists across
+ * @param _profiler FPSProfiler* The profiler used to count the pairs tested and the contacts found
+ * @param _skin float How far past touching a pair can be and still be listed, in pixels
+ */
+VerletList::VerletList(JobSystem* _jobs, FPSProfiler* _profiler, float _skin)
+{
+	m_jobs = _jobs;
+	m_profiler = _profiler;
+	m_skin = _skin;
+
+	m_store = nullptr;
+	m_generation = 0;
+	m_valid = false;
+	m_start.assign(1, 0);
+	m_builds = 0;
+}
+
+VerletList::~VerletList()
+{
+}
+
+/**
+ * Checks whether the lists still hold every pair that could touch
+ * @param _particles ParticleStore& The particles about to be solved
+ * @returns bool Returns false if the lists need building again
+ */
+bool VerletList::IsValid(ParticleStore &_particles)
+{
+	// Indices mean nothing once particles have been added, removed or reordered
+	if (!m_valid || &_particles != m_store || _particles.GetGeneration() != m_generation)
+	{
+		return false;
+	}
+
+	// Two particles that weren't listed have to close the whole skin between them before they can touch, which
+	// takes one of them moving at least half of it
+	float m_limit = m_skin * m_skin * 0.25f;
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	std::atomic<bool> m_moved(false);
+	m_jobs->ParallelFor(0, _particles.Size(), 4096, [&](int _begin, int _end)
+	{
+		// One particle is enough, so later jobs can skip their check
+		if (m_moved)
+		{
+			return;
+		}
+		for (int i = _begin; i < _end; i++)
+		{
+			float m_diffX = m_x[i] - m_buildX[i];
+			float m_diffY = m_y[i] - m_buildY[i];
+			if (m_diffX * m_diffX + m_diffY * m_diffY > m_limit)
+			{
+				m_moved = true;
+				return;
+			}
+		}
+	});
+
+	return !m_moved;
+}
+
+/**
+ * Remembers where every particle is and what the lists are being built from, and sizes the lists
+ * @param _particles ParticleStore& The particles the lists are being built for
+ * @returns int The amount of jobs the lists are gathered across
+ */
+int VerletList::BeginBuild(ParticleStore &_particles)
+{
+	int m_count = _particles.Size();
+	int m_chunks = (m_count + PARTICLES_PER_JOB - 1) / PARTICLES_PER_JOB;
+
+	m_buildX.assign(_particles.X(), _particles.X() + m_count);
+	m_buildY.assign(_particles.Y(), _particles.Y() + m_count);
+	m_owner.resize(m_count);
+	m_start.assign(m_count + 1, 0);
+	if ((int)m_chunkNeighbours.size() < m_chunks)
+	{
+		m_chunkNeighbours.resize(m_chunks);
+	}
+
+	m_store = &_particles;
+	m_generation = _particles.GetGeneration();
+	m_valid = true;
+	m_builds++;
+
+	return m_chunks;
+}
+
+// Joins the lists each job gathered into one array
+void VerletList::EndBuild()
+{
+	// Prefix sum the list lengths so each list knows where it starts, then copy the chunks into place
+	int m_count = (int)m_owner.size();
+	for (int k = 0; k < m_count; k++)
+	{
+		m_start[k + 1] += m_start[k];
+	}
+	m_neighbours.resize(m_start[m_count]);
+
+	int m_chunks = (m_count + PARTICLES_PER_JOB - 1) / PARTICLES_PER_JOB;
+	m_jobs->ParallelFor(0, m_chunks, 1, [&](int _begin, int _end)
+	{
+		for (int c = _begin; c < _end; c++)
+		{
+			std::copy(m_chunkNeighbours[c].begin(), m_chunkNeighbours[c].end(), m_neighbours.begin() + m_start[c * PARTICLES_PER_JOB]);
+		}
+	});
+}
+
+/**
+ * Builds every particle's list straight from the cells of a grid
+ * @param _particles ParticleStore& The particles to build the lists for
+ * @param _grid CellGrid& The grid holding every particle, built from their current positions
+ */
+void VerletList::Build(ParticleStore &_particles, CellGrid &_grid)
+{
+	int m_count = _particles.Size();
+	int m_chunks = BeginBuild(_particles);
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_radius = _particles.Radius();
+	int* m_cellStart = _grid.GetCellStart();
+	int* m_sortedIndices = _grid.GetSortedIndices();
+	int m_columns = _grid.GetColumns();
+	int m_rows = _grid.GetRows();
+
+	// How many cells away a pair within the skin of touching can be, at least the cells next to this one
+	float m_reachCells = ceilf((2.0f * _grid.GetMaxRadius() + m_skin) / _grid.GetCellSize());
+	int m_reach = (int)std::min(std::max(m_reachCells, 1.0f), (float)std::max(m_columns, m_rows));
+
+	// Walk the particles in the grid's order, each against the rest of its cell and the cells up to m_reach east of
+	// it on its own row, then the cells up to m_reach either side on the m_reach rows below. Each row of that is
+	// one run of the sorted index array, and every pair comes up exactly once
+	m_jobs->ParallelFor(0, m_chunks, 1, [&](int _begin, int _end)
+	{
+		CollisionCounts m_counts = { 0, 0, 0 };
+		for (int c = _begin; c < _end; c++)
+		{
+			std::vector<int> &m_list = m_chunkNeighbours[c];
+			m_list.clear();
+			for (int a = c * PARTICLES_PER_JOB; a < std::min((c + 1) * PARTICLES_PER_JOB, m_count); a++)
+			{
+				int i = m_sortedIndices[a];
+				m_owner[a] = i;
+
+				// The same cell the grid binned the particle into, so the runs line up with it
+				int m_column = _grid.CellColumn(m_x[i]);
+				int m_row = _grid.CellRow(m_y[i]);
+				int m_columnMin = std::max(m_column - m_reach, 0);
+				int m_columnMax = std::min(m_column + m_reach, m_columns - 1);
+				int m_rowMax = std::min(m_row + m_reach, m_rows - 1);
+
+				// Make room for every candidate up front
+				int m_ownRowEnd = m_cellStart[m_row * m_columns + m_columnMax + 1];
+				int m_candidates = m_ownRowEnd - a - 1;
+				for (int m_belowRow = m_row + 1; m_belowRow <= m_rowMax; m_belowRow++)
+				{
+					m_candidates += m_cellStart[m_belowRow * m_columns + m_columnMax + 1] - m_cellStart[m_belowRow * m_columns + m_columnMin];
+				}
+				m_counts.m_candidates += m_candidates;
+				size_t m_first = m_list.size();
+				m_list.resize(m_first + m_candidates);
+				int* m_out = m_list.data() + m_first;
+
+				// Then keep the ones within the skin of touching without a branch. Only about a third of them are,
+				// so a branch would mostly guess wrong
+				int m_kept = 0;
+				float m_xi = m_x[i], m_yi = m_y[i], m_reachi = m_radius[i] + m_skin;
+				for (int m_belowRow = m_row; m_belowRow <= m_rowMax; m_belowRow++)
+				{
+					int m_runBegin = (m_belowRow == m_row ? a + 1 : m_cellStart[m_belowRow * m_columns + m_columnMin]);
+					int m_runEnd = (m_belowRow == m_row ? m_ownRowEnd : m_cellStart[m_belowRow * m_columns + m_columnMax + 1]);
+					for (int b = m_runBegin; b < m_runEnd; b++)
+					{
+						int j = m_sortedIndices[b];
+						float m_touch = m_reachi + m_radius[j];
+						float m_diffX = m_xi - m_x[j];
+						float m_diffY = m_yi - m_y[j];
+						m_out[m_kept] = j;
+						m_kept += (m_diffX * m_diffX + m_diffY * m_diffY < m_touch * m_touch);
+					}
+				}
+				m_list.resize(m_first + m_kept);
+				m_start[a + 1] = m_kept;
+			}
+		}
+		m_profiler->AddCollisionCounts(m_counts);
+	});
+
+	EndBuild();
+}
+
+/**
+ * Builds every particle's list by sweeping the sorted boxes of a sweep and prune
+ * @param _particles ParticleStore& The particles to build the lists for
+ * @param _sweep SweepAndPrune& The sweep holding every particle, updated from their current positions
+ */
+void VerletList::Build(ParticleStore &_particles, SweepAndPrune &_sweep)
+{
+	int m_count = _particles.Size();
+	int m_chunks = BeginBuild(_particles);
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_radius = _particles.Radius();
+	const SweepAndPrune::Box* m_boxes = _sweep.GetBoxes();
+
+	// Walk the boxes in sweep order, each against the boxes after it that start within the skin of its right edge,
+	// so every pair comes up exactly once. Boxes without a position sit at the end and reach nothing
+	m_jobs->ParallelFor(0, m_chunks, 1, [&](int _begin, int _end)
+	{
+		CollisionCounts m_counts = { 0, 0, 0 };
+		for (int c = _begin; c < _end; c++)
+		{
+			std::vector<int> &m_list = m_chunkNeighbours[c];
+			m_list.clear();
+			for (int a = c * PARTICLES_PER_JOB; a < std::min((c + 1) * PARTICLES_PER_JOB, m_count); a++)
+			{
+				SweepAndPrune::Box m_box = m_boxes[a];
+				int i = m_box.m_index;
+				m_owner[a] = i;
+
+				int m_end = a + 1;
+				while (m_end < m_count && m_boxes[m_end].m_minX <= m_box.m_maxX + m_skin)
+				{
+					m_end++;
+				}
+				m_counts.m_candidates += m_end - a - 1;
+				size_t m_first = m_list.size();
+				m_list.resize(m_first + m_end - a - 1);
+				int* m_out = m_list.data() + m_first;
+
+				// Keep the boxes within the skin on y as well without a branch, reading only the boxes, then drop
+				// the few in the corners that are further than the skin from touching
+				int m_kept = 0;
+				for (int b = a + 1; b < m_end; b++)
+				{
+					m_out[m_kept] = m_boxes[b].m_index;
+					m_kept += (int)((m_boxes[b].m_minY <= m_box.m_maxY + m_skin) & (m_boxes[b].m_maxY >= m_box.m_minY - m_skin));
+				}
+				int m_listed = 0;
+				for (int k = 0; k < m_kept; k++)
+				{
+					int j = m_out[k];
+					float m_touch = m_radius[i] + m_radius[j] + m_skin;
+					float m_diffX = m_x[i] - m_x[j];
+					float m_diffY = m_y[i] - m_y[j];
+					m_out[m_listed] = j;
+					m_listed += (m_diffX * m_diffX + m_diffY * m_diffY < m_touch * m_touch);
+				}
+				m_list.resize(m_first + m_listed);
+				m_start[a + 1] = m_listed;
+			}
+		}
+		m_profiler->AddCollisionCounts(m_counts);
+	});
+
+	EndBuild();
+}
+
+/**
+ * Runs the collision pass over every listed pair, in the order the lists were built
+ * @param _particles ParticleStore& The particles to solve, the same ones the lists were built from
+ */
+void VerletList::Solve(ParticleStore &_particles)
+{
+	// A response writes to both particles and any particle can be in any list, so the walk runs on one thread
+	CollisionCounts m_counts = { 0, 0, 0 };
+	for (unsigned int k = 0; k < m_owner.size(); k++)
+	{
+		int i = m_owner[k];
+		for (int n = m_start[k]; n < m_start[k + 1]; n++)
+		{
+			if (_particles.CheckCollision(i, m_neighbours[n]))
+			{
+				m_counts.m_contacts++;
+			}
+		}
+	}
+	m_counts.m_distanceTests = (long long)m_neighbours.size();
+	m_profiler->AddCollisionCounts(m_counts);
+}
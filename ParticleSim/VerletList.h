@@ -0,0 +1,174 @@
+#ifndef _VERLETLIST_H_
+#define _VERLETLIST_H_
+/**
+ * Caches the neighbours of every particle across steps. Each particle keeps a list of the particles that were within
+ * touching distance plus a skin when the lists were built, with every pair listed from one side only, so a pair that
+ * isn't listed can't touch until one of the two has moved more than half the skin. Until then the collision pass is a
+ * walk over the cached indices and the broad phase doesn't need building at all. Lists are stored back to back with
+ * a start offset and owning particle per list, and are rebuilt when any particle has moved more than half the skin
+ * or the store has added, removed or reordered particles since the lists were built.
+ *
+ * A CellGrid is walked directly with a half stencil widened to the skin, in cell order, so the lists come out
+ * sorted by cell. A SweepAndPrune is swept again with every box widened by the skin, in the order of its boxes. A
+ * SparseHashGrid is searched once per particle in index order.
+ */
+class VerletList
+{
+private:
+	// The amount of particles handed to a job at once
+	static const int PARTICLES_PER_JOB = 1024;
+
+	// The job system the lists are built and checked across
+	JobSystem* m_jobs;
+	// Our profiler, used to count the pairs tested and the contacts found
+	FPSProfiler* m_profiler;
+	// How far past touching a pair can be and still be listed
+	float m_skin;
+
+	// The store the lists were built from and its generation at the time, lists are stale if either changes
+	ParticleStore* m_store;
+	unsigned int m_generation;
+	// Cleared when something outside the store makes the lists stale
+	bool m_valid;
+	// Where every particle was when the lists were built
+	std::vector<float> m_buildX, m_buildY;
+
+	// The particle each list belongs to
+	std::vector<int> m_owner;
+	// Start offset of each list, with an extra entry so the last list has an end
+	std::vector<int> m_start;
+	// Every list back to back
+	std::vector<int> m_neighbours;
+	// The lists gathered by each job while building, kept to reuse their memory
+	std::vector<std::vector<int>> m_chunkNeighbours;
+
+	// The amount of times the lists have been built
+	int m_builds;
+
+	/**
+	 * Remembers where every particle is and what the lists are being built from, and sizes the lists
+	 * @param _particles ParticleStore& The particles the lists are being built for
+	 * @returns int The amount of jobs the lists are gathered across
+	 */
+	int BeginBuild(ParticleStore &_particles);
+
+	// Joins the lists each job gathered into one array
+	void EndBuild();
+public:
+	/**
+	 * Constructs empty neighbour lists
+	 * @param _jobs JobSystem* The job system to build and check the lists across
+	 * @param _profiler FPSProfiler* The profiler used to count the pairs tested and the contacts found
+	 * @param _skin float How far past touching a pair can be and still be listed, in pixels
+	 */
+	VerletList(JobSystem* _jobs, FPSProfiler* _profiler, float _skin);
+	~VerletList();
+
+	/**
+	 * Checks whether the lists still hold every pair that could touch
+	 * @param _particles ParticleStore& The particles about to be solved
+	 * @returns bool Returns false if the lists need building again
+	 */
+	bool IsValid(ParticleStore &_particles);
+
+	/**
+	 * Builds every particle's list from a broad phase
+	 * @param _particles ParticleStore& The particles to build the lists for
+	 * @param _broadPhase TBroadPhase& The broad phase holding every particle, built from their current positions.
+	 *                    Anything with a ForEachNeighbour(glm::vec2, float, Function) query that finds every
+	 *                    particle within the radius can be used
+	 */
+	template <class TBroadPhase>
+	void Build(ParticleStore &_particles, TBroadPhase &_broadPhase);
+
+	/**
+	 * Builds every particle's list straight from the cells of a grid
+	 * @param _particles ParticleStore& The particles to build the lists for
+	 * @param _grid CellGrid& The grid holding every particle, built from their current positions
+	 */
+	void Build(ParticleStore &_particles, CellGrid &_grid);
+
+	/**
+	 * Builds every particle's list by sweeping the sorted boxes of a sweep and prune
+	 * @param _particles ParticleStore& The particles to build the lists for
+	 * @param _sweep SweepAndPrune& The sweep holding every particle, updated from their current positions
+	 */
+	void Build(ParticleStore &_particles, SweepAndPrune &_sweep);
+
+	/**
+	 * Runs the collision pass over every listed pair, in the order the lists were built
+	 * @param _particles ParticleStore& The particles to solve, the same ones the lists were built from
+	 */
+	void Solve(ParticleStore &_particles);
+
+	// Marks the lists as stale, for when the store is replaced
+	void Invalidate() { m_valid = false; }
+
+	// Getters
+	float GetSkin() { return m_skin; }
+	int GetBuilds() { return m_builds; }
+	int GetPairs() { return (int)m_neighbours.size(); }
+};
+
+/**
+ * Builds every particle's list from a broad phase
+ * @param _particles ParticleStore& The particles to build the lists for
+ * @param _broadPhase TBroadPhase& The broad phase holding every particle, built from their current positions
+ */
+template <class TBroadPhase>
+void VerletList::Build(ParticleStore &_particles, TBroadPhase &_broadPhase)
+{
+	int m_count = _particles.Size();
+	int m_chunks = BeginBuild(_particles);
+	float* m_x = _particles.X();
+	float* m_y = _particles.Y();
+	float* m_radius = _particles.Radius();
+
+	// Gather each chunk's lists on their own, the broad phase is only read
+	m_jobs->ParallelFor(0, m_chunks, 1, [&](int _begin, int _end)
+	{
+		CollisionCounts m_counts = { 0, 0, 0 };
+		for (int c = _begin; c < _end; c++)
+		{
+			std::vector<int> &m_list = m_chunkNeighbours[c];
+			m_list.clear();
+			for (int i = c * PARTICLES_PER_JOB; i < std::min((c + 1) * PARTICLES_PER_JOB, m_count); i++)
+			{
+				m_owner[i] = i;
+
+				// A particle without a position can't touch anything
+				if (!std::isfinite(m_x[i]) || !std::isfinite(m_y[i]))
+				{
+					continue;
+				}
+
+				size_t m_first = m_list.size();
+				_broadPhase.ForEachNeighbour(glm::vec2(m_x[i], m_y[i]), m_radius[i] + m_skin, [&](int _neighbour)
+				{
+					m_counts.m_candidates++;
+					// Each pair is listed from the later particle only, and only if it is within the skin of touching
+					if (_neighbour < i)
+					{
+						float m_reach = m_radius[i] + m_radius[_neighbour] + m_skin;
+						float m_diffX = m_x[i] - m_x[_neighbour];
+						float m_diffY = m_y[i] - m_y[_neighbour];
+						if (m_diffX * m_diffX + m_diffY * m_diffY < m_reach * m_reach)
+						{
+							m_list.push_back(_neighbour);
+						}
+					}
+				});
+
+				// Broad phases can hand a neighbour over more than once and in any order, so sort the list and drop
+				// repeats, which also keeps the order pairs are solved in the same whatever the broad phase
+				std::sort(m_list.begin() + m_first, m_list.end());
+				m_list.erase(std::unique(m_list.begin() + m_first, m_list.end()), m_list.end());
+				m_start[i + 1] = (int)(m_list.size() - m_first);
+			}
+		}
+		m_profiler->AddCollisionCounts(m_counts);
+	});
+
+	EndBuild();
+}
+#endif // !_VERLETLIST_H_
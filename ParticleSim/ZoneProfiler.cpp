@@ -0,0 +1,312 @@
+#include "Stdafx.h"
+#include "ZoneProfiler.h"
+
+ZoneHistogram::ZoneHistogram()
+{
+	Clear();
+}
+
+ZoneHistogram::~ZoneHistogram()
+{
+}
+
+/**
+ * Finds the bucket a duration belongs in
+ * @param _ns long long The duration in nanoseconds
+ * @returns int The index of the bucket
+ */
+int ZoneHistogram::BucketIndex(long long _ns)
+{
+	if (_ns < LINEAR_BUCKETS)
+	{
+		return _ns < 0 ? 0 : (int)_ns;
+	}
+
+	// Find the highest set bit, at least 5 as we are past the linear buckets
+	int m_exponent = 5;
+	while (m_exponent < 40 && (_ns >> (m_exponent + 1)) != 0)
+	{
+		m_exponent++;
+	}
+
+	// The next 4 bits pick the bucket within this power of two
+	int m_subBucket = (int)(_ns >> (m_exponent - 4)) & (SUB_BUCKETS - 1);
+	return std::min(LINEAR_BUCKETS + (m_exponent - 5) * SUB_BUCKETS + m_subBucket, BUCKET_COUNT - 1);
+}
+
+/**
+ * Finds the duration in the middle of a bucket
+ * @param _bucket int The index of the bucket
+ * @returns long long The duration in nanoseconds
+ */
+long long ZoneHistogram::BucketValue(int _bucket)
+{
+	if (_bucket < LINEAR_BUCKETS)
+	{
+		return _bucket;
+	}
+
+	int m_exponent = 5 + (_bucket - LINEAR_BUCKETS) / SUB_BUCKETS;
+	int m_subBucket = (_bucket - LINEAR_BUCKETS) % SUB_BUCKETS;
+	long long m_width = 1LL << (m_exponent - 4);
+	return (SUB_BUCKETS + m_subBucket) * m_width + m_width / 2;
+}
+
+/**
+ * Adds a duration to the histogram
+ * @param _ns long long The duration in nanoseconds
+ */
+void ZoneHistogram::Add(long long _ns)
+{
+	m_buckets[BucketIndex(_ns)]++;
+	m_count++;
+	m_totalNs += _ns;
+
+	// Only swap in a larger max
+	long long m_max = m_maxNs;
+	while (_ns > m_max && !m_maxNs.compare_exchange_weak(m_max, _ns))
+	{
+	}
+}
+
+// Empties the histogram
+void ZoneHistogram::Clear()
+{
+	for (int i = 0; i < BUCKET_COUNT; i++)
+	{
+		m_buckets[i] = 0;
+	}
+	m_count = 0;
+	m_totalNs = 0;
+	m_maxNs = 0;
+}
+
+/**
+ * Finds the duration a fraction of the added durations are at or below
+ * @param _fraction float The fraction, eg: 0.95 for the 95th percentile
+ * @returns long long The duration in nanoseconds, 0 if the histogram is empty
+ */
+long long ZoneHistogram::GetPercentile(float _fraction)
+{
+	long long m_added = m_count;
+	if (m_added == 0)
+	{
+		return 0;
+	}
+
+	// The rank we are looking for, at least the first duration
+	long long m_rank = std::max((long long)ceil(_fraction * m_added), 1LL);
+	long long m_seen = 0;
+	for (int i = 0; i < BUCKET_COUNT; i++)
+	{
+		m_seen += m_buckets[i];
+		if (m_seen >= m_rank)
+		{
+			// Never report more than the largest duration actually seen
+			return std::min(BucketValue(i), (long long)m_maxNs);
+		}
+	}
+
+	return m_maxNs;
+}
+
+// The innermost zone open on this thread
+thread_local int ZoneProfiler::s_currentZone = -1;
+
+ZoneProfiler::ZoneProfiler()
+{
+	m_zones.reset(new Zone[MAX_ZONES]);
+	m_zoneCount = 0;
+	m_trace = nullptr;
+
+	m_nsPerTick = 1e9 / (double)SDL_GetPerformanceFrequency();
+	m_lastReport = SDL_GetPerformanceCounter();
+}
+
+ZoneProfiler::~ZoneProfiler()
+{
+}
+
+/**
+ * Finds a zone by name under a parent, creating it the first time it is seen
+ * @param _parent int The index of the parent zone, -1 for a root
+ * @param _name const char* The name of the zone
+ * @returns int The index of the zone, -1 if the tree is full
+ */
+int ZoneProfiler::FindZone(int _parent, const char* _name)
+{
+	std::lock_guard<std::mutex> m_lock(m_zoneMutex);
+
+	std::vector<int> &m_siblings = (_parent < 0 ? m_roots : m_zones[_parent].m_children);
+	for (unsigned int i = 0; i < m_siblings.size(); i++)
+	{
+		// Names are usually the same literal, only compare the text when they aren't
+		const char* m_name = m_zones[m_siblings[i]].m_name;
+		if (m_name == _name || strcmp(m_name, _name) == 0)
+		{
+			return m_siblings[i];
+		}
+	}
+
+	if (m_zoneCount == MAX_ZONES)
+	{
+		return -1;
+	}
+
+	// First time this zone has been opened here, add it to the tree
+	int m_zone = m_zoneCount++;
+	m_zones[m_zone].m_name = _name;
+	m_zones[m_zone].m_parent = _parent;
+	m_zones[m_zone].m_depth = (_parent < 0 ? 0 : m_zones[_parent].m_depth + 1);
+	m_siblings.push_back(m_zone);
+
+	return m_zone;
+}
+
+/**
+ * Records a closed zone
+ * @param _zone int The index of the zone
+ * @param _start Uint64 When the zone was opened in performance counter ticks
+ * @param _end Uint64 When the zone was closed in performance counter ticks
+ */
+void ZoneProfiler::AddSample(int _zone, Uint64 _start, Uint64 _end)
+{
+	if (_zone < 0)
+	{
+		return;
+	}
+
+	long long m_ns = (long long)((_end - _start) * m_nsPerTick);
+	m_zones[_zone].m_run.Add(m_ns);
+	m_zones[_zone].m_window.Add(m_ns);
+
+	if (m_trace != nullptr)
+	{
+		m_trace->AddZone(m_zones[_zone].m_name, _start, _end);
+	}
+}
+
+// Rebuilds the report of the last second once a second has passed. Called once per frame
+void ZoneProfiler::Update()
+{
+	Uint64 m_now = SDL_GetPerformanceCounter();
+	if (m_now - m_lastReport < SDL_GetPerformanceFrequency())
+	{
+		return;
+	}
+	m_lastReport = m_now;
+
+	std::lock_guard<std::mutex> m_lock(m_zoneMutex);
+
+	m_report.clear();
+	for (unsigned int i = 0; i < m_roots.size(); i++)
+	{
+		BuildReport(m_roots[i], true, m_report);
+	}
+
+	// Start the next second from empty
+	for (int i = 0; i < m_zoneCount; i++)
+	{
+		m_zones[i].m_window.Clear();
+	}
+}
+
+/**
+ * Adds a zone and its children to a report, depth first
+ * @param _zone int The index of the zone
+ * @param _window bool Reports the last second when true, the whole run when false
+ * @param _report std::vector<ZoneReport>& The report to add to
+ */
+void ZoneProfiler::BuildReport(int _zone, bool _window, std::vector<ZoneReport> &_report)
+{
+	Zone &m_zone = m_zones[_zone];
+	ZoneHistogram &m_histogram = (_window ? m_zone.m_window : m_zone.m_run);
+
+	ZoneReport m_line;
+	m_line.m_name = m_zone.m_name;
+	m_line.m_depth = m_zone.m_depth;
+	m_line.m_calls = m_histogram.GetCount();
+	m_line.m_total = m_histogram.GetTotal() / 1e6;
+	m_line.m_mean = (m_line.m_calls > 0 ? m_line.m_total / m_line.m_calls : 0.0);
+	m_line.m_p50 = m_histogram.GetPercentile(0.50f) / 1e6;
+	m_line.m_p95 = m_histogram.GetPercentile(0.95f) / 1e6;
+	m_line.m_p99 = m_histogram.GetPercentile(0.99f) / 1e6;
+	m_line.m_max = m_histogram.GetMax() / 1e6;
+	_report.push_back(m_line);
+
+	for (unsigned int i = 0; i < m_zone.m_children.size(); i++)
+	{
+		BuildReport(m_zone.m_children[i], _window, _report);
+	}
+}
+
+/**
+ * Writes every zone's timings for the whole run to a file
+ * @param _outputFile const std::string& The file to write to
+ */
+void ZoneProfiler::Export(const std::string &_outputFile)
+{
+	std::vector<ZoneReport> m_report;
+	{
+		std::lock_guard<std::mutex> m_lock(m_zoneMutex);
+		for (unsigned int i = 0; i < m_roots.size(); i++)
+		{
+			BuildReport(m_roots[i], false, m_report);
+		}
+	}
+
+	std::ofstream m_output(_outputFile, std::ios::out | std::ios::trunc);
+	if (m_output.is_open())
+	{
+		m_output << "== Zone Profile ==\n";
+		m_output << "Times are in milliseconds, child zones are indented under their parent\n\n";
+		m_output << std::setfill(' ') << std::left << std::setw(32) << "Zone" << std::setw(12) << "Calls" << std::setw(14) << "Total"
+			<< std::setw(12) << "Mean" << std::setw(12) << "p50" << std::setw(12) << "p95" << std::setw(12) << "p99" << std::setw(12) << "Max" << "\n";
+
+		for (unsigned int i = 0; i < m_report.size(); i++)
+		{
+			const ZoneReport &m_line = m_report[i];
+			m_output << std::left << std::setw(32) << (std::string(m_line.m_depth * 2, ' ') + m_line.m_name) << std::setw(12) << m_line.m_calls
+				<< std::setw(14) << m_line.m_total << std::setw(12) << m_line.m_mean << std::setw(12) << m_line.m_p50
+				<< std::setw(12) << m_line.m_p95 << std::setw(12) << m_line.m_p99 << std::setw(12) << m_line.m_max << "\n";
+		}
+		m_output.close();
+	}
+	else
+	{
+		std::cerr << "Failed to open output file for the zone profile\n";
+	}
+}
+
+/* STATIC IMPLEMENTS */
+// The one zone profiler every ScopedZone records into
+ZoneProfiler* ZoneProfiler::s_instance = nullptr;
+
+// Returns the zone profiler, making it the first time it is needed
+ZoneProfiler* ZoneProfiler::Instance()
+{
+	if (s_instance == nullptr)
+	{
+		s_instance = new ZoneProfiler();
+	}
+
+	return s_instance;
+}
+
+/**
+ * Opens a zone inside whichever zone is open on this thread
+ * @param _name const char* The name of the zone, has to be a string literal
+ */
+ScopedZone::ScopedZone(const char* _name)
+{
+	m_parent = ZoneProfiler::GetCurrentZone();
+	m_zone = ZoneProfiler::Instance()->FindZone(m_parent, _name);
+	ZoneProfiler::SetCurrentZone(m_zone < 0 ? m_parent : m_zone);
+	m_start = SDL_GetPerformanceCounter();
+}
+
+ScopedZone::~ScopedZone()
+{
+	ZoneProfiler::Instance()->AddSample(m_zone, m_start, SDL_GetPerformanceCounter());
+	ZoneProfiler::SetCurrentZone(m_parent);
+}
@@ -0,0 +1,202 @@
+#ifndef _ZONEPROFILER_H_
+#define _ZONEPROFILER_H_
+
+/**
+ * A histogram of durations in nanoseconds. Durations under 32ns get a bucket each, above that every power of
+ * two is split into 16 buckets, so a percentile read back is within about 6% of the real value. Adding is
+ * lock free so several threads can record into the same histogram.
+ */
+class ZoneHistogram
+{
+private:
+	static const int LINEAR_BUCKETS = 32;
+	static const int SUB_BUCKETS = 16;
+	// Enough buckets for durations up to 2^41ns, around 36 minutes
+	static const int BUCKET_COUNT = LINEAR_BUCKETS + 36 * SUB_BUCKETS;
+
+	// The amount of durations in each bucket
+	std::atomic<unsigned int> m_buckets[BUCKET_COUNT];
+	// The amount of durations added
+	std::atomic<long long> m_count;
+	// The sum and largest of the durations added
+	std::atomic<long long> m_totalNs;
+	std::atomic<long long> m_maxNs;
+
+	/**
+	 * Finds the bucket a duration belongs in
+	 * @param _ns long long The duration in nanoseconds
+	 * @returns int The index of the bucket
+	 */
+	static int BucketIndex(long long _ns);
+
+	/**
+	 * Finds the duration in the middle of a bucket
+	 * @param _bucket int The index of the bucket
+	 * @returns long long The duration in nanoseconds
+	 */
+	static long long BucketValue(int _bucket);
+public:
+	ZoneHistogram();
+	~ZoneHistogram();
+
+	/**
+	 * Adds a duration to the histogram
+	 * @param _ns long long The duration in nanoseconds
+	 */
+	void Add(long long _ns);
+
+	// Empties the histogram
+	void Clear();
+
+	/**
+	 * Finds the duration a fraction of the added durations are at or below
+	 * @param _fraction float The fraction, eg: 0.95 for the 95th percentile
+	 * @returns long long The duration in nanoseconds, 0 if the histogram is empty
+	 */
+	long long GetPercentile(float _fraction);
+
+	// Getters
+	long long GetCount() { return m_count; }
+	long long GetTotal() { return m_totalNs; }
+	long long GetMax() { return m_maxNs; }
+};
+
+// A summary of one zone, in milliseconds
+struct ZoneReport
+{
+	std::string m_name;
+	int m_depth;
+	long long m_calls;
+	double m_total;
+	double m_mean;
+	double m_p50;
+	double m_p95;
+	double m_p99;
+	double m_max;
+};
+
+/**
+ * Collects timings from ScopedZones into a tree of zones. A zone opened while another is open on the same
+ * thread becomes its child, and jobs carry the zone they were queued from so zones opened inside a job land in
+ * the same place in the tree whichever thread runs it. Every zone keeps a histogram for the whole run and one
+ * for the last second, which is what the overlay shows.
+ */
+class ZoneProfiler
+{
+private:
+	// The most zones the tree can hold. Zones are created on first use and never removed
+	static const int MAX_ZONES = 256;
+
+	// A node in the zone tree
+	struct Zone
+	{
+		// The name of the zone, zone names are string literals
+		const char* m_name;
+		// The index of the parent zone, -1 for a root
+		int m_parent;
+		// How deep the zone is in the tree, 0 for a root
+		int m_depth;
+		// The zones opened inside this one
+		std::vector<int> m_children;
+		// Every duration recorded this run
+		ZoneHistogram m_run;
+		// The durations recorded since the last report
+		ZoneHistogram m_window;
+	};
+
+	// Every zone in the tree, allocated up front so zones can be read without a lock while others are created
+	std::unique_ptr<Zone[]> m_zones;
+	// The amount of zones created
+	int m_zoneCount;
+	// The zones without a parent
+	std::vector<int> m_roots;
+	// Guards creating zones
+	std::mutex m_zoneMutex;
+
+	// Converts performance counter ticks to nanoseconds
+	double m_nsPerTick;
+	// When the last report was made, in performance counter ticks
+	Uint64 m_lastReport;
+	// The last second of every zone, updated by Update
+	std::vector<ZoneReport> m_report;
+	// Streams every zone to a trace file when set
+	TraceWriter* m_trace;
+
+	// The innermost zone open on this thread, -1 when none are
+	static thread_local int s_currentZone;
+
+	/**
+	 * Adds a zone and its children to a report, depth first
+	 * @param _zone int The index of the zone
+	 * @param _window bool Reports the last second when true, the whole run when false
+	 * @param _report std::vector<ZoneReport>& The report to add to
+	 */
+	void BuildReport(int _zone, bool _window, std::vector<ZoneReport> &_report);
+
+	/* STATIC MEMBERS */
+	static ZoneProfiler* s_instance;
+public:
+	ZoneProfiler();
+	~ZoneProfiler();
+
+	/**
+	 * Finds a zone by name under a parent, creating it the first time it is seen
+	 * @param _parent int The index of the parent zone, -1 for a root
+	 * @param _name const char* The name of the zone
+	 * @returns int The index of the zone, -1 if the tree is full
+	 */
+	int FindZone(int _parent, const char* _name);
+
+	/**
+	 * Records a closed zone
+	 * @param _zone int The index of the zone
+	 * @param _start Uint64 When the zone was opened in performance counter ticks
+	 * @param _end Uint64 When the zone was closed in performance counter ticks
+	 */
+	void AddSample(int _zone, Uint64 _start, Uint64 _end);
+
+	// Rebuilds the report of the last second once a second has passed. Called once per frame
+	void Update();
+
+	/**
+	 * Writes every zone's timings for the whole run to a file
+	 * @param _outputFile const std::string& The file to write to
+	 */
+	void Export(const std::string &_outputFile);
+
+	// Setters
+	// Streams every zone closed from now on to a trace, nullptr to stop. Set it while no zones are being recorded
+	void SetTrace(TraceWriter* _trace) { m_trace = _trace; }
+
+	// Getters
+	const std::vector<ZoneReport>& GetReport() { return m_report; }
+
+	// The innermost zone open on the calling thread, used by the job system to carry zones into jobs
+	static int GetCurrentZone() { return s_currentZone; }
+	static void SetCurrentZone(int _zone) { s_currentZone = _zone; }
+
+	/* STATIC METHODS*/
+	static ZoneProfiler* Instance();
+};
+
+/**
+ * Times the scope it lives in as a zone, eg: ScopedZone m_zone("Collision");
+ */
+class ScopedZone
+{
+private:
+	// The zone being timed
+	int m_zone;
+	// The zone that was open before this one
+	int m_parent;
+	// When the zone was opened, in performance counter ticks
+	Uint64 m_start;
+public:
+	/**
+	 * Opens a zone inside whichever zone is open on this thread
+	 * @param _name const char* The name of the zone, has to be a string literal
+	 */
+	ScopedZone(const char* _name);
+	~ScopedZone();
+};
+#endif // !_ZONEPROFILER_H_
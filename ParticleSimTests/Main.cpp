@@ -0,0 +1,341 @@
+#include "Stdafx.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Checks for the parts of the simulation that don't need a window. Every test prints whether it passed, and the run
+ * returns an error if any of them failed
+ */
+
+// Checks particle ids and indices stay consistent as particles are removed by id and added again
+static bool TestStableIds()
+{
+	// Each particle's x is its id, so the data can be checked to have moved with the id
+	ParticleStore m_store(1280, 768, 500.0f, nullptr);
+	const int m_count = 64;
+	for (int i = 0; i < m_count; i++)
+	{
+		m_store.Add(glm::vec2((float)i, 0.0f), glm::vec2(0, 0), glm::vec2(0, 0), glm::vec3(255, 255, 255), 1.0f);
+	}
+
+	// The first particle, the last one, which has nothing to swap in, then every third id and a few already gone
+	std::vector<int> m_removals = { 0, m_count - 1 };
+	for (int i = 1; i < m_count; i += 3)
+	{
+		m_removals.push_back(i);
+	}
+	m_removals.push_back(0);
+	m_removals.push_back(m_count);
+	std::vector<bool> m_live(m_count, true);
+	for (unsigned int k = 0; k < m_removals.size(); k++)
+	{
+		int m_id = m_removals[k];
+		bool m_wasLive = (m_id < m_count && m_live[m_id]);
+		if (m_store.RemoveById(m_id) != m_wasLive || m_store.IndexOf(m_id) != -1 || !m_store.CheckIds())
+		{
+			std::cerr << "Removing particle " << m_id << " left the ids inconsistent\n";
+			return false;
+		}
+		if (m_wasLive)
+		{
+			m_live[m_id] = false;
+		}
+
+		for (int i = 0; i < m_count; i++)
+		{
+			if (m_live[i] && m_store.X()[m_store.IndexOf(i)] != (float)i)
+			{
+				std::cerr << "Particle " << i << " lost its data when particle " << m_id << " was removed\n";
+				return false;
+			}
+		}
+	}
+
+	// New particles reuse the freed ids and land at the end
+	int m_size = m_store.Size();
+	for (int i = 0; i < 8; i++)
+	{
+		int m_id = m_store.Add(glm::vec2(0, 0), glm::vec2(0, 0), glm::vec2(0, 0), glm::vec3(255, 255, 255), 1.0f);
+		if (m_id >= m_count || m_store.IndexOf(m_id) != m_size + i || !m_store.CheckIds())
+		{
+			std::cerr << "Adding a particle after removals gave it id " << m_id << " at index " << m_store.IndexOf(m_id) << "\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Checks removing a count from the end of the store keeps the ids consistent, and that removing nothing or a negative
+// amount leaves the store alone
+static bool TestRemoveCount()
+{
+	ParticleStore m_store(1280, 768, 500.0f, nullptr);
+	for (int i = 0; i < 16; i++)
+	{
+		m_store.Add(glm::vec2((float)i, 0.0f), glm::vec2(0, 0), glm::vec2(0, 0), glm::vec3(255, 255, 255), 1.0f);
+	}
+
+	const int m_amounts[] = { 0, -5, 4, 100 };
+	const int m_sizes[] = { 16, 16, 12, 0 };
+	for (int k = 0; k < 4; k++)
+	{
+		unsigned int m_generation = m_store.GetGeneration();
+		m_store.Remove(m_amounts[k]);
+		if (m_store.Size() != m_sizes[k] || !m_store.CheckIds())
+		{
+			std::cerr << "Removing " << m_amounts[k] << " particles left " << m_store.Size() << " with the ids inconsistent\n";
+			return false;
+		}
+		if (m_amounts[k] <= 0 && m_store.GetGeneration() != m_generation)
+		{
+			std::cerr << "Removing " << m_amounts[k] << " particles changed the store\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// The settings the snapshot resume test runs with, reordering often enough that a reorder falls before the save and
+// another after it
+static const char* RESUME_SETTINGS = R"({
+  "BoundedWorld": true,
+  "BroadPhase": "CellGrid",
+  "CellSize": 0,
+  "FixedTimestep": 0.0166667,
+  "MaxParticleRadius": 1,
+  "ParticleCount": 2000,
+  "ReorderInterval": 25,
+  "ReorderLocality": 0.5,
+  "SubSteps": 1,
+  "ThreadCount": 0,
+  "TreeMargin": 1,
+  "VerletSkin": 0,
+  "WindowHeight": 768,
+  "WindowWidth": 1280
+})";
+
+// Makes a new folder in the system's temporary folder under a name no other run is using, returning "" on failure
+static std::string MakeTempFolder()
+{
+#ifdef _WIN32
+	char m_base[MAX_PATH];
+	if (GetTempPathA(MAX_PATH, m_base) == 0)
+	{
+		return "";
+	}
+	for (int k = 0; k < 100; k++)
+	{
+		std::string m_path = std::string(m_base) + "ParticleSimTests-" + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(k);
+		if (CreateDirectoryA(m_path.c_str(), nullptr))
+		{
+			return m_path;
+		}
+	}
+	return "";
+#else
+	const char* m_base = getenv("TMPDIR");
+	std::string m_template = std::string((m_base != nullptr && m_base[0] != '\0') ? m_base : "/tmp") + "/ParticleSimTests-XXXXXX";
+	std::vector<char> m_path(m_template.begin(), m_template.end());
+	m_path.push_back('\0');
+	return (mkdtemp(m_path.data()) != nullptr ? std::string(m_path.data()) : "");
+#endif
+}
+
+// Makes a folder inside one made by MakeTempFolder
+static bool MakeFolder(const std::string &_path)
+{
+#ifdef _WIN32
+	return (CreateDirectoryA(_path.c_str(), nullptr) != 0);
+#else
+	return (mkdir(_path.c_str(), 0700) == 0);
+#endif
+}
+
+// Deletes a folder along with everything in it
+static void DeleteFolder(const std::string &_path)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATAA m_entry;
+	HANDLE m_find = FindFirstFileA((_path + "\\*").c_str(), &m_entry);
+	if (m_find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			std::string m_name = m_entry.cFileName;
+			if (m_name == "." || m_name == "..")
+			{
+				continue;
+			}
+			std::string m_child = _path + "\\" + m_name;
+			if (m_entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				DeleteFolder(m_child);
+			}
+			else
+			{
+				DeleteFileA(m_child.c_str());
+			}
+		} while (FindNextFileA(m_find, &m_entry));
+		FindClose(m_find);
+	}
+	RemoveDirectoryA(_path.c_str());
+#else
+	DIR* m_folder = opendir(_path.c_str());
+	if (m_folder != nullptr)
+	{
+		while (dirent* m_entry = readdir(m_folder))
+		{
+			std::string m_name = m_entry->d_name;
+			if (m_name == "." || m_name == "..")
+			{
+				continue;
+			}
+			std::string m_child = _path + "/" + m_name;
+			struct stat m_info;
+			if (lstat(m_child.c_str(), &m_info) == 0 && S_ISDIR(m_info.st_mode))
+			{
+				DeleteFolder(m_child);
+			}
+			else
+			{
+				unlink(m_child.c_str());
+			}
+		}
+		closedir(m_folder);
+	}
+	rmdir(_path.c_str());
+#endif
+}
+
+// Gets the working directory, or "" if it couldn't be read
+static std::string GetWorkingFolder()
+{
+#ifdef _WIN32
+	char m_path[MAX_PATH];
+	return (GetCurrentDirectoryA(MAX_PATH, m_path) != 0 ? std::string(m_path) : "");
+#else
+	char m_path[4096];
+	return (getcwd(m_path, sizeof(m_path)) != nullptr ? std::string(m_path) : "");
+#endif
+}
+
+// Changes the working directory, the application reads its settings from and writes its profiles to there
+static bool SetWorkingFolder(const std::string &_path)
+{
+#ifdef _WIN32
+	return (SetCurrentDirectoryA(_path.c_str()) != 0);
+#else
+	return (chdir(_path.c_str()) == 0);
+#endif
+}
+
+// Runs a fresh application through to its exit with the given command line options, as the program would
+static bool RunApplication(std::vector<std::string> _options)
+{
+	std::string m_program = "ParticleSim";
+	std::vector<char*> m_argv = { &m_program[0] };
+	for (std::string &m_option : _options)
+	{
+		m_argv.push_back(&m_option[0]);
+	}
+
+	Application m_application;
+	return m_application.ParseArguments((int)m_argv.size(), m_argv.data()) && m_application.Run();
+}
+
+// Checks a run saved to a snapshot and loaded again in a new application carries on exactly as a run that never
+// stopped. Everything runs in a temporary folder that is deleted afterwards
+static bool TestSnapshotResume()
+{
+	std::string m_folder = MakeTempFolder();
+	std::string m_home = GetWorkingFolder();
+	if (m_folder.empty() || m_home.empty())
+	{
+		std::cerr << "Couldn't make a temporary folder to run in\n";
+		return false;
+	}
+	std::ofstream m_settings(m_folder + "/settings.json");
+	m_settings << RESUME_SETTINGS;
+	m_settings.close();
+
+	bool m_ran = MakeFolder(m_folder + "/FPS_Profile") && SetWorkingFolder(m_folder);
+	m_ran = m_ran && RunApplication({ "--headless", "--steps", "80", "--save-snapshot", "straight.snapshot" });
+	m_ran = m_ran && RunApplication({ "--headless", "--steps", "40", "--save-snapshot", "half.snapshot" });
+	m_ran = m_ran && RunApplication({ "--headless", "--steps", "40", "--load-snapshot", "half.snapshot",
+		"--save-snapshot", "resumed.snapshot" });
+	SetWorkingFolder(m_home);
+
+	ParticleStore m_straight(1280, 768, 500.0f, nullptr), m_resumed(1280, 768, 500.0f, nullptr);
+	SnapshotState m_straightState, m_resumedState;
+	m_ran = m_ran && Snapshot::Load(m_folder + "/straight.snapshot", m_straight, m_straightState)
+		&& Snapshot::Load(m_folder + "/resumed.snapshot", m_resumed, m_resumedState);
+	DeleteFolder(m_folder);
+	if (!m_ran)
+	{
+		std::cerr << "The runs to compare didn't finish\n";
+		return false;
+	}
+
+	// The resumed run has to be on the same reorder schedule, or it will sort the particles at a different step
+	if (m_resumedState.m_simulationTime != m_straightState.m_simulationTime
+		|| m_resumedState.m_stepsSinceReorder != m_straightState.m_stepsSinceReorder
+		|| m_resumedState.m_sortedLocality != m_straightState.m_sortedLocality
+		|| m_resumedState.m_locality != m_straightState.m_locality)
+	{
+		std::cerr << "The resumed run is " << m_resumedState.m_stepsSinceReorder << " steps past its last reorder, the uninterrupted one "
+			<< m_straightState.m_stepsSinceReorder << " steps\n";
+		return false;
+	}
+	if (m_resumed.Size() != m_straight.Size())
+	{
+		std::cerr << "The resumed run has " << m_resumed.Size() << " particles, the uninterrupted one " << m_straight.Size() << "\n";
+		return false;
+	}
+	// Compare the bits so particles that have gone NaN still count as matching
+	size_t m_bytes = m_straight.Size() * sizeof(float);
+	if (memcmp(m_resumed.X(), m_straight.X(), m_bytes) != 0 || memcmp(m_resumed.Y(), m_straight.Y(), m_bytes) != 0
+		|| memcmp(m_resumed.Id(), m_straight.Id(), m_straight.Size() * sizeof(int)) != 0)
+	{
+		std::cerr << "The particles differ after resuming from the snapshot\n";
+		return false;
+	}
+
+	return true;
+}
+
+// A test and the name it is reported under
+struct Test
+{
+	const char* m_name;
+	bool (*m_function)();
+};
+
+int main(int argc, char* argv[])
+{
+	const Test m_tests[] =
+	{
+		{ "Stable ids", TestStableIds },
+		{ "Remove count", TestRemoveCount },
+		{ "Snapshot resume", TestSnapshotResume }
+	};
+
+	bool m_passed = true;
+	for (const Test &m_test : m_tests)
+	{
+		bool m_result = m_test.m_function();
+		std::cout << m_test.m_name << ": " << (m_result ? "passed" : "FAILED") << "\n";
+		m_passed = m_passed && m_result;
+	}
+
+	return (m_passed ? 0 : -1);
+}